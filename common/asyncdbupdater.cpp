@@ -1,52 +1,176 @@
 #include <string>
 #include <deque>
 #include <limits>
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
 #include <hiredis/hiredis.h>
 #include <pthread.h>
+#include <unistd.h>
 #include "asyncdbupdater.h"
 #include "dbconnector.h"
 #include "redisselect.h"
 #include "redisapi.h"
+#include "redispipeline.h"
 #include "table.h"
 
 using namespace std;
 
 namespace swss {
 
-AsyncDBUpdater::AsyncDBUpdater(DBConnector *db, const std::string &tableName)
-    : m_db(db)
-    , m_tableName(tableName)
+constexpr size_t AsyncDBUpdaterService::DEFAULT_WORKER_COUNT;
+constexpr size_t AsyncDBUpdaterService::MAX_BATCH_SIZE;
+constexpr size_t AsyncDBUpdaterService::PIPELINE_SIZE;
+constexpr unsigned int AsyncDBUpdaterService::MAX_WRITE_RETRY;
+constexpr unsigned int AsyncDBUpdaterService::RETRY_DELAY_MS;
+
+static std::atomic<size_t> g_workerCount(AsyncDBUpdaterService::DEFAULT_WORKER_COUNT);
+
+AsyncDBUpdaterService::AsyncDBUpdaterService(size_t workerCount)
 {
-    m_runThread = true;
-    m_dbUpdateThread = std::make_shared<std::thread>(&AsyncDBUpdater::dbUpdateThread, this);
+    workerCount = std::max<size_t>(workerCount, 1);
+    for (size_t i = 0; i < workerCount; i++)
+    {
+        m_workers.emplace_back(&AsyncDBUpdaterService::workerThread, this);
+    }
 
-    SWSS_LOG_DEBUG("AsyncDBUpdater ctor tableName: %s", tableName.c_str());
+    SWSS_LOG_NOTICE("AsyncDBUpdaterService started %zu workers", workerCount);
 }
 
-AsyncDBUpdater::~AsyncDBUpdater()
+AsyncDBUpdaterService::~AsyncDBUpdaterService()
 {
-    m_runThread = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
 
-    // notify db update thread exit
-    m_dbUpdateDataNotifyCv.notify_all();
-    m_dbUpdateThread->join();
-    SWSS_LOG_DEBUG("AsyncDBUpdater dtor tableName: %s", m_tableName.c_str());
+    // Workers write what is still queued before exiting.
+    m_workCv.notify_all();
+    for (auto &worker : m_workers)
+    {
+        worker.join();
+    }
 }
 
-void AsyncDBUpdater::update(std::shared_ptr<KeyOpFieldsValuesTuple> pkco)
+std::shared_ptr<AsyncDBUpdaterService> AsyncDBUpdaterService::getInstance()
+{
+    static std::mutex instanceMutex;
+    static std::shared_ptr<AsyncDBUpdaterService> instance;
+
+    std::lock_guard<std::mutex> lock(instanceMutex);
+    if (!instance)
+    {
+        instance = std::make_shared<AsyncDBUpdaterService>(g_workerCount.load());
+    }
+
+    return instance;
+}
+
+void AsyncDBUpdaterService::setWorkerCount(size_t workerCount)
+{
+    g_workerCount = workerCount;
+}
+
+std::shared_ptr<AsyncDBUpdaterService::TableQueue> AsyncDBUpdaterService::registerTable(DBConnector *db, const std::string &tableName)
+{
+    auto table = std::make_shared<TableQueue>();
+    table->dbName = db->getDbName();
+    table->dbKey = db->getDBKey();
+    table->tableName = tableName;
+    table->connectionId = table->dbName + "|" + table->dbKey.containerName + "|" + table->dbKey.netns;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tables.push_back(table);
+    return table;
+}
+
+void AsyncDBUpdaterService::unregisterTable(const std::shared_ptr<TableQueue> &table)
+{
+    flush(*table);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tables.remove(table);
+}
+
+void AsyncDBUpdaterService::update(const std::shared_ptr<TableQueue> &table, std::shared_ptr<KeyOpFieldsValuesTuple> pkco)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    table->queue.push_back(pkco);
+    table->enqueued++;
+
+    if (!table->scheduled)
+    {
+        table->scheduled = true;
+        m_ready.push_back(table);
+        m_workCv.notify_one();
+    }
+}
+
+size_t AsyncDBUpdaterService::queueSize(TableQueue &table)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return table.queue.size() + table.inFlight;
+}
+
+bool AsyncDBUpdaterService::flush(TableQueue &table)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    uint64_t target = table.enqueued;
+    m_doneCv.wait(lock, [&table, target]() { return table.done >= target; });
+
+    bool ok = table.lost == table.lostReported;
+    table.lostReported = table.lost;
+    return ok;
+}
+
+bool AsyncDBUpdaterService::flush()
 {
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    std::vector<std::pair<std::shared_ptr<TableQueue>, uint64_t>> targets;
+    for (const auto &table : m_tables)
     {
-        std::lock_guard<std::mutex> lock(m_dbUpdateDataQueueMutex);
-        m_dbUpdateDataQueue.push(pkco);
+        targets.emplace_back(table, table->enqueued);
     }
 
-    m_dbUpdateDataNotifyCv.notify_all();
+    m_doneCv.wait(lock, [&targets]() {
+        for (const auto &target : targets)
+        {
+            if (target.first->done < target.second)
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+
+    bool ok = m_lost == m_lostReported;
+    m_lostReported = m_lost;
+    return ok;
+}
+
+AsyncDBUpdaterService::Stats AsyncDBUpdaterService::getStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    Stats stats = Stats();
+    stats.tables = m_tables.size();
+    for (const auto &table : m_tables)
+    {
+        stats.queued += table->queue.size();
+        stats.inFlight += table->inFlight;
+        stats.maxTableDepth = std::max(stats.maxTableDepth, table->queue.size() + table->inFlight);
+    }
+    stats.processed = m_processed;
+    stats.written = m_written;
+    stats.failed = m_failed;
+    stats.lost = m_lost;
+    return stats;
 }
 
-void AsyncDBUpdater::dbUpdateThread()
+void AsyncDBUpdaterService::workerThread()
 {
     SWSS_LOG_ENTER();
-    SWSS_LOG_NOTICE("dbUpdateThread begin");
 
     // Different schedule policy has different min priority 
     pthread_attr_t attr;
@@ -56,80 +180,240 @@ void AsyncDBUpdater::dbUpdateThread()
     // Use min priority will block poll thread 
     pthread_setschedprio(pthread_self(), min_priority + 1);
 
-    // Follow same logic in ConsumerStateTable: every received data will write to 'table'.
-    DBConnector db(m_db->getDbName(), 0, true, m_db->getDBKey());
-    Table table(&db, m_tableName);
-    std::mutex cvMutex;
-    std::unique_lock<std::mutex> cvLock(cvMutex);
+    WorkerContext context;
+    std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> batch;
 
+    std::unique_lock<std::mutex> lock(m_mutex);
     while (true)
     {
-        size_t count;
-        count = queueSize();
-        if (count == 0)
+        m_workCv.wait(lock, [this]() { return m_stop || !m_ready.empty(); });
+        if (m_ready.empty())
         {
-            // Check if there still data in queue before exit
-            if (!m_runThread)
-            {
-                SWSS_LOG_NOTICE("dbUpdateThread for table: %s is exiting", m_tableName.c_str());
-                break;
-            }
+            break;
+        }
 
-            // when queue is empty, wait notification, when data come, continue to check queue size again
-            m_dbUpdateDataNotifyCv.wait(cvLock);
-            continue;
+        auto table = m_ready.front();
+        m_ready.pop_front();
+
+        if (table->queue.size() <= MAX_BATCH_SIZE)
+        {
+            batch.swap(table->queue);
         }
         else
         {
-            if (!m_runThread)
-            {
-                SWSS_LOG_DEBUG("dbUpdateThread for table: %s still has %d records that need to be sent before exiting", m_tableName.c_str(), (int)count);
-            }
+            auto end = table->queue.begin() + MAX_BATCH_SIZE;
+            batch.assign(std::make_move_iterator(table->queue.begin()), std::make_move_iterator(end));
+            table->queue.erase(table->queue.begin(), end);
+        }
+        table->inFlight = batch.size();
+        m_processed += batch.size();
+        lock.unlock();
+
+        bool written = write(context, *table, batch);
+        size_t count = batch.size();
+
+        if (!written && table->retries < MAX_WRITE_RETRY)
+        {
+            // Connections were reset, give Redis some time to come back.
+            usleep(RETRY_DELAY_MS * (1u << table->retries) * 1000);
+        }
+
+        lock.lock();
+        table->inFlight = 0;
+        if (written)
+        {
+            table->retries = 0;
+            table->done += count;
+        }
+        else if (table->retries < MAX_WRITE_RETRY)
+        {
+            // Back at the head of the table's queue, so its order is kept.
+            table->retries++;
+            table->queue.insert(table->queue.begin(), std::make_move_iterator(batch.begin()), std::make_move_iterator(batch.end()));
+            m_processed -= count;
+        }
+        else
+        {
+            SWSS_LOG_ERROR("db: %s, table: %s dropped %zu operations after %u retries",
+                           table->dbName.c_str(), table->tableName.c_str(), count, MAX_WRITE_RETRY);
+            table->retries = 0;
+            table->lost += count;
+            table->done += count;
+            m_lost += count;
+        }
+        batch.clear();
+
+        if (table->queue.empty())
+        {
+            table->scheduled = false;
+        }
+        else
+        {
+            // Back of the line, behind the other tables.
+            m_ready.push_back(table);
+            m_workCv.notify_one();
+        }
+        m_doneCv.notify_all();
+    }
+}
+
+bool AsyncDBUpdaterService::write(WorkerContext &context, TableQueue &queue, const std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> &batch)
+{
+    auto kcos = coalesce(batch);
+
+    try
+    {
+        // Follow same logic in ConsumerStateTable: every received data will write to 'table'.
+        // The table is buffered, so a whole batch costs a few pipelined round trips.
+        auto &pipeline = context.pipelines[queue.connectionId];
+        if (!pipeline.second)
+        {
+            pipeline.first.reset(new DBConnector(queue.dbName, 0, true, queue.dbKey));
+            pipeline.second.reset(new RedisPipeline(pipeline.first.get(), PIPELINE_SIZE));
         }
 
-        for (size_t ie = 0; ie < count; ie++)
+        auto &table = context.tables[std::make_pair(queue.connectionId, queue.tableName)];
+        if (!table)
         {
-            auto& kco = *(m_dbUpdateDataQueue.front());
+            table.reset(new Table(pipeline.second.get(), queue.tableName, true));
+        }
 
+        for (const auto &kco : kcos)
+        {
             if (kfvOp(kco) == SET_COMMAND)
             {
                 auto& values = kfvFieldsValues(kco);
 
                 // Delete entry before Table::set(), because Table::set() does not remove the no longer existed fields from entry.
-                table.del(kfvKey(kco));
-                table.set(kfvKey(kco), values);
+                table->del(kfvKey(kco));
+                table->set(kfvKey(kco), values);
             }
             else if (kfvOp(kco) == HSET_COMMAND)
             {
                 auto& values = kfvFieldsValues(kco);
                 // Merge update only the provided fields, and leave the rest of the object intact.
-                table.set(kfvKey(kco), values);
+                table->set(kfvKey(kco), values);
             }
             else if (kfvOp(kco) == DEL_COMMAND)
             {
-                table.del(kfvKey(kco));
+                table->del(kfvKey(kco));
             }
             else
             {
-                SWSS_LOG_ERROR("db: %s, table: %s receive unknown operation: %s", m_db->getDbName().c_str(), m_tableName.c_str(), kfvOp(kco).c_str());
+                SWSS_LOG_ERROR("db: %s, table: %s receive unknown operation: %s", queue.dbName.c_str(), queue.tableName.c_str(), kfvOp(kco).c_str());
             }
+        }
+
+        table->flush();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_written += kcos.size();
+        return true;
+    }
+    catch (const std::exception &e)
+    {
+        SWSS_LOG_ERROR("db: %s, table: %s failed to write %zu operations: %s", queue.dbName.c_str(), queue.tableName.c_str(), kcos.size(), e.what());
+
+        // Start over with fresh connections.
+        for (auto it = context.tables.begin(); it != context.tables.end();)
+        {
+            it = it->first.first == queue.connectionId ? context.tables.erase(it) : std::next(it);
+        }
+        context.pipelines.erase(queue.connectionId);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_failed++;
+        return false;
+    }
+}
+
+std::vector<KeyOpFieldsValuesTuple> AsyncDBUpdaterService::coalesce(const std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> &batch)
+{
+    std::vector<KeyOpFieldsValuesTuple> result;
+    std::unordered_map<std::string, size_t> index;
+    result.reserve(batch.size());
+
+    for (const auto &pkco : batch)
+    {
+        const auto &kco = *pkco;
+        const auto &op = kfvOp(kco);
+        if (op != SET_COMMAND && op != HSET_COMMAND && op != DEL_COMMAND)
+        {
+            // Logged when written.
+            result.push_back(kco);
+            continue;
+        }
+
+        auto it = index.find(kfvKey(kco));
+        if (it == index.end())
+        {
+            index[kfvKey(kco)] = result.size();
+            result.push_back(kco);
+            continue;
+        }
+
+        auto &merged = result[it->second];
+        if (op != HSET_COMMAND)
+        {
+            merged = kco;
+            continue;
+        }
+
+        if (kfvOp(merged) == DEL_COMMAND)
+        {
+            kfvOp(merged) = SET_COMMAND;
+            kfvFieldsValues(merged).clear();
+        }
 
+        // Later values of a field win.
+        auto &values = kfvFieldsValues(merged);
+        for (const auto &fv : kfvFieldsValues(kco))
+        {
+            auto field = std::find_if(values.begin(), values.end(),
+                                      [&fv](const FieldValueTuple &existing) { return fvField(existing) == fvField(fv); });
+            if (field == values.end())
+            {
+                values.push_back(fv);
+            }
+            else
             {
-                std::lock_guard<std::mutex> lock(m_dbUpdateDataQueueMutex);
-                m_dbUpdateDataQueue.pop();
+                fvValue(*field) = fvValue(fv);
             }
         }
     }
 
-    SWSS_LOG_DEBUG("AsyncDBUpdater dbUpdateThread end: %s", m_tableName.c_str());
+    return result;
+}
+
+AsyncDBUpdater::AsyncDBUpdater(DBConnector *db, const std::string &tableName)
+    : m_service(AsyncDBUpdaterService::getInstance())
+    , m_tableName(tableName)
+{
+    m_table = m_service->registerTable(db, tableName);
+
+    SWSS_LOG_DEBUG("AsyncDBUpdater ctor tableName: %s", tableName.c_str());
+}
+
+AsyncDBUpdater::~AsyncDBUpdater()
+{
+    // Everything queued is written before the table goes away.
+    m_service->unregisterTable(m_table);
+    SWSS_LOG_DEBUG("AsyncDBUpdater dtor tableName: %s", m_tableName.c_str());
+}
+
+void AsyncDBUpdater::update(std::shared_ptr<KeyOpFieldsValuesTuple> pkco)
+{
+    m_service->update(m_table, pkco);
 }
 
 size_t AsyncDBUpdater::queueSize()
 {
-    // size() is not thread safe
-    std::lock_guard<std::mutex> lock(m_dbUpdateDataQueueMutex);
+    return m_service->queueSize(*m_table);
+}
 
-    return m_dbUpdateDataQueue.size();
+bool AsyncDBUpdater::flush()
+{
+    return m_service->flush(*m_table);
 }
 
 }
@@ -3,6 +3,10 @@
 #include <string>
 #include <deque>
 #include <list>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
 #include <condition_variable>
 #include "dbconnector.h"
 #include "table.h"
@@ -13,6 +17,148 @@
 
 namespace swss {
 
+class RedisPipeline;
+
+/*
+ * Process-wide service writing the operations of every AsyncDBUpdater to
+ * Redis with a fixed number of worker threads, each with its own
+ * connections. Operations of one table are written in order by one worker
+ * at a time; tables with pending operations take turns, a batch of at most
+ * MAX_BATCH_SIZE operations each, so a busy table does not starve the
+ * others.
+ */
+class AsyncDBUpdaterService
+{
+public:
+    explicit AsyncDBUpdaterService(size_t workerCount = DEFAULT_WORKER_COUNT);
+    ~AsyncDBUpdaterService();
+
+    // The service shared by all AsyncDBUpdater instances of the process.
+    static std::shared_ptr<AsyncDBUpdaterService> getInstance();
+
+    // Worker count of the shared service, only effective before it is first
+    // used.
+    static void setWorkerCount(size_t workerCount);
+
+    static constexpr size_t DEFAULT_WORKER_COUNT = 2;
+
+    // Operations a worker takes from a table before moving to the next one.
+    static constexpr size_t MAX_BATCH_SIZE = 1024;
+
+    // Commands pipelined to Redis before the writer waits for the replies.
+    static constexpr size_t PIPELINE_SIZE = 1024;
+
+    // A batch which fails to write is retried with fresh connections, the
+    // delay doubling each time, before it is dropped.
+    static constexpr unsigned int MAX_WRITE_RETRY = 5;
+    static constexpr unsigned int RETRY_DELAY_MS = 100;
+
+    struct Stats
+    {
+        size_t tables;          // registered tables
+        size_t queued;          // operations waiting in all tables
+        size_t inFlight;        // operations being written
+        size_t maxTableDepth;   // deepest table queue
+        uint64_t processed;     // operations taken off the queues
+        uint64_t written;       // operations left after coalescing
+        uint64_t failed;        // batches which failed to write
+        uint64_t lost;          // operations dropped after all retries
+    };
+
+    Stats getStats();
+
+    // Wait until all operations queued before the call are written.
+    // Returns false if operations were dropped since the last flush().
+    bool flush();
+
+    struct TableQueue;
+
+    std::shared_ptr<TableQueue> registerTable(DBConnector *db, const std::string &tableName);
+
+    // Flushes the table before it is removed.
+    void unregisterTable(const std::shared_ptr<TableQueue> &table);
+
+    void update(const std::shared_ptr<TableQueue> &table, std::shared_ptr<KeyOpFieldsValuesTuple> pkco);
+
+    // Operations queued or being written for the table.
+    size_t queueSize(TableQueue &table);
+
+    // Same as flush(), for the operations of one table.
+    bool flush(TableQueue &table);
+
+    /*
+     * Reduce a batch of operations to at most one per key, in order of each
+     * key's first operation: a later SET or DEL replaces what came before,
+     * and HSET fields are merged into the earlier operation. HSET after DEL
+     * becomes a SET of just those fields.
+     */
+    static std::vector<KeyOpFieldsValuesTuple> coalesce(const std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> &batch);
+
+    struct TableQueue
+    {
+        std::string dbName;
+        SonicDBKey dbKey;
+        std::string tableName;
+
+        // Identifies the Redis instance, tables with the same one share
+        // a worker's connection.
+        std::string connectionId;
+
+        std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> queue;
+
+        // Operations taken by a worker but not yet written.
+        size_t inFlight = 0;
+
+        // In m_ready or owned by a worker, which keeps the table in order.
+        bool scheduled = false;
+
+        uint64_t enqueued = 0;
+        uint64_t done = 0;
+
+        // Failed writes of the batch at the head of the queue.
+        unsigned int retries = 0;
+
+        // Operations dropped after all retries, and as of the last flush().
+        uint64_t lost = 0;
+        uint64_t lostReported = 0;
+    };
+
+private:
+    // Redis connections and tables of one worker.
+    struct WorkerContext
+    {
+        std::map<std::string, std::pair<std::unique_ptr<DBConnector>, std::unique_ptr<RedisPipeline>>> pipelines;
+        std::map<std::pair<std::string, std::string>, std::unique_ptr<Table>> tables;
+    };
+
+    void workerThread();
+
+    // Returns false if the batch failed to write.
+    bool write(WorkerContext &context, TableQueue &table, const std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> &batch);
+
+    std::mutex m_mutex;
+
+    // Workers wait for tables in m_ready.
+    std::condition_variable m_workCv;
+
+    // flush() waits for written batches.
+    std::condition_variable m_doneCv;
+
+    bool m_stop = false;
+
+    std::list<std::shared_ptr<TableQueue>> m_tables;
+
+    std::deque<std::shared_ptr<TableQueue>> m_ready;
+
+    uint64_t m_processed = 0;
+    uint64_t m_written = 0;
+    uint64_t m_failed = 0;
+    uint64_t m_lost = 0;
+    uint64_t m_lostReported = 0;
+
+    std::vector<std::thread> m_workers;
+};
+
 class AsyncDBUpdater
 {
 public:
@@ -22,20 +168,16 @@ public:
     void update(std::shared_ptr<KeyOpFieldsValuesTuple> pkco);
 
     size_t queueSize();
-private:
-    void dbUpdateThread();
-
-    volatile bool m_runThread;
-
-    std::shared_ptr<std::thread> m_dbUpdateThread;
 
-    std::mutex m_dbUpdateDataQueueMutex;
+    // Wait until all operations queued so far are written. Returns false
+    // if operations were dropped since the last flush().
+    bool flush();
 
-    std::condition_variable m_dbUpdateDataNotifyCv;
-
-    std::queue<std::shared_ptr<KeyOpFieldsValuesTuple>, std::list<std::shared_ptr<KeyOpFieldsValuesTuple>>> m_dbUpdateDataQueue;
+private:
+    // Kept alive by its tables.
+    std::shared_ptr<AsyncDBUpdaterService> m_service;
 
-    DBConnector *m_db;
+    std::shared_ptr<AsyncDBUpdaterService::TableQueue> m_table;
 
     std::string m_tableName;
 };
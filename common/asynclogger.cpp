@@ -0,0 +1,345 @@
+#include <stdio.h>
+#include <string.h>
+#include <syslog.h>
+#include <algorithm>
+
+#include "common/asynclogger.h"
+
+using namespace std;
+
+namespace swss {
+
+constexpr size_t AsyncLogger::DEFAULT_RING_SIZE;
+constexpr size_t AsyncLogger::MAX_MESSAGE_SIZE;
+constexpr int AsyncLogger::DEFAULT_LOSSLESS_PRIO;
+
+static_assert(AsyncLogger::DEFAULT_LOSSLESS_PRIO == LOG_ERR, "DEFAULT_LOSSLESS_PRIO is LOG_ERR");
+
+// A record is its header followed by the message, padded to RECORD_ALIGN.
+// WRAP_RECORD tells the writer to continue at the start of the ring.
+static const size_t RECORD_ALIGN = 8;
+static const uint32_t WRAP_RECORD = UINT32_MAX;
+
+// Two records of the largest message always fit.
+static const size_t MIN_RING_SIZE = 4 * AsyncLogger::MAX_MESSAGE_SIZE;
+
+struct RecordHeader
+{
+    uint32_t size;
+    int32_t prio;
+};
+
+static size_t recordSize(size_t size)
+{
+    return sizeof(RecordHeader) + ((size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1));
+}
+
+struct AsyncLogger::Ring
+{
+    explicit Ring(size_t size)
+        : buffer(size)
+        , head(0)
+        , tail(0)
+        , cachedHead(0)
+        , closed(false)
+    {
+    }
+
+    std::vector<char> buffer;
+
+    /* written by the writer thread */
+    char pad0[64];
+    std::atomic<uint64_t> head;
+
+    /* written by the owning thread */
+    char pad1[64];
+    std::atomic<uint64_t> tail;
+
+    // Last head seen by the owner, reloaded only when the ring looks full
+    // so the owner doesn't pull the writer's cache line on every message.
+    uint64_t cachedHead;
+
+    // The owning thread exited, the ring goes once drained.
+    std::atomic<bool> closed;
+};
+
+AsyncLogger::AsyncLogger(const Sink &sink, size_t ringSize, int losslessPrio)
+    : m_sink(sink)
+    , m_ringSize(std::max((ringSize + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1), MIN_RING_SIZE))
+    , m_losslessPrio(losslessPrio)
+    , m_sleeping(false)
+    , m_stop(false)
+    , m_written(0)
+    , m_direct(0)
+    , m_dropped(0)
+    , m_reportedDrops(0)
+    , m_reportTime(std::chrono::steady_clock::now())
+{
+    static std::atomic<uint64_t> nextId(1);
+    m_id = nextId++;
+
+    m_thread = std::thread(&AsyncLogger::writerThread, this);
+}
+
+AsyncLogger::~AsyncLogger()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+
+    reportDrops(true);
+}
+
+AsyncLogger::Ring *AsyncLogger::threadRing()
+{
+    struct ThreadRings
+    {
+        ~ThreadRings()
+        {
+            for (auto &ring : rings)
+            {
+                ring.second->closed = true;
+            }
+        }
+
+        std::vector<std::pair<uint64_t, std::shared_ptr<Ring>>> rings;
+    };
+
+    static thread_local ThreadRings threadRings;
+
+    for (auto &ring : threadRings.rings)
+    {
+        if (ring.first == m_id)
+        {
+            return ring.second.get();
+        }
+    }
+
+    auto ring = std::make_shared<Ring>(m_ringSize);
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_rings.push_back(ring);
+    }
+    threadRings.rings.emplace_back(m_id, ring);
+    return ring.get();
+}
+
+bool AsyncLogger::log(int prio, const char *fmt, va_list ap)
+{
+    char buffer[MAX_MESSAGE_SIZE];
+
+    int size = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+    if (size < 0)
+    {
+        size = 0;
+    }
+
+    return write(prio, buffer, std::min((size_t)size, sizeof(buffer) - 1));
+}
+
+bool AsyncLogger::write(int prio, const char *text, size_t size)
+{
+    size = std::min(size, MAX_MESSAGE_SIZE - 1);
+
+    Ring *ring = threadRing();
+    size_t capacity = ring->buffer.size();
+    uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    size_t pos = (size_t)(tail % capacity);
+    size_t needed = recordSize(size);
+
+    // Records are contiguous, skip the end of the ring if it's too short.
+    size_t skip = pos + needed > capacity ? capacity - pos : 0;
+    if (capacity - (size_t)(tail - ring->cachedHead) < skip + needed)
+    {
+        ring->cachedHead = ring->head.load(std::memory_order_acquire);
+    }
+    if (capacity - (size_t)(tail - ring->cachedHead) < skip + needed)
+    {
+        if (prio <= m_losslessPrio)
+        {
+            m_sink(prio, text, size);
+            m_direct++;
+            return true;
+        }
+
+        m_dropped++;
+        return false;
+    }
+
+    char *data = ring->buffer.data();
+    if (skip)
+    {
+        RecordHeader wrap = { WRAP_RECORD, 0 };
+        memcpy(data + pos, &wrap, sizeof(wrap));
+        pos = 0;
+    }
+
+    RecordHeader header = { (uint32_t)size, prio };
+    memcpy(data + pos, &header, sizeof(header));
+    memcpy(data + pos + sizeof(header), text, size);
+
+    // Pairs with the writer setting m_sleeping before it checks the rings.
+    ring->tail.store(tail + skip + needed, std::memory_order_seq_cst);
+    if (m_sleeping.load(std::memory_order_seq_cst))
+    {
+        wakeWriter();
+    }
+
+    return true;
+}
+
+void AsyncLogger::wakeWriter()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_cv.notify_one();
+}
+
+void AsyncLogger::flush()
+{
+    std::vector<std::pair<std::shared_ptr<Ring>, uint64_t>> targets;
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        for (const auto &ring : m_rings)
+        {
+            targets.emplace_back(ring, ring->tail.load(std::memory_order_acquire));
+        }
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv.notify_one();
+    m_flushCv.wait(lock, [&targets]() {
+        for (const auto &target : targets)
+        {
+            if (target.first->head.load(std::memory_order_acquire) < target.second)
+            {
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+AsyncLogger::Stats AsyncLogger::getStats() const
+{
+    Stats stats;
+    stats.written = m_written.load();
+    stats.direct = m_direct.load();
+    stats.dropped = m_dropped.load();
+    return stats;
+}
+
+bool AsyncLogger::pending()
+{
+    std::lock_guard<std::mutex> lock(m_ringsMutex);
+    for (const auto &ring : m_rings)
+    {
+        if (ring->head.load(std::memory_order_relaxed) != ring->tail.load(std::memory_order_seq_cst))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool AsyncLogger::drain()
+{
+    bool drained = false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_ringsMutex);
+        m_draining.assign(m_rings.begin(), m_rings.end());
+    }
+
+    for (const auto &ring : m_draining)
+    {
+        bool closed = ring->closed.load(std::memory_order_acquire);
+        size_t capacity = ring->buffer.size();
+        const char *data = ring->buffer.data();
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        uint64_t tail = ring->tail.load(std::memory_order_acquire);
+
+        while (head != tail)
+        {
+            size_t pos = (size_t)(head % capacity);
+            RecordHeader header;
+            memcpy(&header, data + pos, sizeof(header));
+            if (header.size == WRAP_RECORD)
+            {
+                head += capacity - pos;
+                pos = 0;
+                memcpy(&header, data, sizeof(header));
+            }
+
+            m_sink(header.prio, data + pos + sizeof(header), header.size);
+
+            // Give the room back right away, the owner may be in a burst.
+            head += recordSize(header.size);
+            ring->head.store(head, std::memory_order_release);
+            m_written++;
+            drained = true;
+        }
+
+        if (closed)
+        {
+            std::lock_guard<std::mutex> lock(m_ringsMutex);
+            m_rings.erase(std::remove(m_rings.begin(), m_rings.end(), ring), m_rings.end());
+        }
+    }
+
+    m_draining.clear();
+    return drained;
+}
+
+void AsyncLogger::reportDrops(bool force)
+{
+    uint64_t dropped = m_dropped.load();
+    auto now = std::chrono::steady_clock::now();
+
+    if (dropped == m_reportedDrops || (!force && now - m_reportTime < std::chrono::seconds(1)))
+    {
+        return;
+    }
+
+    char buffer[128];
+    int size = snprintf(buffer, sizeof(buffer), ":- %s: dropped %llu log messages, a thread's ring was full",
+                        __FUNCTION__, (unsigned long long)(dropped - m_reportedDrops));
+    m_sink(LOG_WARNING, buffer, std::min((size_t)size, sizeof(buffer) - 1));
+
+    m_reportedDrops = dropped;
+    m_reportTime = now;
+}
+
+void AsyncLogger::writerThread()
+{
+    while (true)
+    {
+        bool drained = drain();
+        reportDrops(false);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_flushCv.notify_all();
+        if (drained)
+        {
+            continue;
+        }
+
+        if (m_stop)
+        {
+            break;
+        }
+
+        m_sleeping = true;
+        if (!pending())
+        {
+            // The timeout only paces the drop reports.
+            m_cv.wait_for(lock, std::chrono::seconds(1));
+        }
+        m_sleeping = false;
+    }
+}
+
+}
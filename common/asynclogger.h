@@ -0,0 +1,114 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swss {
+
+/*
+ * Background writer of log messages, the async backend of Logger.
+ *
+ * Each thread formats its messages into a ring of its own, which it is
+ * the only writer of, so logging takes no lock and no system call. One
+ * writer thread drains the rings and hands each message to the sink.
+ * Messages of a thread keep their order, messages of different threads
+ * are interleaved as the writer finds them.
+ *
+ * Loss is bounded by the ring size: a message which doesn't fit is
+ * dropped and counted, and the writer reports the count at most once
+ * per second. Messages at losslessPrio or more severe are instead
+ * written on the calling thread when the ring is full, the sink must
+ * therefore be thread safe.
+ */
+class AsyncLogger
+{
+public:
+    // Receives a formatted message, without a trailing newline.
+    typedef std::function<void (int prio, const char *text, size_t size)> Sink;
+
+    AsyncLogger(const Sink &sink, size_t ringSize = DEFAULT_RING_SIZE, int losslessPrio = DEFAULT_LOSSLESS_PRIO);
+
+    // Writes the messages left in the rings before returning.
+    ~AsyncLogger();
+
+    // Per thread, a burst of about a thousand messages.
+    static constexpr size_t DEFAULT_RING_SIZE = 256 * 1024;
+
+    // LOG_ERR, errors and worse are never dropped. The header leaves
+    // syslog.h, included by everyone through logger.h, out.
+    static constexpr int DEFAULT_LOSSLESS_PRIO = 3;
+
+    // Longer messages are truncated, like the exception text of wthrow.
+    static constexpr size_t MAX_MESSAGE_SIZE = 0x1000;
+
+    // Format and queue a message. Returns false if it was dropped.
+    bool log(int prio, const char *fmt, va_list ap);
+
+    bool write(int prio, const char *text, size_t size);
+
+    // Wait until the messages this thread and others queued so far are
+    // handed to the sink.
+    void flush();
+
+    struct Stats
+    {
+        uint64_t written;     // messages handed to the sink by the writer
+        uint64_t direct;      // lossless messages written by a caller, its ring was full
+        uint64_t dropped;     // messages lost to a full ring
+    };
+
+    Stats getStats() const;
+
+private:
+    struct Ring;
+
+    AsyncLogger(const AsyncLogger&);
+    AsyncLogger& operator=(const AsyncLogger&);
+
+    Ring *threadRing();
+    void wakeWriter();
+    bool pending();
+    bool drain();
+    void reportDrops(bool force);
+    void writerThread();
+
+    Sink m_sink;
+
+    size_t m_ringSize;
+
+    int m_losslessPrio;
+
+    // Tells the rings of this instance apart in the thread_local list.
+    uint64_t m_id;
+
+    std::mutex m_ringsMutex;
+    std::vector<std::shared_ptr<Ring>> m_rings;
+
+    // Writer's copy of m_rings, drained without the lock.
+    std::vector<std::shared_ptr<Ring>> m_draining;
+
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::condition_variable m_flushCv;
+    std::atomic<bool> m_sleeping;
+    bool m_stop;
+
+    std::atomic<uint64_t> m_written;
+    std::atomic<uint64_t> m_direct;
+    std::atomic<uint64_t> m_dropped;
+    uint64_t m_reportedDrops;
+    std::chrono::steady_clock::time_point m_reportTime;
+
+    std::thread m_thread;
+};
+
+}
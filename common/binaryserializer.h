@@ -3,16 +3,162 @@
 
 #include "common/armhelper.h"
 #include "common/rediscommand.h"
+#include "common/schema.h"
 #include "common/table.h"
 
+#include <limits>
 #include <string>
 
 using namespace std;
 
 namespace swss {
 
+/*
+ * Wire formats of the ZMQ table messages.
+ *
+ * Version 1 is a size_t pair count followed by (size_t length, bytes) pairs:
+ * first the DB and table names, then for each operation the key and its
+ * field count as a decimal string, then the field/value pairs. An operation
+ * without fields is a DEL.
+ *
+ * Version 2 starts with the magic "SWZ" and a version byte, followed by a
+ * flags byte. Strings are prefixed with their length as a LEB128 varint.
+ * With FLAG_SEQUENCE the flags are followed by the sender's session id and
+ * the message's sequence number in that session, both varints.
+ * After the DB and table names comes a varint operation count, and each
+ * operation is an op byte (OP_CUSTOM is followed by the op string), the key,
+ * a varint field count and the field/value pairs. With FLAG_COMPRESSED
+ * everything after the table name is compressed, see ZmqCompression; the
+ * names stay readable so messages can be routed without decompressing them.
+ *
+ * Receivers detect the version of each message: the magic cannot start a
+ * version 1 message smaller than MQ_RESPONSE_MAX_COUNT, because it would
+ * announce tens of millions of pairs. Senders keep using version 1 unless
+ * they are configured to use version 2, so old receivers keep working.
+ */
 class BinarySerializer {
 public:
+    enum Version
+    {
+        VERSION_1 = 1,
+        VERSION_2 = 2,
+    };
+
+    /* Position of a message in the stream of a table, version 2 only */
+    struct Sequence
+    {
+        uint64_t session = 0;
+
+        /* 0 if the message is not sequenced */
+        uint64_t number = 0;
+    };
+
+    static size_t serializedSize(const string &dbName, const string &tableName,
+                                 const vector<KeyOpFieldsValuesTuple> &kcos,
+                                 Version version,
+                                 const Sequence *sequence = nullptr) {
+        if (version == VERSION_2)
+        {
+            return serializedSizeV2(dbName, tableName, kcos, sequence);
+        }
+
+        checkNoSequence(sequence);
+        return serializedSize(dbName, tableName, kcos);
+    }
+
+    static size_t serializeBuffer(
+        char* buffer,
+        const size_t size,
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos,
+        Version version,
+        const Sequence *sequence = nullptr)
+    {
+        if (version == VERSION_2)
+        {
+            return serializeBufferV2(buffer, size, dbName, tableName, kcos, sequence);
+        }
+
+        checkNoSequence(sequence);
+        return serializeBuffer(buffer, size, dbName, tableName, kcos);
+    }
+
+    /* Version of a serialized message */
+    static Version getVersion(const char* buffer, const size_t size)
+    {
+        if (size >= V2_HEADER_SIZE
+            && memcmp(buffer, v2Magic(), V2_MAGIC_SIZE) == 0
+            && (uint8_t)buffer[V2_MAGIC_SIZE] == VERSION_2)
+        {
+            return VERSION_2;
+        }
+
+        return VERSION_1;
+    }
+
+    /* Version 2 message whose operations are compressed */
+    static bool isCompressed(const char* buffer, const size_t size)
+    {
+        return getVersion(buffer, size) == VERSION_2
+            && ((uint8_t)buffer[V2_FLAGS_OFFSET] & FLAG_COMPRESSED);
+    }
+
+    static void setCompressed(char* buffer, const size_t size, bool compressed)
+    {
+        if (getVersion(buffer, size) != VERSION_2)
+        {
+            SWSS_LOG_THROW("Compressed messages require wire format version 2");
+        }
+
+        uint8_t flags = (uint8_t)buffer[V2_FLAGS_OFFSET];
+        flags = compressed ? (uint8_t)(flags | FLAG_COMPRESSED) : (uint8_t)(flags & ~FLAG_COMPRESSED);
+        buffer[V2_FLAGS_OFFSET] = (char)flags;
+    }
+
+    /* Offset of the operation count of a version 2 message, after the table name */
+    static size_t getOperationsOffset(const char* buffer, const size_t size)
+    {
+        if (getVersion(buffer, size) != VERSION_2)
+        {
+            SWSS_LOG_THROW("Operations offset requires wire format version 2");
+        }
+
+        std::string dbName;
+        std::string tableName;
+        ReaderV2 reader(buffer, size);
+        getHeaderV2(reader, nullptr);
+        reader.getString(dbName);
+        reader.getString(tableName);
+        return size - reader.remaining();
+    }
+
+    /* DB name and table name of a serialized message, without decoding the operations */
+    static void deserializeTableName(
+        const char* buffer,
+        const size_t size,
+        std::string& dbName,
+        std::string& tableName)
+    {
+        if (getVersion(buffer, size) == VERSION_2)
+        {
+            ReaderV2 reader(buffer, size);
+            getHeaderV2(reader, nullptr);
+            reader.getString(dbName);
+            reader.getString(tableName);
+            return;
+        }
+
+        ReaderV1 reader(buffer, size);
+        if (reader.getLength() == 0)
+        {
+            return;
+        }
+
+        reader.getString(dbName);
+        reader.getString(tableName);
+    }
+
     static size_t serializedSize(const string &dbName, const string &tableName,
                                  const vector<KeyOpFieldsValuesTuple> &kcos) {
         size_t n = 0;
@@ -120,57 +266,484 @@ public:
         }
     }
 
+    /* sequence, if not null, is set to the position of a sequenced message */
     static void deserializeBuffer(
         const char* buffer,
         const size_t size,
         std::string& dbName,
         std::string& tableName,
-        std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos)
-    {
-        std::vector<FieldValueTuple> values;
-        deserializeBuffer(buffer, size, values);
-        int fvs_size = -1;
-        KeyOpFieldsValuesTuple kco;
-        auto& key = kfvKey(kco);
-        auto& op = kfvOp(kco);
-        auto& fvs = kfvFieldsValues(kco);
-        for (auto& fv : values)
-        {
-            auto& field = fvField(fv);
-            auto& value = fvValue(fv);
-            // The first pair is the DB name and the table name.
-            if (fvs_size < 0)
-            {
-                dbName = field;
-                tableName = value;
-                fvs_size = 0;
-                continue;
-            }
+        std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos,
+        Sequence *sequence = nullptr)
+    {
+        if (getVersion(buffer, size) == VERSION_2)
+        {
+            deserializeBufferV2(buffer, size, dbName, tableName, kcos, sequence);
+            return;
+        }
+
+        if (sequence != nullptr)
+        {
+            *sequence = Sequence();
+        }
+
+        // Decode in a single pass straight into the final tuples.
+        ReaderV1 reader(buffer, size);
+        size_t kvp_count = reader.getLength();
+        if (kvp_count == 0)
+        {
+            return;
+        }
+
+        // The first pair is the DB name and the table name.
+        reader.getString(dbName);
+        reader.getString(tableName);
+        kvp_count--;
+
+        while (kvp_count > 0)
+        {
             // This is the beginning of a request.
             // The first pair is the key and the number of attributes.
             // If the attribute count is zero, it is a DEL request.
-            if (fvs_size == 0)
+            auto kco = std::make_shared<KeyOpFieldsValuesTuple>();
+            reader.getString(kfvKey(*kco));
+            size_t fvs_size = reader.getCount();
+            kvp_count--;
+
+            kfvOp(*kco) = (fvs_size == 0) ? DEL_COMMAND : SET_COMMAND;
+
+            if (fvs_size > kvp_count)
+            {
+                // Incomplete request at the end of the message.
+                break;
+            }
+
+            auto& fvs = kfvFieldsValues(*kco);
+            fvs.resize(fvs_size);
+            for (auto& fv : fvs)
             {
-                key = field;
-                fvs_size = std::stoi(value);
-                op = (fvs_size == 0) ? DEL_COMMAND : SET_COMMAND;
-                fvs.clear();
+                reader.getString(fvField(fv));
+                reader.getString(fvValue(fv));
             }
-            // This is an attribut pair.
-            else
+            kvp_count -= fvs_size;
+
+            kcos.push_back(std::move(kco));
+        }
+    }
+
+private:
+    static const char* v2Magic()
+    {
+        return "SWZ";
+    }
+
+    static constexpr size_t V2_MAGIC_SIZE = 3;
+    // magic, version byte and flags byte
+    static constexpr size_t V2_HEADER_SIZE = V2_MAGIC_SIZE + 2;
+    static constexpr size_t V2_FLAGS_OFFSET = V2_MAGIC_SIZE + 1;
+
+    enum : uint8_t
+    {
+        FLAG_SEQUENCE = 0x01,
+        FLAG_COMPRESSED = 0x02,
+        SUPPORTED_FLAGS = FLAG_SEQUENCE | FLAG_COMPRESSED,
+    };
+
+    static void checkNoSequence(const Sequence *sequence)
+    {
+        if (sequence != nullptr && sequence->number != 0)
+        {
+            SWSS_LOG_THROW("Sequenced messages require wire format version 2");
+        }
+    }
+
+    enum : uint8_t
+    {
+        OP_SET = 0,
+        OP_DEL = 1,
+        OP_HSET = 2,
+        OP_CUSTOM = 0xff,
+    };
+
+    static uint8_t encodeOp(const std::string& op)
+    {
+        if (op == SET_COMMAND)
+        {
+            return OP_SET;
+        }
+        else if (op == DEL_COMMAND)
+        {
+            return OP_DEL;
+        }
+        else if (op == HSET_COMMAND)
+        {
+            return OP_HSET;
+        }
+
+        return OP_CUSTOM;
+    }
+
+    static size_t varintSize(uint64_t value)
+    {
+        size_t n = 1;
+        while (value >= 0x80)
+        {
+            value >>= 7;
+            n++;
+        }
+
+        return n;
+    }
+
+    static size_t stringSizeV2(const std::string& str)
+    {
+        return varintSize(str.size()) + str.size();
+    }
+
+    static size_t serializedSizeV2(const string &dbName, const string &tableName,
+                                   const vector<KeyOpFieldsValuesTuple> &kcos,
+                                   const Sequence *sequence)
+    {
+        size_t n = V2_HEADER_SIZE;
+        if (sequence != nullptr && sequence->number != 0)
+        {
+            n += varintSize(sequence->session) + varintSize(sequence->number);
+        }
+        n += stringSizeV2(dbName);
+        n += stringSizeV2(tableName);
+        n += varintSize(kcos.size());
+
+        for (const KeyOpFieldsValuesTuple &kco : kcos)
+        {
+            const vector<FieldValueTuple> &fvs = kfvFieldsValues(kco);
+            n += 1;
+            if (encodeOp(kfvOp(kco)) == OP_CUSTOM)
             {
-                fvs.push_back(fv);
-                --fvs_size;
+                n += stringSizeV2(kfvOp(kco));
             }
-            // We got the last attribut pair. This is the end of a request.
-            if (fvs_size == 0)
+            n += stringSizeV2(kfvKey(kco));
+            n += varintSize(fvs.size());
+
+            for (const FieldValueTuple &fv : fvs)
             {
-                kcos.push_back(std::make_shared<KeyOpFieldsValuesTuple>(kco));
+                n += stringSizeV2(fvField(fv));
+                n += stringSizeV2(fvValue(fv));
             }
         }
+
+        return n;
+    }
+
+    class WriterV2
+    {
+    public:
+        WriterV2(char* buffer, size_t size)
+            : m_pos(buffer), m_end(buffer + size)
+        {
+        }
+
+        void putByte(uint8_t byte)
+        {
+            reserve(1);
+            *m_pos++ = (char)byte;
+        }
+
+        void putVarint(uint64_t value)
+        {
+            reserve(varintSize(value));
+            while (value >= 0x80)
+            {
+                *m_pos++ = (char)((value & 0x7f) | 0x80);
+                value >>= 7;
+            }
+            *m_pos++ = (char)value;
+        }
+
+        void putString(const std::string& str)
+        {
+            putVarint(str.size());
+            reserve(str.size());
+            memcpy(m_pos, str.data(), str.size());
+            m_pos += str.size();
+        }
+
+        char* position() const
+        {
+            return m_pos;
+        }
+
+    private:
+        void reserve(size_t n)
+        {
+            if ((size_t)(m_end - m_pos) < n)
+            {
+                SWSS_LOG_THROW("There are not enough buffer for binary serializer to serialize, need %zu more bytes", n);
+            }
+        }
+
+        char* m_pos;
+        char* const m_end;
+    };
+
+    class ReaderV1
+    {
+    public:
+        ReaderV1(const char* buffer, size_t size)
+            : m_buffer(buffer), m_pos(buffer), m_end(buffer + size)
+        {
+        }
+
+        size_t getLength()
+        {
+            size_t len;
+            require(sizeof(size_t), 0);
+            memcpy(&len, m_pos, sizeof(size_t));
+            m_pos += sizeof(size_t);
+            return len;
+        }
+
+        void getString(std::string& str)
+        {
+            size_t len = getLength();
+            require(len, len);
+            str.assign(m_pos, len);
+            m_pos += len;
+        }
+
+        // Attribute count, encoded as a decimal string.
+        size_t getCount()
+        {
+            size_t len = getLength();
+            require(len, len);
+            if (len == 0)
+            {
+                SWSS_LOG_THROW("serialized attribute count is empty");
+            }
+
+            size_t count = 0;
+            for (size_t i = 0; i < len; i++)
+            {
+                char c = m_pos[i];
+                if (c < '0' || c > '9' || count > (std::numeric_limits<size_t>::max() - 9) / 10)
+                {
+                    SWSS_LOG_THROW("serialized attribute count is invalid");
+                }
+                count = count * 10 + (size_t)(c - '0');
+            }
+
+            m_pos += len;
+            return count;
+        }
+
+    private:
+        void require(size_t n, size_t datalen)
+        {
+            if ((size_t)(m_end - m_pos) < n)
+            {
+                SWSS_LOG_THROW("serialized data was truncated, data length: %zu, increase buffer size: %zu",
+                               datalen,
+                               (size_t)(m_end - m_buffer));
+            }
+        }
+
+        const char* const m_buffer;
+        const char* m_pos;
+        const char* const m_end;
+    };
+
+    class ReaderV2
+    {
+    public:
+        ReaderV2(const char* buffer, size_t size)
+            : m_pos(buffer), m_end(buffer + size)
+        {
+        }
+
+        uint8_t getByte()
+        {
+            require(1);
+            return (uint8_t)*m_pos++;
+        }
+
+        uint64_t getVarint()
+        {
+            uint64_t value = 0;
+            for (unsigned int shift = 0; shift < 64; shift += 7)
+            {
+                uint8_t byte = getByte();
+                value |= (uint64_t)(byte & 0x7f) << shift;
+                if (!(byte & 0x80))
+                {
+                    return value;
+                }
+            }
+
+            SWSS_LOG_THROW("serialized varint is malformed");
+        }
+
+        void getString(std::string& str)
+        {
+            uint64_t len = getVarint();
+            require(len);
+            str.assign(m_pos, (size_t)len);
+            m_pos += len;
+        }
+
+        size_t remaining() const
+        {
+            return (size_t)(m_end - m_pos);
+        }
+
+    private:
+        void require(uint64_t n)
+        {
+            if ((uint64_t)(m_end - m_pos) < n)
+            {
+                SWSS_LOG_THROW("serialized data was truncated, need %zu more bytes, %zu left",
+                               (size_t)n, (size_t)(m_end - m_pos));
+            }
+        }
+
+        const char* m_pos;
+        const char* const m_end;
+    };
+
+    static size_t serializeBufferV2(
+        char* buffer,
+        const size_t size,
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos,
+        const Sequence *sequence)
+    {
+        WriterV2 writer(buffer, size);
+        bool sequenced = sequence != nullptr && sequence->number != 0;
+
+        for (size_t i = 0; i < V2_MAGIC_SIZE; i++)
+        {
+            writer.putByte((uint8_t)v2Magic()[i]);
+        }
+        writer.putByte(VERSION_2);
+        writer.putByte(sequenced ? FLAG_SEQUENCE : 0);
+        if (sequenced)
+        {
+            writer.putVarint(sequence->session);
+            writer.putVarint(sequence->number);
+        }
+
+        writer.putString(dbName);
+        writer.putString(tableName);
+        writer.putVarint(kcos.size());
+
+        for (auto& kco : kcos)
+        {
+            auto& fvs = kfvFieldsValues(kco);
+            uint8_t op = encodeOp(kfvOp(kco));
+
+            writer.putByte(op);
+            if (op == OP_CUSTOM)
+            {
+                writer.putString(kfvOp(kco));
+            }
+            writer.putString(kfvKey(kco));
+            writer.putVarint(fvs.size());
+            for (auto& fv : fvs)
+            {
+                writer.putString(fvField(fv));
+                writer.putString(fvValue(fv));
+            }
+        }
+
+        return writer.position() - buffer;
+    }
+
+    /* Skip magic and version, parse flags and the fields they announce */
+    static void getHeaderV2(ReaderV2 &reader, Sequence *sequence)
+    {
+        for (size_t i = 0; i < V2_MAGIC_SIZE + 1; i++)
+        {
+            reader.getByte();
+        }
+
+        uint8_t flags = reader.getByte();
+        if (flags & ~SUPPORTED_FLAGS)
+        {
+            SWSS_LOG_THROW("serialized message has unsupported flags: 0x%x", flags);
+        }
+
+        Sequence position;
+        if (flags & FLAG_SEQUENCE)
+        {
+            position.session = reader.getVarint();
+            position.number = reader.getVarint();
+        }
+
+        if (sequence != nullptr)
+        {
+            *sequence = position;
+        }
+    }
+
+    static void deserializeBufferV2(
+        const char* buffer,
+        const size_t size,
+        std::string& dbName,
+        std::string& tableName,
+        std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos,
+        Sequence *sequence)
+    {
+        if (isCompressed(buffer, size))
+        {
+            SWSS_LOG_THROW("serialized message is compressed, decompress it before decoding");
+        }
+
+        ReaderV2 reader(buffer, size);
+        getHeaderV2(reader, sequence);
+
+        reader.getString(dbName);
+        reader.getString(tableName);
+
+        uint64_t count = reader.getVarint();
+        // Every operation takes at least 3 bytes, don't trust the count for reserve().
+        kcos.reserve(kcos.size() + (size_t)std::min<uint64_t>(count, reader.remaining() / 3));
+        for (uint64_t i = 0; i < count; i++)
+        {
+            auto kco = std::make_shared<KeyOpFieldsValuesTuple>();
+            auto& op = kfvOp(*kco);
+            auto& fvs = kfvFieldsValues(*kco);
+
+            switch (reader.getByte())
+            {
+                case OP_SET:
+                    op = SET_COMMAND;
+                    break;
+                case OP_DEL:
+                    op = DEL_COMMAND;
+                    break;
+                case OP_HSET:
+                    op = HSET_COMMAND;
+                    break;
+                case OP_CUSTOM:
+                    reader.getString(op);
+                    break;
+                default:
+                    SWSS_LOG_THROW("serialized message has unknown operation");
+            }
+
+            reader.getString(kfvKey(*kco));
+
+            uint64_t fieldCount = reader.getVarint();
+            fvs.reserve((size_t)std::min<uint64_t>(fieldCount, reader.remaining() / 2));
+            for (uint64_t j = 0; j < fieldCount; j++)
+            {
+                fvs.emplace_back();
+                reader.getString(fvField(fvs.back()));
+                reader.getString(fvValue(fvs.back()));
+            }
+
+            kcos.push_back(std::move(kco));
+        }
     }
 
-private:
     char* m_buffer;
     const size_t m_buffer_size;
     char* m_current_position;
@@ -62,8 +62,23 @@ EventPublisher::do_publish(event_handle_t handle, const string tag, const event_
     return -1;
 }
 
+int
+EventPublisher::do_publish_batch(event_handle_t handle,
+        const vector<event_publish_entry_t> &events)
+{
+    lst_publishers_t::const_iterator itc;
+    for(itc=s_publishers.begin(); itc != s_publishers.end(); ++itc) {
+        if (itc->second.get() == handle) {
+            return itc->second->publish_batch(events);
+        }
+    }
+    return -1;
+}
+
 
-EventPublisher::EventPublisher(): m_zmq_ctx(NULL), m_socket(NULL), m_sequence(0)
+EventPublisher::EventPublisher(): m_zmq_ctx(NULL), m_socket(NULL), m_sequence(0),
+    m_log_rate(DEFAULT_PUBLISH_LOG_RATE), m_log_sec(0), m_log_cnt(0),
+    m_log_suppressed(0)
 {}
 
 static string
@@ -109,6 +124,7 @@ int EventPublisher::init(const string event_source)
     RET_ON_ERR (rc == 0, "Failed to echo send in event service rc=%d", rc);
 
     m_event_source = event_source;
+    m_log_rate = get_config_data(PUBLISH_LOG_RATE, (uint32_t)DEFAULT_PUBLISH_LOG_RATE);
 
     m_socket = sock;
 out:
@@ -132,44 +148,67 @@ EventPublisher::remove_runtime_id()
 {
     if (!m_runtime_id.empty()) {
         /* Retire the runtime ID */
-        send_evt(EVENT_STR_CTRL_DEINIT);
+        send_evt(m_event_source + ":" + EVENT_STR_CTRL_DEINIT, EVENT_STR_CTRL_DEINIT);
     }
 }
 
 int
-EventPublisher::send_evt(const string str_data)
+EventPublisher::send_evt(const string &topic, const string str_data)
 {
     internal_event_t event_data;
     int rc;
-    stringstream ss;
 
     if (str_data.size() > EVENT_MAXSZ) {
         SWSS_LOG_ERROR("event size (%d) > expected max(%d). Still published.",
             (int)str_data.size(), EVENT_MAXSZ);
     }
     auto timepoint = system_clock::now();
-    ss << duration_cast<nanoseconds>(timepoint.time_since_epoch()).count();
 
     event_data[EVENT_STR_DATA] = str_data;
     event_data[EVENT_RUNTIME_ID] = m_runtime_id;
     /* A value of 0 will indicate rollover */
     ++m_sequence;
     event_data[EVENT_SEQUENCE] = seq_to_str(m_sequence);
-    event_data[EVENT_EPOCH] = ss.str();
+    event_data[EVENT_EPOCH] = to_string(duration_cast<nanoseconds>(timepoint.time_since_epoch()).count());
 
-    rc = zmq_message_send(m_socket, m_event_source, event_data);
+    rc = zmq_message_send(m_socket, topic, event_data);
     RET_ON_ERR(rc == 0, "failed to send for tag %s", str_data.substr(0, 20).c_str());
 out:
     return rc;
 }
 
 
-int
-EventPublisher::publish(const string tag, const event_params_t *params)
+void
+EventPublisher::log_published(const string &str_data)
 {
-    int rc;
-    string str_data;
+    if (m_log_rate == 0) {
+        return;
+    }
+
+    time_t now = time(nullptr);
+    if (now != m_log_sec) {
+        if (m_log_suppressed != 0) {
+            SWSS_LOG_NOTICE("EVENT_PUBLISHED: %u more events of %s not logged",
+                    m_log_suppressed, m_event_source.c_str());
+        }
+        m_log_sec = now;
+        m_log_cnt = 0;
+        m_log_suppressed = 0;
+    }
+
+    if (m_log_cnt < m_log_rate) {
+        ++m_log_cnt;
+        SWSS_LOG_NOTICE("EVENT_PUBLISHED: %s", str_data.c_str());
+    }
+    else {
+        ++m_log_suppressed;
+    }
+}
+
 
+string
+EventPublisher::prepare_publish()
+{
     if (m_event_service.is_active()) {
         string s;
 
@@ -187,31 +226,60 @@ EventPublisher::publish(const string tag, const event_params_t *params)
         m_runtime_id = get_uuid();
     }
 
-    /* Check for timestamp in params. If not, provide it. */
-    string param_str;
-    event_params_t evt_params;
-    if (params != NULL) {
-        if (params->find(EVENT_TS_PARAM) == params->end()) {
-            evt_params = *params;
-            evt_params[EVENT_TS_PARAM] = get_timestamp();
-            params = &evt_params;
-        }
-    }
-    else {
-        evt_params[EVENT_TS_PARAM] = get_timestamp();
-        params = &evt_params;
-    }
+    return get_timestamp();
+}
+
 
-    str_data = convert_to_json(m_event_source + ":" + tag, *params);
-    SWSS_LOG_NOTICE("EVENT_PUBLISHED: %s", str_data.c_str());
+int
+EventPublisher::publish_one(const string &tag, const event_params_t &params,
+        const string &ts)
+{
+    int rc;
 
-    rc = send_evt(str_data);
+    /* The timestamp is added, if params has none */
+    string topic = m_event_source + ":" + tag;
+    string str_data = convert_to_json(topic, params, ts);
+    log_published(str_data);
+
+    rc = send_evt(topic, str_data);
     RET_ON_ERR(rc == 0, "failed to send event str[%d]= %s", (int)str_data.size(),
         str_data.substr(0, 20).c_str());
 out:
     return rc;
 }
 
+
+int
+EventPublisher::publish(const string tag, const event_params_t *params)
+{
+    static const event_params_t no_params;
+
+    string ts = prepare_publish();
+
+    return publish_one(tag, (params != NULL) ? *params : no_params, ts);
+}
+
+
+int
+EventPublisher::publish_batch(const vector<event_publish_entry_t> &events)
+{
+    int rc = 0;
+
+    if (events.empty()) {
+        return 0;
+    }
+
+    string ts = prepare_publish();
+
+    for (const auto &e: events) {
+        rc = publish_one(e.tag, e.params, ts);
+        RET_ON_ERR(rc == 0, "failed to publish batch of %d events rc=%d",
+                (int)events.size(), rc);
+    }
+out:
+    return rc;
+}
+
 event_handle_t
 events_init_publisher(const string event_source)
 {
@@ -230,6 +298,12 @@ event_publish(event_handle_t handle, const string tag, const event_params_t *par
     return EventPublisher::do_publish(handle, tag, params);
 }
 
+int
+event_publish_batch(event_handle_t handle, const vector<event_publish_entry_t> &events)
+{
+    return EventPublisher::do_publish_batch(handle, events);
+}
+
 
 /* Expect only one subscriber per process */
 EventSubscriber_ptr_t EventSubscriber::s_subscriber;
@@ -360,16 +434,16 @@ EventSubscriber::init(bool use_cache, int recv_timeout,
     int rc = zmq_connect (sock, get_config(XPUB_END_KEY).c_str());
     RET_ON_ERR(rc == 0, "Subscriber fails to connect %s", get_config(XPUB_END_KEY).c_str());
 
-    if ((subs_sources == NULL) || (subs_sources->empty())) {
-        rc = zmq_setsockopt(sock, ZMQ_SUBSCRIBE, "", 0);
-        RET_ON_ERR(rc == 0, "Fails to set option rc=%d", rc);
-    }
-    else {
+    if (subs_sources != NULL) {
         for (const auto &e: *subs_sources) {
-            rc = zmq_setsockopt(sock, ZMQ_SUBSCRIBE, e.c_str(), e.size());
-            RET_ON_ERR(rc == 0, "Fails to set option rc=%d", rc);
+            m_filters.push_back(events_str_filter(e));
         }
     }
+    for (const auto &e: events_topic_filters(subs_sources != NULL ?
+                *subs_sources : event_subscribe_sources_t())) {
+        rc = zmq_setsockopt(sock, ZMQ_SUBSCRIBE, e.data(), e.size());
+        RET_ON_ERR(rc == 0, "Fails to set option rc=%d", rc);
+    }
 
     if (recv_timeout != -1) {
         rc = zmq_setsockopt (sock, ZMQ_RCVTIMEO, &recv_timeout, sizeof (recv_timeout));
@@ -415,6 +489,21 @@ EventSubscriber::prune_track()
 }
 
 
+bool
+EventSubscriber::is_wanted(const string &event_str) const
+{
+    if (m_filters.empty()) {
+        return true;
+    }
+    for (const auto &f: m_filters) {
+        if (event_str.compare(0, f.size(), f) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
 int
 EventSubscriber::event_receive(event_receive_op_C_t &op)
 {
@@ -537,14 +626,23 @@ EventSubscriber::event_receive(string &event_str, uint32_t &missed_cnt,
 
         if (event_data[EVENT_STR_DATA].compare(0, EVENT_STR_CTRL_PREFIX_SZ,
                     EVENT_STR_CTRL_PREFIX) != 0) {
-            istringstream iss(event_data[EVENT_EPOCH]);
-
+            if (!is_wanted(event_data[EVENT_STR_DATA])) {
+                /*
+                 * Cached events and text topics are not filtered by ZMQ.
+                 * Still track it, so it does not count as missed.
+                 */
+                m_track[event_data[EVENT_RUNTIME_ID]] = evt_info_t(seq);
+                continue;
+            }
             /*
              * event_sz - string size is verified against event string.
              * Hence strncpy will put null at the end.
              */
-            event_str = event_data[EVENT_STR_DATA];
-            iss >> publish_epoch;
+            event_str = move(event_data[EVENT_STR_DATA]);
+            const string &epoch = event_data[EVENT_EPOCH];
+            if (!epoch.empty()) {
+                publish_epoch = strtoll(epoch.c_str(), NULL, 10);
+            }
             m_track[event_data[EVENT_RUNTIME_ID]] = evt_info_t(seq);
             break;
         } else {
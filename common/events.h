@@ -112,6 +112,32 @@ int event_publish(event_handle_t handle, const std::string event_tag,
         const event_params_t *params=NULL);
 
 
+typedef struct {
+    std::string tag;        /* event_tag as for event_publish */
+    event_params_t params;  /* Params associated with event */
+} event_publish_entry_t;
+
+/*
+ * Publish many events at once, e.g. state changes of many ports.
+ *
+ *  Events are published in order, each as with event_publish and with
+ *  its own sequence number. The per call work is done once per batch:
+ *  events without a timestamp param share the timestamp of the batch.
+ *
+ * input:
+ *  handle - As obtained from events_init_publisher for a event-source.
+ *
+ *  events - The events to publish.
+ *
+ * return:
+ *  0   - On success
+ *  As event_publish for the first event that failed. The events after it
+ *  are not published.
+ */
+int event_publish_batch(event_handle_t handle,
+        const std::vector<event_publish_entry_t> &events);
+
+
 
 /*
  * Initialize subscriber.
@@ -135,6 +161,13 @@ int event_publish(event_handle_t handle, const std::string event_tag,
  *      List of subscription sources of interest.
  *      The source value is the corresponding YANG module name.
  *      e.g. "sonic-events-bgp " is the source modulr name for bgp.
+ *      An entry "<source>:<tag>" subscribes to that event only. With
+ *      "wire_version": "2" the filters are pushed down to ZMQ, so
+ *      unwanted events are dropped by the proxy instead of being
+ *      received and parsed. With the default text format all events
+ *      are still received and the subscriber drops the unwanted ones.
+ *      Sequences are per publisher, hence with tag filters the missed
+ *      count also covers the publisher's events of other tags.
  *      default: All sources, if none provided.
  *
  * Return:
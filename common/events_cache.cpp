@@ -0,0 +1,279 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "events_cache.h"
+
+/*
+ * The header & ring layout is also the spill file layout.
+ * head & tail only grow, their difference is the bytes in use.
+ * A record that does not fit before the end of the ring starts over
+ * at its start, and a WRAP_RECORD length tells readers to follow.
+ */
+struct event_cache::header_t {
+    uint64_t magic;
+    uint64_t capacity;
+    uint64_t head;
+    uint64_t tail;
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t dropped;
+};
+
+static const uint64_t CACHE_MAGIC = 0x31454843545645ULL;
+static const size_t RECORD_ALIGN = 8;
+static const uint64_t WRAP_RECORD = UINT64_MAX;
+static const size_t MIN_CAPACITY = 4096;
+
+static size_t
+record_size(size_t size)
+{
+    return sizeof(uint64_t) + ((size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1));
+}
+
+event_cache::event_cache() :
+    m_header(NULL),
+    m_data(NULL),
+    m_capacity(0),
+    m_mapping(MAP_FAILED),
+    m_mapping_size(0),
+    m_fd(-1)
+{
+}
+
+event_cache::~event_cache()
+{
+    close_cache();
+}
+
+void
+event_cache::close_cache()
+{
+    if (m_mapping != MAP_FAILED) {
+        munmap(m_mapping, m_mapping_size);
+        m_mapping = MAP_FAILED;
+    }
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+    m_header = NULL;
+    m_data = NULL;
+    m_capacity = 0;
+}
+
+int
+event_cache::init()
+{
+    return init(get_config_data(CACHE_MAX_BYTES, (size_t)DEFAULT_CACHE_MAX_BYTES),
+            get_config(CACHE_SPILL_PATH));
+}
+
+int
+event_cache::init(size_t max_bytes, const string &spill_path)
+{
+    size_t header_sz = (sizeof(header_t) + 63) & ~(size_t)63;
+    size_t capacity = max(max_bytes & ~(RECORD_ALIGN - 1), MIN_CAPACITY);
+    bool reset = true;
+    struct stat st;
+    int rc = -1;
+
+    close_cache();
+    m_mapping_size = header_sz + capacity;
+
+    if (spill_path.empty()) {
+        m_mapping = mmap(NULL, m_mapping_size, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    }
+    else {
+        m_fd = open(spill_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+        RET_ON_ERR(m_fd >= 0, "Failed to open cache spill file %s", spill_path.c_str());
+        RET_ON_ERR(fstat(m_fd, &st) == 0, "Failed to stat %s", spill_path.c_str());
+
+        if ((size_t)st.st_size != m_mapping_size) {
+            RET_ON_ERR(ftruncate(m_fd, 0) == 0 &&
+                    ftruncate(m_fd, (off_t)m_mapping_size) == 0,
+                    "Failed to size %s to %d", spill_path.c_str(), (int)m_mapping_size);
+        }
+        m_mapping = mmap(NULL, m_mapping_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED, m_fd, 0);
+    }
+    RET_ON_ERR(m_mapping != MAP_FAILED, "Failed to map %d bytes of cache",
+            (int)m_mapping_size);
+
+    m_header = (header_t *)m_mapping;
+    m_data = (char *)m_mapping + header_sz;
+    m_capacity = capacity;
+
+    if ((m_header->magic == CACHE_MAGIC) && (m_header->capacity == capacity) &&
+            (m_header->head <= m_header->tail) &&
+            ((m_header->tail - m_header->head) <= capacity)) {
+        reset = false;
+        SWSS_LOG_NOTICE("Cache restored %d events from %s",
+                (int)m_header->count, spill_path.c_str());
+    }
+    if (reset) {
+        memset(m_header, 0, sizeof(*m_header));
+        m_header->capacity = capacity;
+        m_header->magic = CACHE_MAGIC;
+    }
+    rc = 0;
+out:
+    if (rc != 0) {
+        close_cache();
+    }
+    return rc;
+}
+
+size_t
+event_cache::max_event_size() const
+{
+    /* Any event fits after dropping all, whatever the wrap skips */
+    return (m_capacity / 2) - sizeof(uint64_t);
+}
+
+bool
+event_cache::drop_oldest()
+{
+    uint64_t length;
+    size_t pos;
+
+    if (m_header->count == 0) {
+        /* Only wrap skips left */
+        m_header->head = m_header->tail;
+        return false;
+    }
+
+    pos = (size_t)(m_header->head % m_capacity);
+    memcpy(&length, m_data + pos, sizeof(length));
+    if (length == WRAP_RECORD) {
+        m_header->head += m_capacity - pos;
+        pos = 0;
+        memcpy(&length, m_data, sizeof(length));
+    }
+    if (length > (m_capacity - pos - sizeof(uint64_t))) {
+        SWSS_LOG_ERROR("Cache corrupted at %d, dropping %d events",
+                (int)pos, (int)m_header->count);
+        clear();
+        return false;
+    }
+    m_header->head += record_size((size_t)length);
+    m_header->count--;
+    m_header->bytes -= length;
+    return true;
+}
+
+int
+event_cache::push(const event_serialized_t &event)
+{
+    size_t pos, needed, skip;
+    uint64_t length = event.size();
+    int rc = -1;
+
+    RET_ON_ERR(m_header != NULL, "Cache is not initialized");
+    if (event.size() > max_event_size()) {
+        m_header->dropped++;
+        RET_ON_ERR(false, "Event of %d bytes exceeds cache limit %d",
+                (int)event.size(), (int)max_event_size());
+    }
+
+    pos = (size_t)(m_header->tail % m_capacity);
+    needed = record_size(event.size());
+
+    /* Records are contiguous, skip the end of the ring if it's too short */
+    skip = (pos + needed > m_capacity) ? m_capacity - pos : 0;
+    while ((m_capacity - (size_t)(m_header->tail - m_header->head)) < (skip + needed)) {
+        /* An emptied cache has all room, tail does not move */
+        if (drop_oldest()) {
+            m_header->dropped++;
+        }
+    }
+
+    if (skip != 0) {
+        memcpy(m_data + pos, &WRAP_RECORD, sizeof(WRAP_RECORD));
+        pos = 0;
+    }
+    memcpy(m_data + pos, &length, sizeof(length));
+    memcpy(m_data + pos + sizeof(length), event.data(), event.size());
+
+    m_header->tail += skip + needed;
+    m_header->count++;
+    m_header->bytes += length;
+    rc = 0;
+out:
+    return rc;
+}
+
+int
+event_cache::push(const event_serialized_lst_t &events)
+{
+    int rc = 0;
+
+    for (const auto &e: events) {
+        if (push(e) != 0) {
+            rc = -1;
+        }
+    }
+    return rc;
+}
+
+void
+event_cache::read(event_serialized_lst_t &events, size_t max_bytes)
+{
+    size_t sz = 0;
+
+    events.clear();
+    if (m_header == NULL) {
+        return;
+    }
+
+    while (m_header->count != 0) {
+        size_t pos = (size_t)(m_header->head % m_capacity);
+        uint64_t length;
+
+        memcpy(&length, m_data + pos, sizeof(length));
+        if (length == WRAP_RECORD) {
+            pos = 0;
+            memcpy(&length, m_data, sizeof(length));
+        }
+        if (!events.empty() && ((sz + length) > max_bytes)) {
+            break;
+        }
+        if (length > (m_capacity - pos - sizeof(uint64_t))) {
+            /* Logs & resets */
+            drop_oldest();
+            break;
+        }
+        events.emplace_back(m_data + pos + sizeof(uint64_t), (size_t)length);
+        drop_oldest();
+        sz += (size_t)length;
+    }
+}
+
+void
+event_cache::clear()
+{
+    if (m_header != NULL) {
+        m_header->head = m_header->tail;
+        m_header->count = 0;
+        m_header->bytes = 0;
+    }
+}
+
+size_t
+event_cache::count() const
+{
+    return (m_header != NULL) ? (size_t)m_header->count : 0;
+}
+
+size_t
+event_cache::bytes() const
+{
+    return (m_header != NULL) ? (size_t)m_header->bytes : 0;
+}
+
+uint64_t
+event_cache::dropped() const
+{
+    return (m_header != NULL) ? m_header->dropped : 0;
+}
@@ -0,0 +1,98 @@
+#ifndef _EVENTS_CACHE_H
+#define _EVENTS_CACHE_H
+
+#include "events_common.h"
+
+/*
+ * Event cache of the cache service, see event_service::cache_start.
+ *
+ * A byte ring with a fixed budget. Events are stored back to back as
+ * a length followed by the serialized event, the oldest are dropped
+ * to make room, so a push costs O(1) however full the cache is. The
+ * subscriber still sees the dropped events as missed, as sequences
+ * are tracked per runtime id.
+ *
+ * With a spill path the ring lives in a file mapped MAP_SHARED, so the
+ * events cached survive a restart of the caching process. A file that
+ * does not hold a ring of the same budget is reset.
+ *
+ * Not thread safe; the service reads & writes from one thread.
+ */
+
+/* Memory budget of the cache, all events and their lengths */
+#define CACHE_MAX_BYTES "cache_max_bytes"
+#define DEFAULT_CACHE_MAX_BYTES (16 * 1024 * 1024)
+
+/* File backing the cache, none by default */
+#define CACHE_SPILL_PATH "cache_spill_path"
+
+/* Bytes of events returned per cache read */
+#define DEFAULT_CACHE_READ_BYTES (256 * 1024)
+
+class event_cache {
+    public:
+        event_cache();
+        ~event_cache();
+
+        /*
+         * Allocate or map the ring. Without arguments the budget and
+         * spill path are taken from the config.
+         *
+         * return:
+         *  0   - On success
+         *  -1  - On failure. The cache is unusable.
+         */
+        int init();
+        int init(size_t max_bytes, const string &spill_path = "");
+
+        /*
+         * Add an event, dropping the oldest until it fits.
+         *
+         * return:
+         *  0   - On success
+         *  -1  - Not initialized, or the event is larger than half the
+         *        budget. The event is dropped.
+         */
+        int push(const event_serialized_t &event);
+        int push(const event_serialized_lst_t &events);
+
+        /*
+         * Take the oldest events, up to max_bytes of them and at least
+         * one. An empty list implies no more.
+         */
+        void read(event_serialized_lst_t &events,
+                size_t max_bytes = DEFAULT_CACHE_READ_BYTES);
+
+        void clear();
+
+        size_t count() const;
+
+        /* Bytes of event data cached */
+        size_t bytes() const;
+
+        /* Events dropped for room or size since init */
+        uint64_t dropped() const;
+
+        /* Largest event push accepts */
+        size_t max_event_size() const;
+
+    private:
+        struct header_t;
+
+        event_cache(const event_cache &);
+        event_cache &operator=(const event_cache &);
+
+        void close_cache();
+        bool drop_oldest();
+
+        header_t *m_header;
+        char *m_data;
+        size_t m_capacity;
+
+        /* The mapping, header and ring */
+        void *m_mapping;
+        size_t m_mapping_size;
+        int m_fd;
+};
+
+#endif // _EVENTS_CACHE_H
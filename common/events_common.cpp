@@ -1,4 +1,7 @@
+#include <atomic>
 #include "events_common.h"
+#include "events.h"
+#include "json.h"
 
 int running_ut = 0;
 
@@ -12,26 +15,291 @@ const map_str_str_t cfg_default = {
     CFG_VAL(REQ_REP_END_KEY, "tcp://127.0.0.1:5572"),
     CFG_VAL(CAPTURE_END_KEY, "tcp://127.0.0.1:5573"),
     CFG_VAL(STATS_UPD_SECS, "5"),
-    CFG_VAL(CACHE_MAX_CNT, "")
+    CFG_VAL(CACHE_MAX_CNT, ""),
+    CFG_VAL(WIRE_VERSION_KEY, ""),
+    CFG_VAL(PUBLISH_LOG_RATE, "")
 };
 
 map_str_str_t cfg_data;
 
+/*
+ * Cached, it is checked for every event by any thread. 0 until read from
+ * config
+ */
+static atomic<int> wire_version(0);
+
 sequence_t str_to_seq(const string s)
 {
-    stringstream ss(s);
-    sequence_t seq;
+    return (sequence_t)strtoul(s.c_str(), NULL, 10);
+}
+
+string seq_to_str(sequence_t seq)
+{
+    return to_string(seq);
+}
+
+int
+events_wire_version()
+{
+    int version = wire_version.load(memory_order_relaxed);
+
+    if (version == 0) {
+        string s(get_config(WIRE_VERSION_KEY));
+        char *end = NULL;
+        long v = strtol(s.c_str(), &end, 10);
+
+        if ((end != s.c_str()) && (*end == '\0') &&
+                ((v == EVENTS_WIRE_TEXT) || (v == EVENTS_WIRE_BINARY))) {
+            version = (int)v;
+        }
+        else {
+            if (!s.empty()) {
+                SWSS_LOG_ERROR("Invalid %s \"%s\", expect %d or %d; using %d",
+                        WIRE_VERSION_KEY, s.c_str(), EVENTS_WIRE_TEXT,
+                        EVENTS_WIRE_BINARY, EVENTS_WIRE_TEXT);
+            }
+            version = EVENTS_WIRE_TEXT;
+        }
+        wire_version.store(version, memory_order_relaxed);
+    }
+    return version;
+}
+
+static string
+topic_prefix(const string &filter)
+{
+    /* A source alone must not match longer sources */
+    return (filter.find(':') == string::npos) ? filter + ":" : filter;
+}
 
-    ss >> seq;
+vector<string>
+events_topic_filters(const vector<string> &filters)
+{
+    vector<string> subs;
 
-    return seq;
+    if (filters.empty() || (events_wire_version() < EVENTS_WIRE_BINARY)) {
+        subs.push_back("");
+        return subs;
+    }
+
+    for (const auto &f: filters) {
+        string prefix = topic_prefix(f);
+        string source = prefix.substr(0, prefix.find(':') + 1);
+        string s;
+
+        /* The encoding of a string starts with the encoding of its prefix */
+        binary_encode(prefix, s);
+        subs.push_back(s);
+        binary_encode(source + EVENT_STR_CTRL_PREFIX, s);
+        subs.push_back(s);
+    }
+    sort(subs.begin(), subs.end());
+    subs.erase(unique(subs.begin(), subs.end()), subs.end());
+
+    /* Publishers still on wire version 1 */
+    subs.push_back(EVENTS_TEXT_ARCHIVE_PREFIX);
+    return subs;
 }
 
-string seq_to_str(sequence_t seq)
+string
+events_str_filter(const string &filter)
+{
+    string prefix = topic_prefix(filter);
+
+    return "{\"" + prefix + ((prefix.back() == ':') ? "" : "\"");
+}
+
+static void
+put_varint(string &s, size_t v)
+{
+    while (v >= 0x80) {
+        s += (char)(uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    s += (char)(uint8_t)v;
+}
+
+static bool
+get_varint(const char *&p, const char *end, size_t &v)
+{
+    v = 0;
+    for (unsigned shift = 0; (p < end) && (shift < 64); shift += 7) {
+        uint8_t b = (uint8_t)*p++;
+        v |= (size_t)(b & 0x7f) << shift;
+        if ((b & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void
+put_str(string &s, const string &v)
+{
+    put_varint(s, v.size());
+    s.append(v);
+}
+
+static bool
+get_str(const char *&p, const char *end, string &v)
+{
+    size_t len;
+
+    if (!get_varint(p, end, len) || (len > (size_t)(end - p))) {
+        return false;
+    }
+    v.assign(p, len);
+    p += len;
+    return true;
+}
+
+static void
+put_header(string &s, char kind, size_t size_hint)
+{
+    s.clear();
+    s.reserve(size_hint + 8);
+    s += EVENTS_BINARY_MAGIC;
+    s += (char)EVENTS_BINARY_FORMAT;
+    s += kind;
+}
+
+static bool
+get_header(const char *&p, const char *end, char kind)
+{
+    if ((end - p) < 3 || p[0] != EVENTS_BINARY_MAGIC) {
+        return false;
+    }
+    if (p[1] != EVENTS_BINARY_FORMAT) {
+        SWSS_LOG_ERROR("deserialize Failed: unknown binary format %d", (int)(uint8_t)p[1]);
+        return false;
+    }
+    if (p[2] != kind) {
+        SWSS_LOG_ERROR("deserialize Failed: expected kind %c got %c", kind, p[2]);
+        return false;
+    }
+    p += 3;
+    return true;
+}
+
+static int
+decode_failed(size_t size)
+{
+    SWSS_LOG_ERROR("deserialize Failed: malformed binary message of %d bytes",
+            (int)size);
+    return ERR_MESSAGE_INVALID;
+}
+
+bool
+is_binary_serialized(const char *data, size_t size)
+{
+    return (size != 0) && (data[0] == EVENTS_BINARY_MAGIC);
+}
+
+bool
+binary_encode(const string &data, string &s)
+{
+    put_header(s, 'S', data.size());
+    s.append(data);
+    return true;
+}
+
+bool
+binary_encode(const map_str_str_t &data, string &s)
+{
+    size_t sz = 0;
+    for (const auto &e: data) {
+        sz += e.first.size() + e.second.size() + 4;
+    }
+
+    put_header(s, 'M', sz);
+    put_varint(s, data.size());
+    for (const auto &e: data) {
+        put_str(s, e.first);
+        put_str(s, e.second);
+    }
+    return true;
+}
+
+bool
+binary_encode(const vector<string> &data, string &s)
+{
+    size_t sz = 0;
+    for (const auto &e: data) {
+        sz += e.size() + 2;
+    }
+
+    put_header(s, 'L', sz);
+    put_varint(s, data.size());
+    for (const auto &e: data) {
+        put_str(s, e);
+    }
+    return true;
+}
+
+int
+binary_decode(const char *data, size_t size, string &out)
+{
+    const char *p = data, *end = data + size;
+
+    if (!get_header(p, end, 'S')) {
+        return decode_failed(size);
+    }
+    out.assign(p, end);
+    return 0;
+}
+
+int
+binary_decode(const char *data, size_t size, map_str_str_t &out)
+{
+    const char *p = data, *end = data + size;
+    size_t cnt;
+    string key, val;
+
+    out.clear();
+    if (!get_header(p, end, 'M') || !get_varint(p, end, cnt)) {
+        return decode_failed(size);
+    }
+    for (size_t i = 0; i < cnt; ++i) {
+        if (!get_str(p, end, key) || !get_str(p, end, val)) {
+            out.clear();
+            return decode_failed(size);
+        }
+        /* Encoded in key order */
+        out.emplace_hint(out.end(), move(key), move(val));
+    }
+    if (p != end) {
+        out.clear();
+        return decode_failed(size);
+    }
+    return 0;
+}
+
+int
+binary_decode(const char *data, size_t size, vector<string> &out)
 {
-    stringstream ss;
-    ss << seq;
-    return ss.str();
+    const char *p = data, *end = data + size;
+    size_t cnt;
+
+    out.clear();
+    if (!get_header(p, end, 'L') || !get_varint(p, end, cnt)) {
+        return decode_failed(size);
+    }
+    /* Every element takes at least its length byte */
+    if (cnt > (size_t)(end - p)) {
+        return decode_failed(size);
+    }
+    out.resize(cnt);
+    for (auto &e: out) {
+        if (!get_str(p, end, e)) {
+            out.clear();
+            return decode_failed(size);
+        }
+    }
+    if (p != end) {
+        out.clear();
+        return decode_failed(size);
+    }
+    return 0;
 }
 
 
@@ -40,6 +308,7 @@ read_init_config(const char *init_cfg_file)
 {
     /* Set default and override from file */
     cfg_data = cfg_default;
+    wire_version.store(0, memory_order_relaxed);
 
     if (init_cfg_file == NULL) {
         return;
@@ -86,20 +355,26 @@ get_config(const string key)
 const string
 get_timestamp()
 {
-    stringstream ss, sfrac;
+    static thread_local int64_t last_sec = -1;
+    static thread_local char prefix[32];
+    static thread_local size_t prefix_len = 0;
 
-    auto timepoint = system_clock::now();
-    time_t tt = system_clock::to_time_t (timepoint);
-    struct tm * ptm = localtime(&tt);
+    int64_t us = duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+    int64_t sec = us / 1000000;
 
-    uint64_t ms = duration_cast<microseconds>(timepoint.time_since_epoch()).count();
-    uint64_t sec = duration_cast<seconds>(timepoint.time_since_epoch()).count();
-    uint64_t mfrac = ms - (sec * 1000 * 1000);
+    if (sec != last_sec) {
+        time_t tt = (time_t)sec;
+        struct tm tm;
 
-    sfrac << mfrac;
+        localtime_r(&tt, &tm);
+        prefix_len = strftime(prefix, sizeof(prefix), "%FT%H:%M:%S.", &tm);
+        last_sec = sec;
+    }
 
-    ss << put_time(ptm, "%FT%H:%M:%S.") << sfrac.str().substr(0, 6) << "Z";
-    return ss.str();
+    char ts[48];
+    memcpy(ts, prefix, prefix_len);
+    snprintf(ts + prefix_len, sizeof(ts) - prefix_len, "%06dZ", (int)(us - (sec * 1000000)));
+    return string(ts);
 }
 
 string
@@ -116,6 +391,56 @@ convert_to_json(const string key, const map_str_str_t &params)
     return msg.dump();
 }
 
+string
+convert_to_json(const string &key, const map_str_str_t &params, const string &ts)
+{
+    static const string ts_key(EVENT_TS_PARAM);
+    const bool need_ts = (params.find(ts_key) == params.end());
+    bool add_ts = need_ts;
+    string s;
+
+    auto add = [&s](const string &k, const string &v) {
+        bool ok = swss::JSon::appendString(s, k);
+        s += ':';
+        ok = ok && swss::JSon::appendString(s, v);
+        s += ',';
+        return ok;
+    };
+
+    /*
+     * Written directly, as nlohmann dumps it: params are in key order
+     * and the timestamp goes in its place.
+     */
+    s.reserve(key.size() + ts.size() + 32 + (params.size() * 32));
+    s += '{';
+    bool ascii = swss::JSon::appendString(s, key);
+    s += ":{";
+    for (auto itc = params.begin(); ascii && (itc != params.end()); ++itc) {
+        if (add_ts && (itc->first > ts_key)) {
+            ascii = add(ts_key, ts);
+            add_ts = false;
+        }
+        ascii = ascii && add(itc->first, itc->second);
+    }
+    if (ascii && add_ts) {
+        ascii = add(ts_key, ts);
+    }
+    if (ascii) {
+        if (s.back() == ',') {
+            s.pop_back();
+        }
+        s += "}}";
+        return s;
+    }
+
+    /* nlohmann validates non-ASCII text as UTF-8 */
+    map_str_str_t all(params);
+    if (need_ts) {
+        all[ts_key] = ts;
+    }
+    return convert_to_json(key, all);
+}
+
 int
 convert_from_json(const string json_str, string &key, map_str_str_t &params)
 {
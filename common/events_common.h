@@ -143,6 +143,24 @@ typedef map<string, string> map_str_str_t;
 #define STATS_UPD_SECS "stats_upd_secs"
 #define CACHE_MAX_CNT "cache_max_cnt"
 
+/*
+ * EVENT_PUBLISHED syslog lines per second per publisher; 0 disables them.
+ * Events over the limit are counted and reported in a summary line.
+ */
+#define PUBLISH_LOG_RATE "publish_log_rate"
+#define DEFAULT_PUBLISH_LOG_RATE 100
+
+/*
+ * Wire format of events and of the service channel, see serialization.
+ * Version 1 (default) is the boost text archive, version 2 the compact
+ * binary encoding. Readers take both; set "wire_version": "2" once no
+ * subscriber built before version 2 runs. Other values are logged and
+ * ignored.
+ */
+#define WIRE_VERSION_KEY "wire_version"
+#define EVENTS_WIRE_TEXT 1
+#define EVENTS_WIRE_BINARY 2
+
 /* init config from file */
 void read_init_config(const char *fname);
 
@@ -168,12 +186,18 @@ T get_config_data(const string key, T def)
 }
 
 
+/*
+ * Current time as "2022-08-17T02:39:21.286611Z". The part up to the
+ * seconds is formatted once per second and thread.
+ */
 const string get_timestamp();
 
 /*
  * events are published as two part zmq message.
- * First part only has the event source, so receivers could
- * filter by source.
+ * First part is the topic "<source>:<tag>", control messages use the tag
+ * of their control string. With wire version 2 subscribers filter on its
+ * serialized form with ZMQ prefix subscriptions, see
+ * events_topic_filters(); with the text format they filter on receive.
  *
  * Second part contains serialized form of map as defined in internal_event_t.
  */
@@ -213,6 +237,27 @@ typedef string runtime_id_t;
 /* The internal code that caches runtime-IDs could retire upon de-init */
 #define EVENT_STR_CTRL_DEINIT EVENT_STR_CTRL_PREFIX "DEINIT"
 
+/*
+ * Start of every text archive, the topic of wire version 1 publishers.
+ * Its length prefix hides the topic, so those are filtered on receive.
+ */
+#define EVENTS_TEXT_ARCHIVE_PREFIX "22 serialization::archive"
+
+/*
+ * ZMQ subscriptions receiving the events of the given "<source>" or
+ * "<source>:<tag>" filters, and the control messages of their sources.
+ * Text topics can't be matched by prefix, so they are let through for
+ * the receiver to filter. No filters, or wire version 1 (the default),
+ * subscribes to everything and leaves all filtering to the receiver.
+ */
+vector<string> events_topic_filters(const vector<string> &filters);
+
+/*
+ * Prefix of the event string (EVENT_STR_DATA) of the events a filter
+ * wants: '{"<source>:' or '{"<source>:<tag>"'.
+ */
+string events_str_filter(const string &filter);
+
 typedef vector<internal_event_t> internal_events_lst_t;
 
 /* Cache maintains the part 2 of an event as serialized string. */
@@ -223,6 +268,52 @@ typedef vector<event_serialized_t> event_serialized_lst_t; // events_data_lst_t;
 sequence_t str_to_seq(const string s);
 string seq_to_str(sequence_t seq);
 
+/* Configured wire version, EVENTS_WIRE_TEXT or EVENTS_WIRE_BINARY */
+int events_wire_version();
+
+/*
+ * Binary encoding of wire version 2:
+ *
+ *   <EVENTS_BINARY_MAGIC> <EVENTS_BINARY_FORMAT> <kind> <payload>
+ *
+ *   kind 'S': string      - the bytes of the string
+ *   kind 'L': string list - <count> then <len><bytes> per element
+ *   kind 'M': string map  - <count> then <len><key><len><value> per pair
+ *
+ * Counts and lengths are LEB128 varints. A boost text archive starts with
+ * a digit, so the magic tells the two versions apart. Decoders reject a
+ * format they don't know, a newer one is given a new format byte.
+ *
+ * Other types have no binary form and always use the text archive.
+ */
+#define EVENTS_BINARY_MAGIC ((char)0xEB)
+#define EVENTS_BINARY_FORMAT 1
+
+bool is_binary_serialized(const char *data, size_t size);
+
+bool binary_encode(const string &data, string &s);
+bool binary_encode(const map_str_str_t &data, string &s);
+bool binary_encode(const vector<string> &data, string &s);
+
+template <typename T>
+bool
+binary_encode(const T &, string &)
+{
+    return false;
+}
+
+int binary_decode(const char *data, size_t size, string &out);
+int binary_decode(const char *data, size_t size, map_str_str_t &out);
+int binary_decode(const char *data, size_t size, vector<string> &out);
+
+template <typename T>
+int
+binary_decode(const char *, size_t, T &data)
+{
+    SWSS_LOG_ERROR("deserialize Failed: no binary form of %s", get_typename(data).c_str());
+    return ERR_MESSAGE_INVALID;
+}
+
 struct serialization
 {
     /*
@@ -231,12 +322,19 @@ struct serialization
      * but that class needs some additional support, that declares
      * boost::serialization::access as private friend and couple more tweaks.
      * The std::map & vector inherently supports serialization.
+     *
+     * Strings, maps and lists of strings use the binary encoding unless
+     * wire version 1 is configured.
      */
     template <typename Map>
     int
     serialize(const Map& data, string &s)
     {
         s.clear();
+        if ((events_wire_version() >= EVENTS_WIRE_BINARY) && binary_encode(data, s)) {
+            return 0;
+        }
+
         ostringstream _ser_ss;
 
         try {
@@ -258,6 +356,9 @@ struct serialization
     int
     deserialize(const string& s, Map& data)
     {
+        if (is_binary_serialized(s.data(), s.size())) {
+            return binary_decode(s.data(), s.size(), data);
+        }
 
         try {
             istringstream ss(s);
@@ -286,7 +387,8 @@ struct serialization
             rc = zmq_msg_init_size(&msg, s.size());
         }
         if (rc == 0) {
-            strncpy((char *)zmq_msg_data(&msg), s.c_str(), s.size());
+            /* Binary encoding has NUL bytes */
+            memcpy(zmq_msg_data(&msg), s.data(), s.size());
         }
         return rc;
     }
@@ -296,7 +398,13 @@ struct serialization
     int
     zmsg_to_map(zmq_msg_t &msg, Map& data)
     {
-        string s((const char *)zmq_msg_data(&msg), zmq_msg_size(&msg));
+        const char *p = (const char *)zmq_msg_data(&msg);
+        size_t sz = zmq_msg_size(&msg);
+
+        if (is_binary_serialized(p, sz)) {
+            return binary_decode(p, sz, data);
+        }
+        string s(p, sz);
         return deserialize(s, data);
     }
 
@@ -445,6 +553,13 @@ zmq_message_read(void *sock, int flag, P1 &pt1, P2 &pt2)
 /* Convert {<key>: < params >tttt a JSON string */
 string convert_to_json(const string key, const map_str_str_t &params);
 
+/*
+ * Same, with a "timestamp" param of value ts added unless params has one.
+ * Saves copying params to add it.
+ */
+string convert_to_json(const string &key, const map_str_str_t &params,
+        const string &ts);
+
 /* Parse JSON string into {<key>: < params >} */
 int convert_from_json(const string json_str, string &key, map_str_str_t &params);
 
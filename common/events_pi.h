@@ -52,6 +52,8 @@ class EventPublisher : public events_base
         static void drop_publisher(event_handle_t handle);
         static int do_publish(event_handle_t handle, const string tag,
                 const event_params_t *params);
+        static int do_publish_batch(event_handle_t handle,
+                const vector<event_publish_entry_t> &events);
 
     private:
         EventPublisher();
@@ -60,9 +62,19 @@ class EventPublisher : public events_base
 
         int publish(const string event_tag,
                 const event_params_t *params);
-        int send_evt(const string str_data);
+        int publish_batch(const vector<event_publish_entry_t> &events);
+
+        /* Per call work of publish, returns the timestamp to add */
+        string prepare_publish();
+        int publish_one(const string &event_tag, const event_params_t &params,
+                const string &ts);
+
+        int send_evt(const string &topic, const string str_data);
         void remove_runtime_id();
 
+        /* EVENT_PUBLISHED syslog, rate limited by m_log_rate */
+        void log_published(const string &str_data);
+
         void *m_zmq_ctx;
         void *m_socket;
 
@@ -77,6 +89,14 @@ class EventPublisher : public events_base
 
         /* A running sequence number for events published by this instance */
         sequence_t m_sequence;
+
+        /* EVENT_PUBLISHED lines allowed per second */
+        uint32_t m_log_rate;
+
+        /* Second of m_log_cnt, events logged and not logged in it */
+        time_t m_log_sec;
+        uint32_t m_log_cnt;
+        uint32_t m_log_suppressed;
 };
 
 /*
@@ -145,6 +165,14 @@ class EventSubscriber : public events_base
         /* Prune the m_track, when goes beyond max - MAX_PUBLISHERS_COUNT */
         void prune_track();
 
+        /*
+         * Event string prefixes of the subscribed sources & tags, see
+         * events_str_filter(). Empty receives all.
+         */
+        vector<string> m_filters;
+
+        bool is_wanted(const string &event_str) const;
+
 
         /*
          * List of cached events.
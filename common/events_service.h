@@ -172,6 +172,11 @@ class event_service {
          *  The receiver API will compute the missed in the same way for
          *  events read from subscription channel & as well from cache.
          *
+         *  event_cache (events_cache.h) is a ring with a byte budget for
+         *  the service, which drops the oldest events instead and may be
+         *  backed by a file to survive restarts. Its read returns a chunk
+         *  per call.
+         *
          *  output: 
          *      lst - A set of events, with a max cap.
          *            Hence multiple reads may be required to read all.
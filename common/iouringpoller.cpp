@@ -0,0 +1,380 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+
+#include "common/armhelper.h"
+#include "common/logger.h"
+#include "common/iouringpoller.h"
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_EXT_ARG)
+#define SWSS_IO_URING 1
+#endif
+#endif
+
+using namespace std;
+
+namespace swss {
+
+#ifdef SWSS_IO_URING
+
+static inline uint64_t makeUserData(int fd, uint32_t generation)
+{
+    return ((uint64_t)generation << 32) | (uint32_t)fd;
+}
+
+static inline int userDataFd(uint64_t userData)
+{
+    return (int)(uint32_t)(userData & 0xffffffff);
+}
+
+static inline uint32_t userDataGeneration(uint64_t userData)
+{
+    return (uint32_t)(userData >> 32);
+}
+
+static int ioUringSetup(unsigned int entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int ioUringEnter(int fd, unsigned int toSubmit, unsigned int minComplete,
+                        unsigned int flags, const void *arg, size_t argsz)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, flags, arg, argsz);
+}
+
+IoUringPoller::IoUringPoller(unsigned int entries)
+    : m_ringFd(-1)
+    , m_sqRing(MAP_FAILED)
+    , m_sqRingSize(0)
+    , m_cqRing(MAP_FAILED)
+    , m_cqRingSize(0)
+    , m_sqes(MAP_FAILED)
+    , m_sqesSize(0)
+    , m_pending(0)
+    , m_nextGeneration(0)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    m_ringFd = ioUringSetup(entries, &params);
+    if (m_ringFd < 0)
+    {
+        throw runtime_error(string("IoUringPoller: io_uring_setup failed: ") + strerror(errno));
+    }
+
+    if (!(params.features & IORING_FEAT_EXT_ARG) || !(params.features & IORING_FEAT_NODROP))
+    {
+        close(m_ringFd);
+        throw runtime_error("IoUringPoller: kernel lacks IORING_FEAT_EXT_ARG/IORING_FEAT_NODROP");
+    }
+
+    m_sqEntries = params.sq_entries;
+    m_cqEntries = params.cq_entries;
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    m_cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        m_sqRingSize = m_cqRingSize = max(m_sqRingSize, m_cqRingSize);
+    }
+
+    m_sqRing = mmap(nullptr, m_sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    m_ringFd, IORING_OFF_SQ_RING);
+    if (m_sqRing != MAP_FAILED)
+    {
+        if (params.features & IORING_FEAT_SINGLE_MMAP)
+        {
+            m_cqRing = m_sqRing;
+        }
+        else
+        {
+            m_cqRing = mmap(nullptr, m_cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                            m_ringFd, IORING_OFF_CQ_RING);
+        }
+    }
+
+    m_sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    if (m_cqRing != MAP_FAILED)
+    {
+        m_sqes = mmap(nullptr, m_sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      m_ringFd, IORING_OFF_SQES);
+    }
+
+    if (m_sqes == MAP_FAILED)
+    {
+        int err = errno;
+        release();
+        throw runtime_error(string("IoUringPoller: mmap failed: ") + strerror(err));
+    }
+
+    char *sq = static_cast<char *>(m_sqRing);
+    char *cq = static_cast<char *>(m_cqRing);
+
+    WARNINGS_NO_CAST_ALIGN;
+    m_sqHead = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+    m_sqMask = reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+    m_cqHead = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+    m_cqMask = reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+    WARNINGS_RESET;
+    m_cqes = cq + params.cq_off.cqes;
+}
+
+IoUringPoller::~IoUringPoller()
+{
+    release();
+}
+
+void IoUringPoller::release()
+{
+    if (m_sqes != MAP_FAILED)
+    {
+        munmap(m_sqes, m_sqesSize);
+        m_sqes = MAP_FAILED;
+    }
+
+    if (m_cqRing != MAP_FAILED && m_cqRing != m_sqRing)
+    {
+        munmap(m_cqRing, m_cqRingSize);
+    }
+    m_cqRing = MAP_FAILED;
+
+    if (m_sqRing != MAP_FAILED)
+    {
+        munmap(m_sqRing, m_sqRingSize);
+        m_sqRing = MAP_FAILED;
+    }
+
+    if (m_ringFd >= 0)
+    {
+        close(m_ringFd);
+        m_ringFd = -1;
+    }
+}
+
+bool IoUringPoller::isSupported()
+{
+    try
+    {
+        IoUringPoller probe(1);
+        return true;
+    }
+    catch (const runtime_error &e)
+    {
+        SWSS_LOG_INFO("io_uring is not usable: %s", e.what());
+        return false;
+    }
+}
+
+void IoUringPoller::add(int fd)
+{
+    uint32_t generation = m_nextGeneration++;
+    m_fds[fd] = generation;
+    queuePoll(fd, generation);
+}
+
+void IoUringPoller::remove(int fd)
+{
+    auto it = m_fds.find(fd);
+    if (it == m_fds.end())
+    {
+        return;
+    }
+
+    queueRemove(fd, it->second);
+    m_fds.erase(it);
+}
+
+void IoUringPoller::queuePoll(int fd, uint32_t generation)
+{
+    if (m_pending == m_sqEntries && submit(0, 0) < 0)
+    {
+        SWSS_LOG_THROW("IoUringPoller: failed to flush submission queue: %s", strerror(errno));
+    }
+
+    unsigned int tail = *m_sqTail;
+    unsigned int index = tail & *m_sqMask;
+    struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(m_sqes) + index;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = makeUserData(fd, generation);
+
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+    m_pending++;
+}
+
+void IoUringPoller::queueRemove(int fd, uint32_t generation)
+{
+    if (m_pending == m_sqEntries && submit(0, 0) < 0)
+    {
+        SWSS_LOG_THROW("IoUringPoller: failed to flush submission queue: %s", strerror(errno));
+    }
+
+    unsigned int tail = *m_sqTail;
+    unsigned int index = tail & *m_sqMask;
+    struct io_uring_sqe *sqe = static_cast<struct io_uring_sqe *>(m_sqes) + index;
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(fd, generation);
+    // The removal's own completion carries no fd generation and is ignored.
+    sqe->user_data = makeUserData(-1, 0);
+
+    m_sqArray[index] = index;
+    __atomic_store_n(m_sqTail, tail + 1, __ATOMIC_RELEASE);
+    m_pending++;
+}
+
+int IoUringPoller::submit(unsigned int minComplete, int timeout)
+{
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+
+    if (timeout >= 0)
+    {
+        ts.tv_sec = timeout / 1000;
+        ts.tv_nsec = (timeout % 1000) * 1000000LL;
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+    }
+
+    unsigned int flags = IORING_ENTER_EXT_ARG;
+    if (minComplete > 0)
+    {
+        flags |= IORING_ENTER_GETEVENTS;
+    }
+
+    int ret = ioUringEnter(m_ringFd, m_pending, minComplete, flags, &arg, sizeof(arg));
+    if (ret >= 0)
+    {
+        m_pending -= min((unsigned int)ret, m_pending);
+    }
+
+    return ret;
+}
+
+void IoUringPoller::reap(std::vector<int> &fds)
+{
+    unsigned int head = *m_cqHead;
+    unsigned int tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+
+    while (head != tail)
+    {
+        const struct io_uring_cqe *cqe = static_cast<const struct io_uring_cqe *>(m_cqes) + (head & *m_cqMask);
+        int fd = userDataFd(cqe->user_data);
+        uint32_t generation = userDataGeneration(cqe->user_data);
+        int res = cqe->res;
+        head++;
+
+        auto it = m_fds.find(fd);
+        if (it == m_fds.end() || it->second != generation)
+        {
+            // Removed fd, or the completion of a POLL_REMOVE request.
+            continue;
+        }
+
+        if (res < 0)
+        {
+            SWSS_LOG_WARN("IoUringPoller: poll on fd %d failed: %s, re-arming", fd, strerror(-res));
+            m_rearm.emplace_back(fd, generation);
+            continue;
+        }
+
+        fds.push_back(fd);
+        m_rearm.emplace_back(fd, generation);
+    }
+
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+}
+
+int IoUringPoller::wait(std::vector<int> &fds, int timeout)
+{
+    for (const auto &rearm : m_rearm)
+    {
+        auto it = m_fds.find(rearm.first);
+        if (it != m_fds.end() && it->second == rearm.second)
+        {
+            queuePoll(rearm.first, rearm.second);
+        }
+    }
+    m_rearm.clear();
+
+    size_t before = fds.size();
+
+    while (true)
+    {
+        int ret = submit(timeout == 0 ? 0 : 1, timeout);
+        int err = ret < 0 ? errno : 0;
+        if (err != 0 && err != ETIME && err != EBUSY)
+        {
+            // EINTR included: let Select decide whether to retry.
+            return -1;
+        }
+
+        reap(fds);
+
+        // A completion may only have been a stale one for a removed fd, in
+        // which case there is nothing to report and we keep waiting. The
+        // original timeout is restarted, which is acceptable for Select.
+        if (fds.size() != before || timeout == 0 || err == ETIME)
+        {
+            break;
+        }
+    }
+
+    return (int)(fds.size() - before);
+}
+
+#else
+
+IoUringPoller::IoUringPoller(unsigned int)
+    : m_ringFd(-1)
+{
+    throw runtime_error("IoUringPoller: io_uring support is not compiled in");
+}
+
+IoUringPoller::~IoUringPoller()
+{
+}
+
+bool IoUringPoller::isSupported()
+{
+    return false;
+}
+
+void IoUringPoller::add(int)
+{
+}
+
+void IoUringPoller::remove(int)
+{
+}
+
+int IoUringPoller::wait(std::vector<int> &, int)
+{
+    errno = ENOSYS;
+    return -1;
+}
+
+#endif
+
+}
@@ -0,0 +1,101 @@
+#ifndef __IOURINGPOLLER__
+#define __IOURINGPOLLER__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace swss {
+
+/*
+ * Readiness poller built directly on the io_uring syscalls, used by Select as
+ * an alternative to epoll. Every registered fd has a one-shot POLL_ADD in
+ * flight; fds reported ready are re-armed on the next wait(), and the re-arm
+ * submissions share the io_uring_enter() call that waits for completions, so
+ * a wakeup costs a single syscall. A one-shot poll completes immediately when
+ * the fd is already readable, which keeps the level-triggered semantics that
+ * Selectable implementations rely on.
+ *
+ * The backend is only compiled in when linux/io_uring.h is available at build
+ * time (see --enable-iouring). isSupported() additionally probes the running
+ * kernel, so callers can fall back to epoll when io_uring is unavailable.
+ */
+class IoUringPoller
+{
+public:
+    IoUringPoller(unsigned int entries = DEFAULT_ENTRIES);
+    ~IoUringPoller();
+
+    static constexpr unsigned int DEFAULT_ENTRIES = 256;
+
+    /* true if the backend is compiled in and usable on the running kernel */
+    static bool isSupported();
+
+    void add(int fd);
+
+    void remove(int fd);
+
+    /*
+     * Wait up to timeout milliseconds (-1 blocks, 0 only reaps) and append the
+     * fds which became readable to fds. Returns the number of ready fds, or -1
+     * with errno set (EINTR when interrupted by a signal).
+     */
+    int wait(std::vector<int> &fds, int timeout);
+
+private:
+    void release();
+
+    void queuePoll(int fd, uint32_t generation);
+
+    void queueRemove(int fd, uint32_t generation);
+
+    int submit(unsigned int minComplete, int timeout);
+
+    void reap(std::vector<int> &fds);
+
+    int m_ringFd;
+
+    unsigned int m_sqEntries;
+    unsigned int m_cqEntries;
+
+    void *m_sqRing;
+    size_t m_sqRingSize;
+    void *m_cqRing;
+    size_t m_cqRingSize;
+    void *m_sqes;
+    size_t m_sqesSize;
+
+    unsigned int *m_sqHead;
+    unsigned int *m_sqTail;
+    unsigned int *m_sqMask;
+    unsigned int *m_sqArray;
+    unsigned int *m_cqHead;
+    unsigned int *m_cqTail;
+    unsigned int *m_cqMask;
+    void *m_cqes;
+
+    /* number of SQEs queued but not yet passed to io_uring_enter() */
+    unsigned int m_pending;
+
+    /*
+     * Registered fds and their generation. The generation is encoded in each
+     * request's user_data so completions of a removed (and possibly reused)
+     * fd are ignored.
+     */
+    std::unordered_map<int, uint32_t> m_fds;
+
+    uint32_t m_nextGeneration;
+
+    /*
+     * fds reported by the previous wait() and their generation, re-armed on
+     * the next one unless they were removed or re-added meanwhile: add()
+     * already armed a poll for the new generation.
+     */
+    std::vector<std::pair<int, uint32_t>> m_rearm;
+};
+
+}
+
+#endif
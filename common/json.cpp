@@ -11,8 +11,284 @@ using namespace std;
 
 namespace swss {
 
+// Append str as a JSON string the way nlohmann::json::dump() does. Returns
+// false for non-ASCII text, which dump() validates as UTF-8.
+bool JSon::appendString(string &out, const string &str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    out += '"';
+    for (char c : str)
+    {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (u >= 0x80)
+        {
+            return false;
+        }
+
+        switch (c)
+        {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (u < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[u >> 4];
+                    out += hex[u & 0xf];
+                }
+                else
+                {
+                    out += c;
+                }
+                break;
+        }
+    }
+    out += '"';
+
+    return true;
+}
+
+static void skipSpace(const string &json, size_t &pos)
+{
+    while (pos < json.size() && (json[pos] == ' ' || json[pos] == '\t' || json[pos] == '\n' || json[pos] == '\r'))
+    {
+        pos++;
+    }
+}
+
+static bool readHex4(const string &json, size_t pos, unsigned int &value)
+{
+    if (pos + 4 > json.size())
+    {
+        return false;
+    }
+
+    value = 0;
+    for (size_t i = pos; i < pos + 4; i++)
+    {
+        char c = json[i];
+        value <<= 4;
+        if (c >= '0' && c <= '9')
+            value |= (unsigned int)(c - '0');
+        else if (c >= 'a' && c <= 'f')
+            value |= (unsigned int)(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F')
+            value |= (unsigned int)(c - 'A' + 10);
+        else
+            return false;
+    }
+
+    return true;
+}
+
+static void appendUtf8(string &out, unsigned int cp)
+{
+    if (cp < 0x80)
+    {
+        out += (char)cp;
+    }
+    else if (cp < 0x800)
+    {
+        out += (char)(0xc0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000)
+    {
+        out += (char)(0xe0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+    else
+    {
+        out += (char)(0xf0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3f));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+}
+
+size_t JSon::readString(const string &json, size_t pos, string &out)
+{
+    if (pos >= json.size() || json[pos] != '"')
+    {
+        return string::npos;
+    }
+    pos++;
+
+    out.clear();
+    while (pos < json.size())
+    {
+        // Copy the run up to the next quote or escape in one go.
+        size_t end = pos;
+        while (end < json.size() && json[end] != '"' && json[end] != '\\')
+        {
+            unsigned char u = static_cast<unsigned char>(json[end]);
+            if (u < 0x20 || u >= 0x80)
+            {
+                return string::npos;
+            }
+            end++;
+        }
+        out.append(json, pos, end - pos);
+        pos = end;
+
+        if (pos >= json.size())
+        {
+            break;
+        }
+
+        if (json[pos] == '"')
+        {
+            return pos + 1;
+        }
+
+        if (++pos >= json.size())
+        {
+            break;
+        }
+
+        switch (json[pos++])
+        {
+            case '"':  out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/':  out += '/'; break;
+            case 'b':  out += '\b'; break;
+            case 'f':  out += '\f'; break;
+            case 'n':  out += '\n'; break;
+            case 'r':  out += '\r'; break;
+            case 't':  out += '\t'; break;
+            case 'u':
+            {
+                unsigned int cp;
+                if (!readHex4(json, pos, cp))
+                {
+                    return string::npos;
+                }
+                pos += 4;
+
+                if (cp >= 0xd800 && cp <= 0xdbff)
+                {
+                    unsigned int low;
+                    if (pos + 2 > json.size() || json[pos] != '\\' || json[pos + 1] != 'u'
+                        || !readHex4(json, pos + 2, low) || low < 0xdc00 || low > 0xdfff)
+                    {
+                        return string::npos;
+                    }
+                    pos += 6;
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+                }
+                else if (cp >= 0xdc00 && cp <= 0xdfff)
+                {
+                    return string::npos;
+                }
+
+                appendUtf8(out, cp);
+                break;
+            }
+            default:
+                return string::npos;
+        }
+    }
+
+    return string::npos;
+}
+
+// Decode a flat array of strings with an even count into fv. Returns false,
+// leaving fv as it was, for anything else.
+static bool readStringPairs(const string &json, vector<FieldValueTuple> &fv)
+{
+    size_t original = fv.size();
+    size_t pos = 0;
+
+    skipSpace(json, pos);
+    if (pos >= json.size() || json[pos] != '[')
+    {
+        return false;
+    }
+    pos++;
+    skipSpace(json, pos);
+
+    bool field = true;
+    if (pos < json.size() && json[pos] == ']')
+    {
+        pos++;
+    }
+    else
+    {
+        while (true)
+        {
+            if (field)
+            {
+                fv.emplace_back();
+            }
+
+            string &out = field ? fvField(fv.back()) : fvValue(fv.back());
+            pos = JSon::readString(json, pos, out);
+            if (pos == string::npos)
+            {
+                fv.resize(original);
+                return false;
+            }
+            field = !field;
+
+            skipSpace(json, pos);
+            if (pos < json.size() && json[pos] == ',')
+            {
+                pos++;
+                skipSpace(json, pos);
+                continue;
+            }
+
+            if (pos < json.size() && json[pos] == ']')
+            {
+                pos++;
+                break;
+            }
+
+            fv.resize(original);
+            return false;
+        }
+    }
+
+    skipSpace(json, pos);
+    if (!field || pos != json.size())
+    {
+        fv.resize(original);
+        return false;
+    }
+
+    return true;
+}
+
 string JSon::buildJson(const vector<FieldValueTuple> &fv)
 {
+    string json = "[";
+    bool ascii = true;
+    for (auto it = fv.begin(); ascii && it != fv.end(); ++it)
+    {
+        if (it != fv.begin())
+        {
+            json += ',';
+        }
+
+        ascii = appendString(json, fvField(*it));
+        json += ',';
+        ascii = ascii && appendString(json, fvValue(*it));
+    }
+
+    if (ascii)
+    {
+        json += ']';
+        return json;
+    }
+
+    // nlohmann::json validates non-ASCII text as UTF-8.
     nlohmann::json j = nlohmann::json::array();
 
     // we use array to save order
@@ -27,6 +303,24 @@ string JSon::buildJson(const vector<FieldValueTuple> &fv)
 
 string JSon::buildJson(const char** values)
 {
+    string json = "[";
+    bool ascii = true;
+    for (const char** value = values; ascii && *value; value++)
+    {
+        if (value != values)
+        {
+            json += ',';
+        }
+
+        ascii = appendString(json, *value);
+    }
+
+    if (ascii)
+    {
+        json += ']';
+        return json;
+    }
+
     nlohmann::json j = nlohmann::json::array();
 
     while (*values)
@@ -40,6 +334,11 @@ string JSon::buildJson(const char** values)
 
 void JSon::readJson(const string &jsonstr, vector<FieldValueTuple> &fv)
 {
+    if (readStringPairs(jsonstr, fv))
+    {
+        return;
+    }
+
     nlohmann::json j = nlohmann::json::parse(jsonstr);
 
     FieldValueTuple e;
@@ -18,9 +18,29 @@ private:
      */
     static const int el_count = 2;
 public:
+    /*
+     * buildJson() and readJson() handle the flat arrays of strings used by
+     * notifications and producer tables directly, without building a
+     * nlohmann::json document. Anything the fast path doesn't cover, such
+     * as non-ASCII text, falls back to nlohmann::json, so results and
+     * errors are the same either way.
+     */
     static std::string buildJson(const std::vector<FieldValueTuple> &fv);
     static std::string buildJson(const char** values);
     static void readJson(const std::string &json, std::vector<FieldValueTuple> &fv);
+
+    /*
+     * Decode the JSON string starting with the quote at json[pos] into out,
+     * reusing its buffer. Returns the position after the closing quote, or
+     * std::string::npos if the string is malformed or not plain ASCII.
+     */
+    static size_t readString(const std::string &json, size_t pos, std::string &out);
+
+    /*
+     * Append str to out as a JSON string, the way nlohmann::json dumps it.
+     * Returns false, with out partly written, if str is not plain ASCII.
+     */
+    static bool appendString(std::string &out, const std::string &str);
     /*
        bool loadJsonFromFile(std::ifstream &fs, std::vector<KeyOpFieldsValuesTuple> &db_items);
 
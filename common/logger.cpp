@@ -30,12 +30,22 @@ void swss::err_exit(const char *fn, int ln, int e, const char *fmt, ...)
     vsnprintf(buff+len, sizeof(buff)-len, fmt, ap);
     va_end(ap);
     SWSS_LOG_ERROR("Aborting: %s", buff);
+    Logger::flush();
     abort();
 }
 
 Logger::~Logger()
 {
     terminateSettingThread();
+
+    // Messages queued so far are written, the AsyncLogger is left to the
+    // process exit.
+    m_asyncEnabled = false;
+    AsyncLogger *async = m_async;
+    if (async)
+    {
+        async->flush();
+    }
 }
 
 void Logger::terminateSettingThread()
@@ -165,7 +175,23 @@ void Logger::linkToDbNative(const std::string& dbName, const char * defPrio)
 {
     linkToDb(dbName, swssPrioNotify, defPrio);
 
-    getInstance().restartSettingThread();
+    auto& logger = getInstance();
+    logger.m_nativeComponent = dbName;
+
+    // No defaults are written, the built-in limits apply without the fields.
+    DBConnector db("CONFIG_DB", 0);
+    swss::Table table(&db, CFG_LOGGER_TABLE_NAME);
+    std::string value;
+    if (table.hget(dbName, DAEMON_LOGRATE, value))
+    {
+        parseRateLimit(DAEMON_LOGRATE, value);
+    }
+    if (table.hget(dbName, DAEMON_LOGBURST, value))
+    {
+        parseRateLimit(DAEMON_LOGBURST, value);
+    }
+
+    logger.restartSettingThread();
 }
 
 void Logger::restartLogger()
@@ -189,6 +215,181 @@ Logger::Priority Logger::getMinPrio()
     return getInstance().m_minPrio;
 }
 
+void Logger::setAsync(bool enable, size_t ringSize)
+{
+    auto& logger = getInstance();
+
+    if (enable)
+    {
+        {
+            MUTEX;
+
+            if (!logger.m_async)
+            {
+                logger.m_async = new AsyncLogger([&logger](int prio, const char *text, size_t size) {
+                    logger.writeMessage(prio, text, size);
+                }, ringSize);
+            }
+        }
+
+        logger.m_asyncEnabled = true;
+    }
+    else if (logger.m_asyncEnabled.exchange(false))
+    {
+        logger.m_async.load()->flush();
+    }
+}
+
+bool Logger::isAsync()
+{
+    return getInstance().m_asyncEnabled;
+}
+
+void Logger::flush()
+{
+    auto& logger = getInstance();
+
+    if (logger.m_asyncEnabled)
+    {
+        logger.m_async.load()->flush();
+    }
+}
+
+AsyncLogger::Stats Logger::getAsyncStats()
+{
+    AsyncLogger *async = getInstance().m_async;
+
+    if (!async)
+    {
+        return AsyncLogger::Stats();
+    }
+
+    return async->getStats();
+}
+
+constexpr uint32_t Logger::DEFAULT_LOG_RATE;
+constexpr uint32_t Logger::DEFAULT_LOG_BURST;
+
+void Logger::setRateLimit(uint32_t rate, uint32_t burst)
+{
+    auto& logger = getInstance();
+
+    logger.m_logRate = rate;
+    logger.m_logBurst = burst;
+}
+
+void Logger::parseRateLimit(const std::string& field, const std::string& value)
+{
+    auto& logger = getInstance();
+    uint32_t limit;
+
+    try
+    {
+        size_t end;
+        unsigned long parsed = std::stoul(value, &end);
+        if (end != value.size() || parsed > UINT32_MAX)
+        {
+            throw std::out_of_range(value);
+        }
+        limit = (uint32_t)parsed;
+    }
+    catch (const std::exception&)
+    {
+        SWSS_LOG_ERROR("Invalid %s %s, keeping %u", field.c_str(), value.c_str(),
+                       field == DAEMON_LOGRATE ? logger.m_logRate.load() : logger.m_logBurst.load());
+        return;
+    }
+
+    SWSS_LOG_NOTICE("Changing %s to %u", field.c_str(), limit);
+    if (field == DAEMON_LOGRATE)
+    {
+        logger.m_logRate = limit;
+    }
+    else
+    {
+        logger.m_logBurst = limit;
+    }
+}
+
+bool Logger::RateLimiter::allow(Priority prio, const char *function, int line, uint64_t &suppressed)
+{
+    auto& logger = getInstance();
+
+    suppressed = 0;
+
+    uint32_t rate = logger.m_logRate.load(std::memory_order_relaxed);
+    if (rate != 0)
+    {
+        uint32_t burst = std::max<uint32_t>(logger.m_logBurst.load(std::memory_order_relaxed), 1);
+        int64_t interval = 1000000000LL / rate;
+        int64_t now = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+
+        int64_t tat = m_tat.load(std::memory_order_relaxed);
+        int64_t next;
+        do
+        {
+            next = std::max(tat, now) + interval;
+            if (next - now > interval * burst)
+            {
+                if (m_suppressed.fetch_add(1, std::memory_order_relaxed) == 0
+                    && !m_registered.load(std::memory_order_acquire))
+                {
+                    std::lock_guard<std::mutex> lock(logger.m_limitersMutex);
+                    if (!m_registered.load(std::memory_order_relaxed))
+                    {
+                        m_prio = prio;
+                        m_function = function;
+                        m_line = line;
+                        logger.m_limiters.push_back(this);
+                        m_registered.store(true, std::memory_order_release);
+                    }
+                }
+
+                return false;
+            }
+        }
+        while (!m_tat.compare_exchange_weak(tat, next, std::memory_order_relaxed));
+    }
+
+    if (m_suppressed.load(std::memory_order_relaxed) != 0)
+    {
+        suppressed = m_suppressed.exchange(0, std::memory_order_relaxed);
+    }
+
+    return true;
+}
+
+void Logger::reportSuppressed()
+{
+    auto& logger = getInstance();
+
+    std::lock_guard<std::mutex> lock(logger.m_limitersMutex);
+    for (auto limiter : logger.m_limiters)
+    {
+        uint64_t suppressed = limiter->m_suppressed.exchange(0, std::memory_order_relaxed);
+        if (suppressed != 0)
+        {
+            logger.write(limiter->m_prio, ":- %s: %llu messages suppressed at line %d",
+                         limiter->m_function, (unsigned long long)suppressed, limiter->m_line);
+        }
+    }
+}
+
+void Logger::writeMessage(int prio, const char *text, size_t size)
+{
+    if (m_output == SWSS_SYSLOG)
+    {
+        syslog(prio, "%.*s", (int)size, text);
+        return;
+    }
+
+    MUTEX;
+
+    FILE *stream = (m_output == SWSS_STDOUT) ? stdout : stderr;
+    fprintf(stream, "%6s%.*s\n", priorityToString((Priority)prio).c_str(), (int)size, text);
+}
+
 void Logger::settingThread()
 {
     Select select;
@@ -199,6 +400,8 @@ void Logger::settingThread()
     select.addSelectable(table.get());
     select.addSelectable(m_stopEvent.get());
 
+    auto lastReport = std::chrono::steady_clock::now();
+
     while (1)
     {
 
@@ -207,6 +410,13 @@ void Logger::settingThread()
         /* TODO Resolve latency caused by timeout at initialization. */
         int ret = select.select(&selectable, 1000); // Timeout if there is no data in 1000 ms.
 
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastReport >= std::chrono::seconds(1))
+        {
+            reportSuppressed();
+            lastReport = now;
+        }
+
         if (ret == Select::ERROR)
         {
             SWSS_LOG_NOTICE("%s select error %s", __PRETTY_FUNCTION__, strerror(errno));
@@ -257,6 +467,10 @@ void Logger::settingThread()
                 m_currentOutputs.set(key, value);
                 m_settingChangeObservers.get(key).second(key, value);
             }
+            else if ((field == DAEMON_LOGRATE || field == DAEMON_LOGBURST) && key == m_nativeComponent)
+            {
+                parseRateLimit(field, value);
+            }
         }
     }
 }
@@ -272,7 +486,11 @@ void Logger::write(Priority prio, const char *fmt, ...)
     va_list ap;
     va_start(ap, fmt);
 
-    if (m_output == SWSS_SYSLOG)
+    if (m_asyncEnabled)
+    {
+        m_async.load()->log(prio, fmt, ap);
+    }
+    else if (m_output == SWSS_SYSLOG)
     {
         vsyslog(prio, fmt, ap);
     }
@@ -8,7 +8,9 @@
 #include <thread>
 #include <mutex>
 #include <functional>
+#include <vector>
 
+#include "asynclogger.h"
 #include "concurrentmap.h"
 #include "selectableevent.h"
 
@@ -20,6 +22,34 @@ namespace swss {
 #define SWSS_LOG_INFO(MSG, ...)        swss::Logger::getInstance().write(swss::Logger::SWSS_INFO,   ":- %s: " MSG, __FUNCTION__, ##__VA_ARGS__)
 #define SWSS_LOG_DEBUG(MSG, ...)       swss::Logger::getInstance().write(swss::Logger::SWSS_DEBUG,  ":- %s: " MSG, __FUNCTION__, ##__VA_ARGS__)
 
+/*
+ * Rate limited variants, for messages which may repeat in a loop. Each call
+ * site has a token bucket, see Logger::setRateLimit(). Messages over the
+ * limit are counted, the next message let through and the periodic summary
+ * of the setting thread report the count.
+ */
+#define SWSS_LOG_ERROR_RATELIMITED(MSG, ...)  SWSS_LOG_RATELIMITED(swss::Logger::SWSS_ERROR,  MSG, ##__VA_ARGS__)
+#define SWSS_LOG_WARN_RATELIMITED(MSG, ...)   SWSS_LOG_RATELIMITED(swss::Logger::SWSS_WARN,   MSG, ##__VA_ARGS__)
+#define SWSS_LOG_NOTICE_RATELIMITED(MSG, ...) SWSS_LOG_RATELIMITED(swss::Logger::SWSS_NOTICE, MSG, ##__VA_ARGS__)
+#define SWSS_LOG_INFO_RATELIMITED(MSG, ...)   SWSS_LOG_RATELIMITED(swss::Logger::SWSS_INFO,   MSG, ##__VA_ARGS__)
+#define SWSS_LOG_DEBUG_RATELIMITED(MSG, ...)  SWSS_LOG_RATELIMITED(swss::Logger::SWSS_DEBUG,  MSG, ##__VA_ARGS__)
+
+#define SWSS_LOG_RATELIMITED(PRIO, MSG, ...)                                                            \
+    do                                                                                                  \
+    {                                                                                                   \
+        static swss::Logger::RateLimiter _swssRateLimiter;                                              \
+        uint64_t _swssSuppressed;                                                                       \
+        if ((PRIO) <= swss::Logger::getMinPrio()                                                        \
+            && _swssRateLimiter.allow((PRIO), __FUNCTION__, __LINE__, _swssSuppressed))                 \
+        {                                                                                               \
+            if (_swssSuppressed == 0)                                                                   \
+                swss::Logger::getInstance().write((PRIO), ":- %s: " MSG, __FUNCTION__, ##__VA_ARGS__);  \
+            else                                                                                        \
+                swss::Logger::getInstance().write((PRIO), ":- %s: " MSG " (%llu similar messages suppressed)", \
+                        __FUNCTION__, ##__VA_ARGS__, (unsigned long long)_swssSuppressed);              \
+        }                                                                                               \
+    } while (0)
+
 #define SWSS_LOG_ENTER()               swss::Logger::ScopeLogger logger ## __LINE__ (__LINE__, __FUNCTION__)
 #define SWSS_LOG_TIMER(msg, ...)       swss::Logger::ScopeTimer scopetimer ## __LINE__ (__LINE__, __FUNCTION__, msg, ##__VA_ARGS__)
 
@@ -27,6 +57,8 @@ namespace swss {
 
 static constexpr const char * const DAEMON_LOGLEVEL = "LOGLEVEL";
 static constexpr const char * const DAEMON_LOGOUTPUT = "LOGOUTPUT";
+static constexpr const char * const DAEMON_LOGRATE = "LOGRATE";
+static constexpr const char * const DAEMON_LOGBURST = "LOGBURST";
 
 void err_exit(const char *fn, int ln, int e, const char *fmt, ...)
 #ifdef __GNUC__
@@ -93,6 +125,75 @@ public:
     // Must be called after all linkToDb to start select from DB
     static void linkToDbNative(const std::string& dbName, const char * defPrio="NOTICE");
     static void restartLogger();
+
+    /*
+     * Write log messages from a background thread, see AsyncLogger, so a
+     * burst of messages doesn't stall the logging threads. ringSize only
+     * applies to the first enable. Messages of SWSS_LOG_THROW and messages
+     * at SWSS_ERROR or above whose ring is full are still written
+     * synchronously.
+     */
+    static void setAsync(bool enable, size_t ringSize = AsyncLogger::DEFAULT_RING_SIZE);
+    static bool isAsync();
+
+    // Wait for the messages queued so far to be written.
+    static void flush();
+
+    static AsyncLogger::Stats getAsyncStats();
+
+    /*
+     * Messages per second and burst size allowed to each call site of the
+     * SWSS_LOG_*_RATELIMITED macros. A rate of 0 disables the limit.
+     * linkToDbNative() takes them from the LOGRATE and LOGBURST fields of
+     * the component, and follows their changes.
+     */
+    static constexpr uint32_t DEFAULT_LOG_RATE = 10;
+    static constexpr uint32_t DEFAULT_LOG_BURST = 100;
+
+    static void setRateLimit(uint32_t rate, uint32_t burst);
+
+    // Write the counts of messages suppressed since the last report. The
+    // setting thread calls it every second.
+    static void reportSuppressed();
+
+    /*
+     * Token bucket of a call site, as a theoretical arrival time (GCRA):
+     * a message passes if it doesn't push the time further than a burst
+     * ahead of now. Constant initialized and trivially destructible, so
+     * it is safe to use as a function local static anywhere.
+     */
+    class RateLimiter
+    {
+        public:
+
+            constexpr RateLimiter()
+                : m_tat(0)
+                , m_suppressed(0)
+                , m_registered(false)
+                , m_prio(SWSS_NOTICE)
+                , m_function(nullptr)
+                , m_line(0)
+            {
+            }
+
+            // suppressed is set to the count of messages held back since
+            // the last one that passed or was reported.
+            bool allow(Priority prio, const char *function, int line, uint64_t &suppressed);
+
+        private:
+
+            friend class Logger;
+
+            std::atomic<int64_t> m_tat;
+            std::atomic<uint64_t> m_suppressed;
+            std::atomic<bool> m_registered;
+
+            // Set under the registry mutex, for the summary.
+            Priority m_prio;
+            const char *m_function;
+            int m_line;
+    };
+
     void write(Priority prio, const char *fmt, ...)
 #ifdef __GNUC__
         __attribute__ ((format (printf, 3, 4)))
@@ -149,6 +250,10 @@ private:
 
     static void swssPrioNotify(const std::string& component, const std::string& prioStr);
 
+    void writeMessage(int prio, const char *text, size_t size);
+
+    static void parseRateLimit(const std::string& field, const std::string& value);
+
     void settingThread();
     void terminateSettingThread();
     void restartSettingThread();
@@ -163,6 +268,22 @@ private:
     std::unique_ptr<std::thread> m_settingThread;
     std::mutex m_mutex;
     std::unique_ptr<SelectableEvent> m_stopEvent;
+
+    // Created on the first setAsync(true) and never deleted: logging
+    // threads may still use it while the Logger is destroyed at exit, so
+    // ~Logger() only flushes it.
+    std::atomic<AsyncLogger*> m_async = { nullptr };
+    std::atomic<bool> m_asyncEnabled = { false };
+
+    std::atomic<uint32_t> m_logRate = { DEFAULT_LOG_RATE };
+    std::atomic<uint32_t> m_logBurst = { DEFAULT_LOG_BURST };
+
+    // Component whose LOGRATE and LOGBURST apply, see linkToDbNative().
+    std::string m_nativeComponent;
+
+    // Call sites which suppressed a message, never removed.
+    std::mutex m_limitersMutex;
+    std::vector<RateLimiter*> m_limiters;
 };
 
 }
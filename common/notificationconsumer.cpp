@@ -1,7 +1,9 @@
 #include "notificationconsumer.h"
+#include "notificationproducer.h"
 
 #include <iostream>
 #include <deque>
+#include <cstring>
 #include "redisapi.h"
 
 #define NOTIFICATION_SUBSCRIBE_TIMEOUT (1000)
@@ -23,16 +25,110 @@ constexpr std::chrono::seconds kStatsLogInterval{5};
 // frequency.
 constexpr uint64_t kStatsCheckEveryN = 1024;
 
+std::unique_ptr<swss::NotificationQueueBase> makeQueue(swss::NotificationQueuePolicy policy, const std::string &channel)
+{
+    switch (policy)
+    {
+        case swss::NotificationQueuePolicy::LruDedup:
+            return std::make_unique<swss::LruDedupNotificationQueue>(channel);
+        case swss::NotificationQueuePolicy::KeyedDedup:
+            return std::make_unique<swss::KeyedDedupNotificationQueue>(swss::notificationOpDataKey, channel);
+        default:
+            return std::make_unique<swss::FifoNotificationQueue>();
+    }
+}
+
 } // namespace
 
 std::string swss::peekOp(const std::string &msg)
 {
     if (msg.size() < 3 || msg[0] != '[' || msg[1] != '"') return {};
+
+    // Decodes escapes and stops after the op, the rest is not looked at.
+    std::string op;
+    if (JSon::readString(msg, 1, op) != std::string::npos) return op;
+
+    // Not plain ASCII, take the raw bytes up to the next quote.
     auto end = msg.find('"', 2);
     if (end == std::string::npos) return {};
     return msg.substr(2, end - 2);
 }
 
+std::string swss::notificationOpDataKey(const std::string &msg)
+{
+    if (msg.empty() || msg[0] != '[') return {};
+
+    std::string op;
+    std::string data;
+    size_t pos = JSon::readString(msg, 1, op);
+    if (pos == std::string::npos || pos >= msg.size() || msg[pos] != ',') return {};
+    if (JSon::readString(msg, pos + 1, data) == std::string::npos) return {};
+
+    // The op never contains a NUL, so the key is unambiguous.
+    op += '\0';
+    op += data;
+    return op;
+}
+
+bool swss::unpackNotificationBatch(const std::string &msg, std::vector<std::string> &notifications)
+{
+    // A single notification is an array of strings, a batch an array of
+    // such arrays.
+    if (msg.size() < 2 || msg[0] != '[' || msg[1] != '[') return false;
+
+    std::vector<std::string> unpacked;
+    size_t pos = 1;
+    while (true)
+    {
+        if (pos >= msg.size() || msg[pos] != '[')
+        {
+            throw std::runtime_error("malformed notification batch");
+        }
+
+        // Find the closing bracket of this notification, skipping strings.
+        size_t start = pos++;
+        bool in_string = false;
+        while (pos < msg.size() && (in_string || msg[pos] != ']'))
+        {
+            if (in_string && msg[pos] == '\\')
+            {
+                pos++;
+            }
+            else if (msg[pos] == '"')
+            {
+                in_string = !in_string;
+            }
+            pos++;
+        }
+
+        if (pos >= msg.size())
+        {
+            throw std::runtime_error("malformed notification batch");
+        }
+
+        unpacked.emplace_back(msg, start, pos - start + 1);
+        pos++;
+
+        if (pos < msg.size() && msg[pos] == ',')
+        {
+            pos++;
+        }
+        else if (pos + 1 == msg.size() && msg[pos] == ']')
+        {
+            break;
+        }
+        else
+        {
+            throw std::runtime_error("malformed notification batch");
+        }
+    }
+
+    notifications.insert(notifications.end(),
+                         std::make_move_iterator(unpacked.begin()),
+                         std::make_move_iterator(unpacked.end()));
+    return true;
+}
+
 // Original 4-arg constructor. Defaults to Fifo policy; behavior identical to
 // legacy.
 swss::NotificationConsumer::NotificationConsumer(swss::DBConnector *db,
@@ -61,15 +157,50 @@ swss::NotificationConsumer::NotificationConsumer(swss::DBConnector *db,
     m_db(db),
     m_subscribe(NULL),
     m_channel(channel),
-    m_queue(policy == NotificationQueuePolicy::LruDedup
-            ? std::unique_ptr<NotificationQueueBase>(std::make_unique<LruDedupNotificationQueue>(channel))
-            : std::unique_ptr<NotificationQueueBase>(std::make_unique<FifoNotificationQueue>()))
+    m_queue(makeQueue(policy, channel))
+{
+    SWSS_LOG_ENTER();
+    subscribeWithRetry();
+}
+
+// KeyedDedup with a caller-supplied key extractor.
+swss::NotificationConsumer::NotificationConsumer(swss::DBConnector *db,
+                                                 const std::string &channel,
+                                                 int pri,
+                                                 size_t popBatchSize,
+                                                 swss::NotificationKeyExtractor keyExtractor):
+    Selectable(pri),
+    POP_BATCH_SIZE(popBatchSize),
+    m_db(db),
+    m_subscribe(NULL),
+    m_channel(channel),
+    m_queue(std::make_unique<KeyedDedupNotificationQueue>(std::move(keyExtractor), channel))
 {
     SWSS_LOG_ENTER();
     subscribeWithRetry();
 }
 
-// Both constructors share the same subscribe-and-retry loop.  Any
+// Stream transport.
+swss::NotificationConsumer::NotificationConsumer(swss::DBConnector *db,
+                                                 const std::string &channel,
+                                                 int pri,
+                                                 size_t popBatchSize,
+                                                 swss::NotificationQueuePolicy policy,
+                                                 const swss::NotificationStreamOptions &stream):
+    Selectable(pri),
+    POP_BATCH_SIZE(popBatchSize),
+    m_db(db),
+    m_subscribe(NULL),
+    m_channel(channel),
+    m_queue(makeQueue(policy, channel)),
+    m_stream(true),
+    m_stream_options(stream)
+{
+    SWSS_LOG_ENTER();
+    subscribeWithRetry();
+}
+
+// All constructors share the same subscribe-and-retry loop.  Any
 // future change (backoff, retry limit, error reporting) lives here
 // in one place.
 void swss::NotificationConsumer::subscribeWithRetry()
@@ -109,6 +240,42 @@ void swss::NotificationConsumer::subscribe()
                                       m_db->getContext()->unix_sock.path,
                                       NOTIFICATION_SUBSCRIBE_TIMEOUT);
 
+    if (m_stream)
+    {
+        if (!m_stream_options.group.empty())
+        {
+            if (!createStreamGroup())
+            {
+                throw std::runtime_error("Unable to create consumer group");
+            }
+        }
+        else if (m_stream_options.startId == "$")
+        {
+            // Pin "$" to the current last entry, so entries added once the
+            // constructor returned are read even before the first XREAD is
+            // served.
+            RedisCommand last;
+            last.format("XREVRANGE %s + - COUNT 1", m_channel.c_str());
+            RedisReply r(m_subscribe, last, REDIS_REPLY_ARRAY);
+            auto reply = r.getContext();
+            m_stream_id = "0-0";
+            if (reply->elements > 0 && reply->element[0]->type == REDIS_REPLY_ARRAY
+                && reply->element[0]->elements > 0)
+            {
+                m_stream_id = reply->element[0]->element[0]->str;
+            }
+        }
+        else
+        {
+            m_stream_id = m_stream_options.startId;
+        }
+
+        requestStreamEntries();
+
+        SWSS_LOG_INFO("reading stream %s", m_channel.c_str());
+        return;
+    }
+
     std::string s = "SUBSCRIBE " + m_channel;
 
     RedisReply r(m_subscribe, s, REDIS_REPLY_ARRAY);
@@ -116,6 +283,72 @@ void swss::NotificationConsumer::subscribe()
     SWSS_LOG_INFO("subscribed to %s", m_channel.c_str());
 }
 
+// Create the consumer group with the stream if either is missing. Starts at
+// the end of the stream when the group is new, an existing group keeps its
+// position. Returns false if Redis refused.
+bool swss::NotificationConsumer::createStreamGroup()
+{
+    RedisCommand create;
+    create.format("XGROUP CREATE %s %s $ MKSTREAM", m_channel.c_str(), m_stream_options.group.c_str());
+    if (create.appendTo(m_subscribe->getContext()) != REDIS_OK)
+    {
+        throw std::bad_alloc();
+    }
+
+    redisReply *reply = nullptr;
+    if (redisGetReply(m_subscribe->getContext(), reinterpret_cast<void**>(&reply)) != REDIS_OK)
+    {
+        throw RedisError("Failed to create consumer group on " + m_channel, m_subscribe->getContext());
+    }
+
+    RedisReply r(reply);
+    if (reply->type == REDIS_REPLY_ERROR && strncmp(reply->str, "BUSYGROUP", 9) != 0)
+    {
+        SWSS_LOG_ERROR("failed to create consumer group %s on %s: %s",
+                       m_stream_options.group.c_str(), m_channel.c_str(), reply->str);
+        return false;
+    }
+
+    return true;
+}
+
+// Send the next blocking read without waiting for its reply, the reply
+// arrives once the stream has entries and makes the fd readable.
+void swss::NotificationConsumer::requestStreamEntries()
+{
+    std::string count = std::to_string(m_stream_options.count ? m_stream_options.count : POP_BATCH_SIZE);
+
+    RedisCommand command;
+    if (m_stream_options.group.empty())
+    {
+        command.format("XREAD COUNT %s BLOCK 0 STREAMS %s %s",
+                       count.c_str(), m_channel.c_str(), m_stream_id.c_str());
+    }
+    else
+    {
+        // NOACK: the group's position is the resume point, entries are not
+        // kept pending for a retry.
+        command.format("XREADGROUP GROUP %s %s COUNT %s BLOCK 0 NOACK STREAMS %s >",
+                       m_stream_options.group.c_str(), m_stream_options.consumer.c_str(),
+                       count.c_str(), m_channel.c_str());
+    }
+
+    redisContext *ctx = m_subscribe->getContext();
+    if (command.appendTo(ctx) != REDIS_OK)
+    {
+        throw std::bad_alloc();
+    }
+
+    int done = 0;
+    while (!done)
+    {
+        if (redisBufferWrite(ctx, &done) != REDIS_OK)
+        {
+            throw RedisError("Failed to read stream " + m_channel, ctx);
+        }
+    }
+}
+
 int swss::NotificationConsumer::getFd()
 {
     return m_subscribe->getContext()->fd;
@@ -133,6 +366,44 @@ uint64_t swss::NotificationConsumer::readData()
 
         throw std::runtime_error("Unable to read redis reply");
     }
+    else if (m_stream)
+    {
+        RedisReply r(reply);
+
+        // One read is outstanding at a time, so this is its only reply. The
+        // next read is always sent, without one the fd never becomes
+        // readable again.
+        std::vector<std::string> msgs;
+        if (reply->type == REDIS_REPLY_ERROR)
+        {
+            // NOGROUP after a Redis restart or flush, or the stream deleted
+            // under the blocked read.
+            SWSS_LOG_ERROR_RATELIMITED("failed to read stream %s: %s", m_channel.c_str(), reply->str);
+            if (!m_stream_options.group.empty())
+            {
+                createStreamGroup();
+            }
+        }
+        else
+        {
+            try
+            {
+                readNotificationStreamReply(reply, msgs, m_stream_id);
+            }
+            catch (const std::exception &e)
+            {
+                SWSS_LOG_ERROR_RATELIMITED("failed to read stream %s: %s", m_channel.c_str(), e.what());
+            }
+        }
+
+        for (const auto &msg : msgs)
+        {
+            admitMessage(msg);
+        }
+
+        requestStreamEntries();
+        return 0;
+    }
     else
     {
         RedisReply r(reply);
@@ -190,10 +461,97 @@ void swss::NotificationConsumer::processReply(redisReply *reply)
         throw std::runtime_error("getRedisReply operation failed");
     }
 
-    std::string msg = std::string(reply->element[REDIS_PUBLISH_MESSAGE_INDEX]->str);
+    admitMessage(std::string(reply->element[REDIS_PUBLISH_MESSAGE_INDEX]->str));
+}
 
+// Admission of a received message, a notification or a batch of them.
+void swss::NotificationConsumer::admitMessage(const std::string &msg)
+{
     SWSS_LOG_DEBUG("got message: %s", msg.c_str());
 
+    std::vector<std::string> notifications;
+    try
+    {
+        if (unpackNotificationBatch(msg, notifications))
+        {
+            m_batches.fetch_add(1, std::memory_order_relaxed);
+            for (const auto &notification : notifications)
+            {
+                admit(notification);
+            }
+            return;
+        }
+    }
+    catch (const std::runtime_error &e)
+    {
+        SWSS_LOG_ERROR("NotificationConsumer[%s]: dropped %s: %s",
+                       (m_stats_label.empty() ? m_channel : m_stats_label).c_str(),
+                       e.what(), msg.c_str());
+        return;
+    }
+
+    admit(msg);
+}
+
+void swss::readNotificationStreamReply(const redisReply *reply, std::vector<std::string> &msgs, std::string &lastId)
+{
+    if (reply->type == REDIS_REPLY_NIL)
+    {
+        return;
+    }
+
+    // [[stream, [[id, [field, value, ...]], ...]]]
+    if (reply->type != REDIS_REPLY_ARRAY)
+    {
+        throw std::runtime_error("malformed stream reply");
+    }
+
+    for (size_t i = 0; i < reply->elements; i++)
+    {
+        const redisReply *stream = reply->element[i];
+        if (stream->type != REDIS_REPLY_ARRAY || stream->elements != 2
+            || stream->element[1]->type != REDIS_REPLY_ARRAY)
+        {
+            throw std::runtime_error("malformed stream reply");
+        }
+
+        const redisReply *entries = stream->element[1];
+        for (size_t j = 0; j < entries->elements; j++)
+        {
+            const redisReply *entry = entries->element[j];
+            if (entry->type != REDIS_REPLY_ARRAY || entry->elements != 2
+                || entry->element[0]->type != REDIS_REPLY_STRING)
+            {
+                throw std::runtime_error("malformed stream entry");
+            }
+
+            lastId.assign(entry->element[0]->str, entry->element[0]->len);
+
+            // Nil when the entry was trimmed after it was delivered.
+            const redisReply *fields = entry->element[1];
+            if (fields->type != REDIS_REPLY_ARRAY)
+            {
+                continue;
+            }
+
+            for (size_t k = 0; k + 1 < fields->elements; k += 2)
+            {
+                const redisReply *field = fields->element[k];
+                const redisReply *value = fields->element[k + 1];
+                if (field->type == REDIS_REPLY_STRING && value->type == REDIS_REPLY_STRING
+                    && strcmp(field->str, NotificationProducer::STREAM_FIELD) == 0)
+                {
+                    msgs.emplace_back(value->str, value->len);
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// Admission of a single notification message into the queue.
+void swss::NotificationConsumer::admit(const std::string &msg)
+{
     m_received.fetch_add(1, std::memory_order_relaxed);
 
     if (!m_op_allowlist.empty())
@@ -225,6 +583,10 @@ void swss::NotificationConsumer::setStatsLabel(const std::string &label)
     {
         lru->setLabel(label);
     }
+    if (auto *keyed = getKeyedDedupQueue())
+    {
+        keyed->setLabel(label);
+    }
     SWSS_LOG_NOTICE("NotificationConsumer[%s]: stats label set (channel=%s)",
                     label.c_str(), m_channel.c_str());
 }
@@ -242,6 +604,11 @@ swss::LruDedupNotificationQueue* swss::NotificationConsumer::getLruDedupQueue()
     return dynamic_cast<LruDedupNotificationQueue*>(m_queue.get());
 }
 
+swss::KeyedDedupNotificationQueue* swss::NotificationConsumer::getKeyedDedupQueue() const
+{
+    return dynamic_cast<KeyedDedupNotificationQueue*>(m_queue.get());
+}
+
 void swss::NotificationConsumer::maybeLogStats()
 {
     uint64_t r = m_received.load(std::memory_order_relaxed);
@@ -403,3 +770,62 @@ void swss::LruDedupNotificationQueue::maybeLogStats()
     m_last_logged_pushed = p;
     m_last_stats_log = now;
 }
+
+void swss::KeyedDedupNotificationQueue::push(const std::string& msg)
+{
+    std::string key = m_extractor(msg);
+
+    m_pushed.fetch_add(1, std::memory_order_relaxed);
+    if (!key.empty())
+    {
+        auto it = m_idx.find(key);
+        if (it != m_idx.end())
+        {
+            // Latest payload wins, the slot stays where it was.
+            it->second->msg = msg;
+            m_dedup_hits.fetch_add(1, std::memory_order_relaxed);
+            maybeLogStats();
+            return;
+        }
+    }
+
+    m_dq.push_back(Entry{key, msg});
+    if (!key.empty())
+    {
+        m_idx.emplace(std::move(key), std::prev(m_dq.end()));
+    }
+
+    size_t cur = m_current_depth.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (cur > m_high_watermark.load(std::memory_order_relaxed))
+    {
+        m_high_watermark.store(cur, std::memory_order_relaxed);
+    }
+
+    maybeLogStats();
+}
+
+void swss::KeyedDedupNotificationQueue::maybeLogStats()
+{
+    uint64_t p = m_pushed.load(std::memory_order_relaxed);
+    if ((p & (kStatsCheckEveryN - 1)) != 0) return;
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - m_last_stats_log < kStatsLogInterval) return;
+
+    if (p == m_last_logged_pushed) return;       // idle, no progress
+
+    uint64_t h = m_dedup_hits.load(std::memory_order_relaxed);
+    size_t   d = m_current_depth.load(std::memory_order_relaxed);
+    size_t   hwm = m_high_watermark.load(std::memory_order_relaxed);
+    SWSS_LOG_NOTICE(
+        "KeyedDedupNotificationQueue[%s]: stats pushed=%llu dedup_hits=%llu "
+        "dedup_ratio=%.2f%% depth=%zu hwm=%zu keys=%zu",
+        m_label.c_str(),
+        static_cast<unsigned long long>(p),
+        static_cast<unsigned long long>(h),
+        p ? 100.0 * static_cast<double>(h) / static_cast<double>(p) : 0.0,
+        d, hwm, m_idx.size());
+
+    m_last_logged_pushed = p;
+    m_last_stats_log = now;
+}
@@ -3,6 +3,7 @@
 
 #include <atomic>
 #include <chrono>
+#include <functional>
 #include <string>
 #include <vector>
 #include <queue>
@@ -27,11 +28,26 @@ static constexpr size_t DEFAULT_NC_POP_BATCH_SIZE = 2048;
 // Extract the leading op string from a NotificationProducer JSON-array
 // message of the form: ["op","data","f1","v1",...].  Returns an empty
 // string if the message does not start with the expected
-// array-of-strings prefix.  Bounded scan, no JSON parse.  See
+// array-of-strings prefix.  Escapes in the op are decoded.  Bounded
+// scan of the first string only, no JSON parse.  See
 // NotificationProducer::send + JSon::buildJson for the wire format
 // this matches.
 std::string peekOp(const std::string &msg);
 
+// Split a batch message of NotificationProducer::send(vector), a JSON
+// array of notification messages, into those messages.  Returns false
+// without touching notifications if msg is not a batch, and throws
+// std::runtime_error if it is a malformed one.  Scans for the bounds of
+// the inner arrays, no JSON parse.
+bool unpackNotificationBatch(const std::string &msg, std::vector<std::string> &notifications);
+
+// Append the messages of an XREAD or XREADGROUP reply, entries written by
+// NotificationProducer with Stream transport, to msgs and set lastId to
+// the ID of the last entry.  A nil reply holds no entries.  Entries
+// without a message field are skipped.  Throws std::runtime_error on a
+// reply of any other shape.
+void readNotificationStreamReply(const redisReply *reply, std::vector<std::string> &msgs, std::string &lastId);
+
 // ---------------------------------------------------------------------------
 // Abstract queue strategy.  Single-threaded; no internal locking required.
 // getStats() is safe to call from any thread, other APIs are single-threaded.
@@ -190,6 +206,98 @@ private:
     uint64_t m_last_logged_pushed{0};
 };
 
+// ---------------------------------------------------------------------------
+// Keyed-dedup queue.
+//
+// The caller supplies a key extractor, e.g. op plus the object ID parsed
+// from the data field.  On push(msg): if a message with the same key is
+// queued, msg replaces it in place and keeps its queue slot; otherwise msg
+// is appended at the tail.  Messages with an empty key are never deduped.
+//
+// Drain order: "first-seen time per key, latest payload per key".  Unlike
+// LruDedup, payloads which differ only in timestamps or counters collapse,
+// so queue depth is bound to the number of live objects, not the event
+// rate.
+//
+// Only opt in for consumers that only need the latest notification per key.
+// ---------------------------------------------------------------------------
+typedef std::function<std::string(const std::string &msg)> NotificationKeyExtractor;
+
+// Default key of KeyedDedup: the op and data strings of the message, so
+// notifications which differ only in their field/value pairs collapse.
+// Empty if the message is not a NotificationProducer message.
+std::string notificationOpDataKey(const std::string &msg);
+
+class KeyedDedupNotificationQueue : public NotificationQueueBase {
+public:
+    // Same counters as the LRU queue, so telemetry handles both alike.
+    typedef LruDedupNotificationQueue::Stats Stats;
+
+    explicit KeyedDedupNotificationQueue(NotificationKeyExtractor extractor,
+                                         const std::string& label = "")
+        : m_extractor(std::move(extractor)), m_label(label) {}
+
+    void push(const std::string& msg) override;
+
+    const std::string& front() const override
+    {
+        return m_dq.front().msg;
+    }
+
+    void pop() override
+    {
+        if (m_dq.empty()) return;   // defensive; caller should check empty()
+        if (!m_dq.front().key.empty()) m_idx.erase(m_dq.front().key);
+        m_dq.pop_front();
+        m_current_depth.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    bool empty() const override
+    {
+        return m_dq.empty();
+    }
+
+    size_t size() const override
+    {
+        return m_dq.size();
+    }
+
+    // Snapshot of all counters.  Lock-free; safe to call from a thread
+    // other than the one driving push()/pop().
+    Stats getStats() const {
+        Stats s;
+        s.pushed         = m_pushed.load(std::memory_order_relaxed);
+        s.dedup_hits     = m_dedup_hits.load(std::memory_order_relaxed);
+        s.high_watermark = m_high_watermark.load(std::memory_order_relaxed);
+        s.current_depth  = m_current_depth.load(std::memory_order_relaxed);
+        return s;
+    }
+
+    void setLabel(const std::string& label) { m_label = label; }
+
+private:
+    struct Entry {
+        std::string key;
+        std::string msg;
+    };
+
+    void maybeLogStats();
+
+    NotificationKeyExtractor m_extractor;
+    std::list<Entry> m_dq;
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_idx;
+    std::string m_label;
+
+    // Telemetry, same semantics as LruDedupNotificationQueue.
+    std::atomic<uint64_t> m_pushed{0};
+    std::atomic<uint64_t> m_dedup_hits{0};
+    std::atomic<size_t>   m_high_watermark{0};
+    std::atomic<size_t>   m_current_depth{0};
+
+    std::chrono::steady_clock::time_point m_last_stats_log{};
+    uint64_t m_last_logged_pushed{0};
+};
+
 // ---------------------------------------------------------------------------
 // Policy tag passed to NotificationConsumer at construction time.
 // Existing call sites compile unchanged (Fifo is the default).
@@ -205,7 +313,33 @@ enum class NotificationQueuePolicy {
     // Pick this policy if the consumer's outcome is idempotent and determined
     // by the final state per unique payload. If the consumers needs every
     // event observed in arrival order, pick Fifo.
-    LruDedup
+    LruDedup,
+
+    // Opt-in dedup by key. A newer payload replaces the queued one with the
+    // same key and keeps its slot, see KeyedDedupNotificationQueue. Keys
+    // come from notificationOpDataKey unless the consumer is given a
+    // NotificationKeyExtractor.
+    KeyedDedup
+};
+
+// Read side of NotificationTransport::Stream.
+struct NotificationStreamOptions {
+    // Consumer group keeping the read position in Redis, so a consumer
+    // restarted with the same group continues after the last entry read
+    // before.  Consumers in one group share the entries, use a group per
+    // consumer for each to see all of them.  Empty reads with XREAD from
+    // startId.
+    std::string group;
+
+    // Consumer name within the group.
+    std::string consumer = "consumer";
+
+    // Where a reader without group starts: "$" for entries added after
+    // subscribing, or the getStreamId() of a previous consumer.
+    std::string startId = "$";
+
+    // Entries fetched per round trip, 0 for the consumer's POP_BATCH_SIZE.
+    size_t count = 0;
 };
 
 class NotificationConsumer : public Selectable
@@ -215,6 +349,7 @@ public:
     struct Stats {
         uint64_t received;           // total processReply admissions attempted
         uint64_t dropped_allowlist;  // dropped at admission by op-allowlist
+        uint64_t batches;            // batch messages unpacked into notifications
     };
 
     // Original 4-arg constructor.  Preserved verbatim so the mangled symbol
@@ -235,6 +370,22 @@ public:
                          size_t popBatchSize,
                          NotificationQueuePolicy policy);
 
+    // KeyedDedup policy with the given key extractor.
+    NotificationConsumer(swss::DBConnector *db,
+                         const std::string &channel,
+                         int pri,
+                         size_t popBatchSize,
+                         NotificationKeyExtractor keyExtractor);
+
+    // Read the stream written by a NotificationProducer with
+    // NotificationTransport::Stream instead of subscribing to the channel.
+    NotificationConsumer(swss::DBConnector *db,
+                         const std::string &channel,
+                         int pri,
+                         size_t popBatchSize,
+                         NotificationQueuePolicy policy,
+                         const NotificationStreamOptions &stream);
+
     // Pop one or multiple data from the internal queue which fed from redis socket
     // Note:
     //    Ensure data ready before popping, either by select or peek
@@ -286,6 +437,7 @@ public:
         Stats s;
         s.received          = m_received.load(std::memory_order_relaxed);
         s.dropped_allowlist = m_dropped_allowlist.load(std::memory_order_relaxed);
+        s.batches           = m_batches.load(std::memory_order_relaxed);
         return s;
     }
 
@@ -298,16 +450,28 @@ public:
     // alive.  Do not delete.
     LruDedupNotificationQueue* getLruDedupQueue() const;
 
+    // Same for NotificationQueuePolicy::KeyedDedup.
+    KeyedDedupNotificationQueue* getKeyedDedupQueue() const;
+
     const std::string& getChannel() const { return m_channel; }
 
+    // Stream position: the ID of the last entry read, or where reading
+    // starts before the first one.  Empty with pub/sub, and with a
+    // consumer group until an entry is read.
+    const std::string& getStreamId() const { return m_stream_id; }
+
 private:
 
     NotificationConsumer(const NotificationConsumer &other);
     NotificationConsumer& operator = (const NotificationConsumer &other);
 
     void processReply(redisReply *reply);
+    void admitMessage(const std::string &msg);
+    void admit(const std::string &msg);
     void subscribe();
     void subscribeWithRetry();
+    void requestStreamEntries();
+    bool createStreamGroup();
     void maybeLogStats();
 
     swss::DBConnector *m_db;
@@ -317,9 +481,16 @@ private:
     std::unique_ptr<NotificationQueueBase> m_queue;
     std::unordered_set<std::string> m_op_allowlist;
 
+    // Stream transport, a blocking read is outstanding on m_subscribe
+    // whose reply makes the fd readable.
+    bool m_stream{false};
+    NotificationStreamOptions m_stream_options;
+    std::string m_stream_id;
+
     // Telemetry.
     std::atomic<uint64_t> m_received{0};
     std::atomic<uint64_t> m_dropped_allowlist{0};
+    std::atomic<uint64_t> m_batches{0};
 
     // Throttling for the periodic stats SWSS_LOG_NOTICE.  Same pattern as
     // LruDedupNotificationQueue::maybeLogStats.
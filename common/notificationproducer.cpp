@@ -1,5 +1,7 @@
 #include "notificationproducer.h"
 
+#include <algorithm>
+
 #define NON_BUFFERED_COMMAND_BUFFER_SIZE 1
 
 swss::NotificationProducer::NotificationProducer(swss::DBConnector *db, const std::string &channel):
@@ -7,26 +9,111 @@ swss::NotificationProducer::NotificationProducer(swss::DBConnector *db, const st
 {
 }
 
+swss::NotificationProducer::NotificationProducer(swss::DBConnector *db, const std::string &channel,
+                                                 NotificationTransport transport, size_t maxLength):
+    m_ownedpipe(std::make_unique<swss::RedisPipeline>(db, NON_BUFFERED_COMMAND_BUFFER_SIZE)), m_pipe(m_ownedpipe.get()), m_channel(channel), m_buffered(false),
+    m_transport(transport), m_maxLength(maxLength)
+{
+}
+
 swss::NotificationProducer::NotificationProducer(swss::RedisPipeline *pipeline, const std::string &channel, bool buffered):
      m_pipe(pipeline), m_channel(channel), m_buffered(buffered)
 {
 }
 
+constexpr size_t swss::NotificationProducer::MAX_BATCH_SIZE;
+constexpr size_t swss::NotificationProducer::DEFAULT_STREAM_MAX_LENGTH;
+constexpr const char *swss::NotificationProducer::STREAM_FIELD;
+
+static std::string buildNotification(const std::string &op, const std::string &data, std::vector<swss::FieldValueTuple> &values)
+{
+    swss::FieldValueTuple opdata(op, data);
+
+    values.insert(values.begin(), opdata);
+
+    std::string msg = swss::JSon::buildJson(values);
+
+    values.erase(values.begin());
+
+    return msg;
+}
+
 int64_t swss::NotificationProducer::send(const std::string &op, const std::string &data, std::vector<FieldValueTuple> &values)
 {
     SWSS_LOG_ENTER();
 
-    FieldValueTuple opdata(op, data);
+    return publish(buildNotification(op, data, values));
+}
 
-    values.insert(values.begin(), opdata);
+int64_t swss::NotificationProducer::send(const std::vector<KeyOpFieldsValuesTuple> &notifications)
+{
+    SWSS_LOG_ENTER();
 
-    std::string msg = JSon::buildJson(values);
+    int64_t clients = 0;
+    size_t batchSize = m_batching || m_transport == NotificationTransport::Stream ? MAX_BATCH_SIZE : 1;
+    for (auto it = notifications.begin(); it != notifications.end(); )
+    {
+        auto end = it + (std::ptrdiff_t)std::min<size_t>(batchSize, (size_t)(notifications.end() - it));
 
-    values.erase(values.begin());
+        std::string msg;
+        if (end - it == 1)
+        {
+            // A batch of one is sent as a plain notification.
+            std::vector<FieldValueTuple> values = kfvFieldsValues(*it);
+            msg = buildNotification(kfvOp(*it), kfvKey(*it), values);
+        }
+        else
+        {
+            msg = buildBatch(it, end);
+        }
 
+        clients = std::max(clients, publish(msg));
+        it = end;
+    }
+
+    return m_buffered || m_transport == NotificationTransport::Stream ? -1 : clients;
+}
+
+void swss::NotificationProducer::setBatchingEnabled(bool enabled)
+{
+    m_batching = enabled;
+}
+
+std::string swss::NotificationProducer::buildBatch(std::vector<KeyOpFieldsValuesTuple>::const_iterator begin,
+                                                   std::vector<KeyOpFieldsValuesTuple>::const_iterator end)
+{
+    std::string batch = "[";
+    std::vector<FieldValueTuple> values;
+    for (auto it = begin; it != end; ++it)
+    {
+        if (it != begin)
+        {
+            batch += ',';
+        }
+
+        values = kfvFieldsValues(*it);
+        batch += buildNotification(kfvOp(*it), kfvKey(*it), values);
+    }
+    batch += ']';
+
+    return batch;
+}
+
+int64_t swss::NotificationProducer::publish(const std::string &msg)
+{
     SWSS_LOG_DEBUG("channel %s, publish: %s", m_channel.c_str(), msg.c_str());
 
     RedisCommand command;
+    if (m_transport == NotificationTransport::Stream)
+    {
+        // Approximate trimming lets Redis drop whole nodes, exact MAXLEN
+        // would cost a trim on every XADD.
+        command.format("XADD %s MAXLEN ~ %s * %s %s", m_channel.c_str(),
+                       std::to_string(m_maxLength).c_str(), STREAM_FIELD, msg.c_str());
+        RedisReply reply = m_pipe->push(command, REDIS_REPLY_STRING);
+        return -1;
+    }
+
     command.format("PUBLISH %s %s", m_channel.c_str(), msg.c_str());
 
     if (m_buffered)
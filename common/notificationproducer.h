@@ -14,11 +14,34 @@
 
 namespace swss {
 
+enum class NotificationTransport {
+    // PUBLISH to the channel. Messages reach the consumers subscribed at
+    // that moment, a consumer which is slow to read or reconnecting loses
+    // them.
+    PubSub,
+
+    // XADD to a Redis stream named like the channel, trimmed to about
+    // maxLength entries. Consumers read many entries per round trip and
+    // resume where they stopped, see NotificationStreamOptions.
+    Stream
+};
+
 class NotificationProducer
 {
 public:
     NotificationProducer(swss::DBConnector *db, const std::string &channel);
 
+    /**
+     * @brief Create NotificationProducer with the given transport
+     * @param db Database connector
+     * @param channel Channel name, the stream key with Stream transport
+     * @param transport How notifications reach the consumers
+     * @param maxLength Entries a stream keeps for slow consumers
+     */
+    NotificationProducer(swss::DBConnector *db, const std::string &channel,
+                         NotificationTransport transport,
+                         size_t maxLength = DEFAULT_STREAM_MAX_LENGTH);
+
     /**
      * @brief Create NotificationProducer using RedisPipeline
      * @param pipeline Pointer to RedisPipeline
@@ -27,11 +50,52 @@ public:
      */
     NotificationProducer(RedisPipeline *pipeline, const std::string &channel, bool buffered = false);
 
-    // Returns: the number of clients that received the message
+    // Returns: the number of clients that received the message, -1 in
+    // buffered mode or with Stream transport, where consumers read later
     int64_t send(const std::string &op, const std::string &data, std::vector<FieldValueTuple> &values);
 
+    /**
+     * @brief Send many notifications at once
+     *
+     * Each tuple holds the op, the data as key and the values, as returned
+     * by NotificationConsumer::pops(). With batching enabled up to
+     * MAX_BATCH_SIZE notifications are packed into one message and sent
+     * with a single PUBLISH, otherwise they are published one by one.
+     * With Stream transport batches are always used, every stream
+     * consumer understands them.
+     *
+     * @return the number of clients that received the notifications, -1 in
+     *         buffered mode or with Stream transport
+     */
+    int64_t send(const std::vector<KeyOpFieldsValuesTuple> &notifications);
+
+    /**
+     * @brief Allow send() of many notifications to publish batch messages
+     *
+     * NotificationConsumer unpacks batches transparently, but consumers
+     * built before batching was added can't parse them, so only enable
+     * this once every consumer of the channel understands batches.
+     */
+    void setBatchingEnabled(bool enabled);
+
+    static constexpr size_t MAX_BATCH_SIZE = 1024;
+
+    // Bounds the memory of a stream nobody reads, consumers lagging further
+    // behind lose the oldest entries.
+    static constexpr size_t DEFAULT_STREAM_MAX_LENGTH = 10000;
+
+    // Field of a stream entry holding the message.
+    static constexpr const char *STREAM_FIELD = "msg";
+
+    // Batch message of notifications, a JSON array of the messages send()
+    // would publish for them one by one.
+    static std::string buildBatch(std::vector<KeyOpFieldsValuesTuple>::const_iterator begin,
+                                  std::vector<KeyOpFieldsValuesTuple>::const_iterator end);
+
 private:
 
+    int64_t publish(const std::string &msg);
+
     NotificationProducer(const NotificationProducer &other);
     NotificationProducer& operator = (const NotificationProducer &other);
 
@@ -39,6 +103,9 @@ private:
     RedisPipeline *m_pipe;
     std::string m_channel;
     bool m_buffered{false};
+    bool m_batching{false};
+    NotificationTransport m_transport{NotificationTransport::PubSub};
+    size_t m_maxLength{DEFAULT_STREAM_MAX_LENGTH};
 };
 
 }
@@ -1,7 +1,10 @@
 #include "common/selectable.h"
 #include "common/logger.h"
 #include "common/select.h"
+#include "common/iouringpoller.h"
 #include <algorithm>
+#include <atomic>
+#include <stdlib.h>
 #include <stdio.h>
 #include <sys/time.h>
 #include <sys/types.h>
@@ -15,8 +18,52 @@ using namespace std;
 
 namespace swss {
 
+static std::atomic<int>& defaultBackend()
+{
+    static std::atomic<int> backend(
+        [] {
+            const char *env = getenv("SWSS_SELECT_BACKEND");
+            if (env != nullptr && std::string(env) == "io_uring")
+            {
+                return (int)Select::IO_URING;
+            }
+            return (int)Select::EPOLL;
+        }());
+
+    return backend;
+}
+
+Select::Backend Select::getDefaultBackend()
+{
+    return static_cast<Backend>(defaultBackend().load());
+}
+
+void Select::setDefaultBackend(Backend backend)
+{
+    defaultBackend() = backend;
+}
+
 Select::Select()
+    : Select(getDefaultBackend())
+{
+}
+
+Select::Select(Backend backend)
+    : m_epoll_fd(-1)
 {
+    if (backend == IO_URING)
+    {
+        try
+        {
+            m_uring.reset(new IoUringPoller());
+            return;
+        }
+        catch (const std::runtime_error& e)
+        {
+            SWSS_LOG_NOTICE("io_uring backend unavailable, falling back to epoll: %s", e.what());
+        }
+    }
+
     m_epoll_fd = ::epoll_create1(0);
     if (m_epoll_fd == -1)
     {
@@ -29,7 +76,15 @@ Select::Select()
 
 Select::~Select()
 {
-    (void)::close(m_epoll_fd);
+    if (m_epoll_fd != -1)
+    {
+        (void)::close(m_epoll_fd);
+    }
+}
+
+Select::Backend Select::getBackend() const
+{
+    return m_uring ? IO_URING : EPOLL;
 }
 
 void Select::addSelectable(Selectable *selectable)
@@ -49,6 +104,12 @@ void Select::addSelectable(Selectable *selectable)
         m_ready.insert(selectable);
     }
 
+    if (m_uring)
+    {
+        m_uring->add(fd);
+        return;
+    }
+
     struct epoll_event ev = {
         .events = EPOLLIN,
         .data = { .fd = fd, },
@@ -71,6 +132,12 @@ void Select::removeSelectable(Selectable *selectable)
     m_objects.erase(fd);
     m_ready.erase(selectable);
 
+    if (m_uring)
+    {
+        m_uring->remove(fd);
+        return;
+    }
+
     int res = ::epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, NULL);
     if (res == -1)
     {
@@ -89,15 +156,34 @@ void Select::addSelectables(vector<Selectable *> selectables)
     }
 }
 
-int Select::poll_descriptors(Selectable **c, unsigned int timeout, bool interrupt_on_signal = false)
+int Select::wait_descriptors(std::vector<int> &fds, unsigned int timeout)
 {
+    if (m_uring)
+    {
+        return m_uring->wait(fds, static_cast<int>(timeout));
+    }
+
     int sz_selectables = static_cast<int>(m_objects.size());
     std::vector<struct epoll_event> events(sz_selectables);
+
+    int ret = ::epoll_wait(m_epoll_fd, events.data(), sz_selectables, timeout);
+    for (int i = 0; i < ret; ++i)
+    {
+        fds.push_back(events[i].data.fd);
+    }
+
+    return ret;
+}
+
+int Select::poll_descriptors(Selectable **c, unsigned int timeout, bool interrupt_on_signal = false)
+{
+    std::vector<int> fds;
     int ret;
 
     while(true)
     {
-        ret = ::epoll_wait(m_epoll_fd, events.data(), sz_selectables, timeout);
+        fds.clear();
+        ret = wait_descriptors(fds, timeout);
         // on signal interrupt check if we need to return
         if (ret == -1 && errno == EINTR)
         {
@@ -118,9 +204,8 @@ int Select::poll_descriptors(Selectable **c, unsigned int timeout, bool interrup
         return Select::ERROR;
     }
 
-    for (int i = 0; i < ret; ++i)
+    for (int fd : fds)
     {
-        int fd = events[i].data.fd;
         Selectable* sel = m_objects[fd];
         try
         {
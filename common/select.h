@@ -6,17 +6,42 @@
 #include <queue>
 #include <unordered_map>
 #include <set>
+#include <memory>
 #include <hiredis/hiredis.h>
 #include "selectable.h"
 
 namespace swss {
 
+class IoUringPoller;
+
 class Select
 {
 public:
+    enum Backend {
+        EPOLL = 0,
+        IO_URING = 1,
+    };
+
+    /*
+     * Uses getDefaultBackend(). When IO_URING is requested but io_uring is
+     * not compiled in or not usable on the running kernel, Select falls back
+     * to epoll.
+     */
     Select();
+    explicit Select(Backend backend);
     ~Select();
 
+    /* Backend actually in use, after any fallback */
+    Backend getBackend() const;
+
+    /*
+     * Backend used by the default constructor. Initialized from the
+     * SWSS_SELECT_BACKEND environment variable ("epoll" or "io_uring"),
+     * EPOLL when it is not set.
+     */
+    static Backend getDefaultBackend();
+    static void setDefaultBackend(Backend backend);
+
     /* Add object for select */
     void addSelectable(Selectable *selectable);
 
@@ -68,7 +93,10 @@ private:
 
     int poll_descriptors(Selectable **c, unsigned int timeout, bool interrupt_on_signal);
 
+    int wait_descriptors(std::vector<int> &fds, unsigned int timeout);
+
     int m_epoll_fd;
+    std::unique_ptr<IoUringPoller> m_uring;
     std::unordered_map<int, Selectable *> m_objects;
     std::set<Selectable *, Select::cmp> m_ready;
 };
@@ -0,0 +1,343 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <stdexcept>
+
+#include "common/logger.h"
+#include "common/shmring.h"
+
+using namespace std;
+
+namespace swss {
+
+constexpr size_t ShmRing::DEFAULT_CAPACITY;
+
+static const char SHM_ENDPOINT_PREFIX[] = "shm://";
+
+static const uint64_t SHM_RING_MAGIC = 0x31474e4952575353ULL;
+
+// A record is its length followed by the message, padded to RECORD_ALIGN.
+// WRAP_RECORD tells the consumer to continue at the start of the ring.
+static const size_t RECORD_ALIGN = 8;
+static const uint64_t WRAP_RECORD = UINT64_MAX;
+
+struct ShmRing::Header
+{
+    uint64_t magic;
+    uint64_t capacity;
+    uint32_t closed;
+
+    pthread_mutex_t producerMutex;
+
+    /* written by producers */
+    alignas(64) uint64_t tail;
+    uint32_t tailSeq;
+    uint32_t consumerWaiting;
+
+    /* written by the consumer */
+    alignas(64) uint64_t head;
+};
+
+static long futex(uint32_t *addr, int op, uint32_t val, const struct timespec *timeout)
+{
+    // Not FUTEX_PRIVATE_FLAG, the word is shared between processes.
+    return syscall(SYS_futex, addr, op, val, timeout, nullptr, 0);
+}
+
+static size_t recordSize(size_t size)
+{
+    return sizeof(uint64_t) + ((size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1));
+}
+
+static bool sameObject(int fd, const std::string &name)
+{
+    struct stat own;
+    struct stat current;
+    int currentFd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (currentFd < 0)
+    {
+        return false;
+    }
+
+    bool same = fstat(fd, &own) == 0 && fstat(currentFd, &current) == 0
+        && own.st_dev == current.st_dev && own.st_ino == current.st_ino;
+    close(currentFd);
+    return same;
+}
+
+ShmRing::ShmRing(const std::string &name, bool create, size_t capacity)
+    : m_name(name)
+    , m_owner(create)
+    , m_fd(-1)
+    , m_mapping(MAP_FAILED)
+    , m_mappingSize(0)
+    , m_header(nullptr)
+    , m_data(nullptr)
+    , m_capacity(0)
+{
+    size_t headerSize = (sizeof(Header) + 63) & ~(size_t)63;
+
+    if (create)
+    {
+        capacity = std::max<size_t>((capacity + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1), 4096);
+
+        // Replace the segment of a previous consumer.
+        shm_unlink(name.c_str());
+        m_fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        if (m_fd < 0 || ftruncate(m_fd, (off_t)(headerSize + capacity)) != 0)
+        {
+            int err = errno;
+            if (m_fd >= 0)
+            {
+                close(m_fd);
+                shm_unlink(name.c_str());
+            }
+            throw runtime_error("ShmRing: failed to create " + name + ": " + strerror(err));
+        }
+    }
+    else
+    {
+        m_fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+        struct stat st;
+        if (m_fd < 0 || fstat(m_fd, &st) != 0 || (size_t)st.st_size <= headerSize)
+        {
+            int err = m_fd < 0 ? errno : EAGAIN;
+            if (m_fd >= 0)
+            {
+                close(m_fd);
+            }
+            throw runtime_error("ShmRing: failed to open " + name + ": " + strerror(err));
+        }
+        capacity = (size_t)st.st_size - headerSize;
+    }
+
+    m_mappingSize = headerSize + capacity;
+    m_mapping = mmap(nullptr, m_mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (m_mapping == MAP_FAILED)
+    {
+        int err = errno;
+        close(m_fd);
+        if (create)
+        {
+            shm_unlink(name.c_str());
+        }
+        throw runtime_error("ShmRing: failed to map " + name + ": " + strerror(err));
+    }
+
+    m_header = static_cast<Header *>(m_mapping);
+    m_data = static_cast<char *>(m_mapping) + headerSize;
+    m_capacity = capacity;
+
+    if (create)
+    {
+        // ftruncate() zeroed the segment.
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+        pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+        pthread_mutex_init(&m_header->producerMutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        m_header->capacity = capacity;
+        __atomic_store_n(&m_header->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+    }
+    else if (__atomic_load_n(&m_header->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC
+             || m_header->capacity != capacity)
+    {
+        munmap(m_mapping, m_mappingSize);
+        close(m_fd);
+        throw runtime_error("ShmRing: " + name + " is not initialized");
+    }
+}
+
+ShmRing::~ShmRing()
+{
+    if (m_owner)
+    {
+        __atomic_store_n(&m_header->closed, 1, __ATOMIC_RELEASE);
+
+        // Leave the name alone if a new consumer took it over already.
+        if (sameObject(m_fd, m_name))
+        {
+            shm_unlink(m_name.c_str());
+        }
+    }
+
+    munmap(m_mapping, m_mappingSize);
+    close(m_fd);
+}
+
+bool ShmRing::isShmEndpoint(const std::string &endpoint)
+{
+    return endpoint.compare(0, sizeof(SHM_ENDPOINT_PREFIX) - 1, SHM_ENDPOINT_PREFIX) == 0;
+}
+
+std::string ShmRing::segmentName(const std::string &endpoint)
+{
+    std::string name = endpoint.substr(sizeof(SHM_ENDPOINT_PREFIX) - 1);
+    for (auto &c : name)
+    {
+        if (c == '/')
+        {
+            c = '_';
+        }
+    }
+
+    return "/swss-zmq-" + name;
+}
+
+size_t ShmRing::maxMessageSize() const
+{
+    return m_capacity / 2 - sizeof(uint64_t);
+}
+
+bool ShmRing::isClosed() const
+{
+    return __atomic_load_n(&m_header->closed, __ATOMIC_ACQUIRE) != 0;
+}
+
+bool ShmRing::isStale() const
+{
+    return isClosed() || !sameObject(m_fd, m_name);
+}
+
+bool ShmRing::push(size_t size, const std::function<size_t(char *)> &fill)
+{
+    if (size > maxMessageSize())
+    {
+        SWSS_LOG_THROW("ShmRing: message of %zu bytes exceeds the limit of %zu bytes on %s", size, maxMessageSize(), m_name.c_str());
+    }
+
+    int rc = pthread_mutex_lock(&m_header->producerMutex);
+    if (rc == EOWNERDEAD)
+    {
+        // The producer died before publishing, its record was never visible.
+        pthread_mutex_consistent(&m_header->producerMutex);
+    }
+    else if (rc != 0)
+    {
+        SWSS_LOG_THROW("ShmRing: failed to lock %s: %s", m_name.c_str(), strerror(rc));
+    }
+
+    uint64_t head = __atomic_load_n(&m_header->head, __ATOMIC_ACQUIRE);
+    uint64_t tail = m_header->tail;
+    size_t pos = (size_t)(tail % m_capacity);
+    size_t needed = recordSize(size);
+
+    // Records are contiguous, skip the end of the ring if it's too short.
+    size_t skip = pos + needed > m_capacity ? m_capacity - pos : 0;
+    if (m_capacity - (size_t)(tail - head) < skip + needed)
+    {
+        pthread_mutex_unlock(&m_header->producerMutex);
+        return false;
+    }
+
+    size_t written;
+    try
+    {
+        if (skip)
+        {
+            memcpy(m_data + pos, &WRAP_RECORD, sizeof(WRAP_RECORD));
+            pos = 0;
+        }
+
+        written = fill(m_data + pos + sizeof(uint64_t));
+        if (written > size)
+        {
+            SWSS_LOG_THROW("ShmRing: wrote %zu bytes into %zu reserved on %s", written, size, m_name.c_str());
+        }
+    }
+    catch (...)
+    {
+        pthread_mutex_unlock(&m_header->producerMutex);
+        throw;
+    }
+
+    uint64_t length = written;
+    memcpy(m_data + pos, &length, sizeof(length));
+    __atomic_store_n(&m_header->tail, tail + skip + recordSize(written), __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&m_header->producerMutex);
+
+    __atomic_add_fetch(&m_header->tailSeq, 1, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&m_header->consumerWaiting, __ATOMIC_SEQ_CST))
+    {
+        futex(&m_header->tailSeq, FUTEX_WAKE, 1, nullptr);
+    }
+
+    return true;
+}
+
+bool ShmRing::pop(int timeoutMs, const std::function<void(const char *, size_t)> &handler)
+{
+    uint64_t head = m_header->head;
+    if (head == __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE))
+    {
+        // Producers bump tailSeq after publishing, so a message published
+        // after this load makes the futex wait return right away.
+        uint32_t seq = __atomic_load_n(&m_header->tailSeq, __ATOMIC_SEQ_CST);
+        __atomic_store_n(&m_header->consumerWaiting, 1, __ATOMIC_SEQ_CST);
+        if (head == __atomic_load_n(&m_header->tail, __ATOMIC_SEQ_CST))
+        {
+            struct timespec timeout;
+            timeout.tv_sec = timeoutMs / 1000;
+            timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+            futex(&m_header->tailSeq, FUTEX_WAIT, seq, &timeout);
+        }
+        __atomic_store_n(&m_header->consumerWaiting, 0, __ATOMIC_SEQ_CST);
+
+        if (head == __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE))
+        {
+            return false;
+        }
+    }
+
+    // Producers are trusted no more than the network, check the record
+    // before reading it.
+    uint64_t tail = __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE);
+    size_t pos = (size_t)(head % m_capacity);
+    uint64_t length = WRAP_RECORD;
+    if (tail - head <= m_capacity)
+    {
+        memcpy(&length, m_data + pos, sizeof(length));
+        if (length == WRAP_RECORD)
+        {
+            head += m_capacity - pos;
+            pos = 0;
+            memcpy(&length, m_data, sizeof(length));
+        }
+    }
+
+    uint64_t next = head + recordSize((size_t)std::min<uint64_t>(length, m_capacity));
+    if (length > maxMessageSize() || length > m_capacity - pos - sizeof(uint64_t) || next > tail)
+    {
+        // Drop everything published so far, producers continue after it.
+        SWSS_LOG_ERROR("ShmRing: corrupted record at %zu on %s, dropping %" PRIu64 " bytes",
+                       pos, m_name.c_str(), tail - m_header->head);
+        __atomic_store_n(&m_header->head, tail, __ATOMIC_RELEASE);
+        return false;
+    }
+
+    try
+    {
+        handler(m_data + pos + sizeof(uint64_t), (size_t)length);
+    }
+    catch (...)
+    {
+        __atomic_store_n(&m_header->head, next, __ATOMIC_RELEASE);
+        throw;
+    }
+
+    __atomic_store_n(&m_header->head, next, __ATOMIC_RELEASE);
+    return true;
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <string>
+
+namespace swss {
+
+/*
+ * Byte ring in a POSIX shared memory segment, used by ZmqClient and
+ * ZmqServer for "shm://name" endpoints when both ends run on the same host.
+ * Messages keep the ZMQ wire format and are written into and decoded from
+ * the mapping directly, so a message costs no kernel copy.
+ *
+ * The consumer (the server) creates the segment and is its only reader.
+ * Any number of producers, in any process, open it by name; they are
+ * serialized by a robust process-shared mutex. The consumer sleeps on a
+ * futex in the mapping and producers wake it after publishing.
+ *
+ * When the consumer goes away it marks the segment closed and unlinks it,
+ * producers then reopen the name to reach the next consumer. Messages left
+ * in the ring of a consumer which crashed are lost, like messages on a dead
+ * TCP connection.
+ */
+class ShmRing
+{
+public:
+    // Create (consumer) or open (producer) the segment of name, see
+    // segmentName(). Throws std::runtime_error if the segment can't be
+    // created or doesn't exist.
+    ShmRing(const std::string &name, bool create, size_t capacity = DEFAULT_CAPACITY);
+    ~ShmRing();
+
+    // Per endpoint in /dev/shm, which is only 64MB in a default Docker
+    // container. Messages up to half the capacity fit, see
+    // ZmqServer::setShmCapacity() for tables with larger messages.
+    static constexpr size_t DEFAULT_CAPACITY = 4 * 1024 * 1024;
+
+    static bool isShmEndpoint(const std::string &endpoint);
+
+    // Shared memory object name of an "shm://name" endpoint.
+    static std::string segmentName(const std::string &endpoint);
+
+    /* Producer side */
+
+    /*
+     * Reserve size bytes and let fill write the message there. fill returns
+     * the number of bytes it wrote, at most size. Returns false without
+     * calling fill if the ring is full. Nothing is published if fill throws.
+     */
+    bool push(size_t size, const std::function<size_t(char *)> &fill);
+
+    // The consumer closed the ring.
+    bool isClosed() const;
+
+    // Closed, or a new consumer replaced the ring under the same name.
+    bool isStale() const;
+
+    /* Consumer side */
+
+    /*
+     * Wait up to timeoutMs for a message and pass it to handler in place.
+     * Returns false on timeout. The message is consumed even if handler
+     * throws. A record which doesn't fit the ring is logged and everything
+     * published so far is dropped.
+     */
+    bool pop(int timeoutMs, const std::function<void(const char *, size_t)> &handler);
+
+    // Largest message push() accepts.
+    size_t maxMessageSize() const;
+
+private:
+    struct Header;
+
+    ShmRing(const ShmRing&);
+    ShmRing& operator=(const ShmRing&);
+
+    std::string m_name;
+
+    bool m_owner;
+
+    int m_fd;
+
+    void *m_mapping;
+
+    size_t m_mappingSize;
+
+    Header *m_header;
+
+    char *m_data;
+
+    size_t m_capacity;
+};
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <utility>
+
+namespace swss
+{
+
+/*
+ * Unbounded single-producer/single-consumer queue.
+ *
+ * Items are stored in fixed-size chunks linked together, so pushing never
+ * blocks and never allocates except when a chunk fills up. The consumer
+ * hands a drained chunk back to the producer for reuse, which means a queue
+ * in steady state does not allocate at all.
+ *
+ * push() must only be called from one thread at a time, and pop()/popBatch()
+ * from one (possibly different) thread at a time. size() and empty() may be
+ * called from any thread; their result is a snapshot.
+ */
+template <typename T, size_t ChunkSize = 256>
+class SpscQueue
+{
+public:
+    SpscQueue()
+        : m_pushed(0)
+        , m_popped(0)
+        , m_spare(nullptr)
+    {
+        m_head = m_tail = new Chunk();
+        m_headIndex = 0;
+    }
+
+    ~SpscQueue()
+    {
+        Chunk *chunk = m_head;
+        while (chunk != nullptr)
+        {
+            Chunk *next = chunk->next.load(std::memory_order_relaxed);
+            delete chunk;
+            chunk = next;
+        }
+
+        delete m_spare.load(std::memory_order_relaxed);
+    }
+
+    /* Producer side */
+    void push(T item)
+    {
+        size_t index = m_tail->committed.load(std::memory_order_relaxed);
+        if (index == ChunkSize)
+        {
+            Chunk *chunk = m_spare.exchange(nullptr, std::memory_order_acquire);
+            if (chunk == nullptr)
+            {
+                chunk = new Chunk();
+            }
+            else
+            {
+                chunk->committed.store(0, std::memory_order_relaxed);
+                chunk->next.store(nullptr, std::memory_order_relaxed);
+            }
+
+            m_tail->next.store(chunk, std::memory_order_release);
+            m_tail = chunk;
+            index = 0;
+        }
+
+        m_tail->items[index] = std::move(item);
+        m_tail->committed.store(index + 1, std::memory_order_release);
+        m_pushed.fetch_add(1, std::memory_order_release);
+    }
+
+    /* Consumer side, returns false when the queue is empty */
+    bool pop(T &item)
+    {
+        if (m_headIndex == ChunkSize)
+        {
+            Chunk *next = m_head->next.load(std::memory_order_acquire);
+            if (next == nullptr)
+            {
+                return false;
+            }
+
+            // The producer has moved on to the next chunk, so it will not
+            // touch this one again until it takes it back as the spare.
+            delete m_spare.exchange(m_head, std::memory_order_release);
+            m_head = next;
+            m_headIndex = 0;
+        }
+
+        if (m_headIndex == m_head->committed.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        T &slot = m_head->items[m_headIndex++];
+        item = std::move(slot);
+        slot = T();
+        m_popped.fetch_add(1, std::memory_order_release);
+
+        return true;
+    }
+
+    /*
+     * Consumer side, move up to maxCount items into out (anything with
+     * push_back/emplace_back of T). Returns the number of items moved.
+     */
+    template <typename Container>
+    size_t popBatch(Container &out, size_t maxCount)
+    {
+        size_t count = 0;
+        T item;
+        while (count < maxCount && pop(item))
+        {
+            out.push_back(std::move(item));
+            count++;
+        }
+
+        return count;
+    }
+
+    size_t size() const
+    {
+        size_t popped = m_popped.load(std::memory_order_acquire);
+        size_t pushed = m_pushed.load(std::memory_order_acquire);
+        return pushed >= popped ? pushed - popped : 0;
+    }
+
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+private:
+    struct Chunk
+    {
+        Chunk()
+            : committed(0)
+            , next(nullptr)
+        {
+        }
+
+        T items[ChunkSize];
+
+        /* number of items written to this chunk, published by the producer */
+        std::atomic<size_t> committed;
+
+        std::atomic<Chunk *> next;
+    };
+
+    SpscQueue(const SpscQueue&);
+    SpscQueue& operator=(const SpscQueue&);
+
+    /* producer only */
+    Chunk *m_tail;
+
+    /* consumer only */
+    Chunk *m_head;
+    size_t m_headIndex;
+
+    std::atomic<size_t> m_pushed;
+    std::atomic<size_t> m_popped;
+
+    /* drained chunk handed from the consumer back to the producer */
+    std::atomic<Chunk *> m_spare;
+};
+
+}
@@ -1,4 +1,6 @@
+#include <inttypes.h>
 #include <stdlib.h>
+#include <string.h>
 #include <tuple>
 #include <sstream>
 #include <utility>
@@ -7,14 +9,35 @@
 #include <cmath>
 #include <exception>
 #include <system_error>
+#include <atomic>
+#include <random>
 #include <zmq.h>
 #include "zmqclient.h"
 #include "binaryserializer.h"
+#include "shmring.h"
 
 using namespace std;
 
 namespace swss {
 
+// Roughly the serialized size of kco, for bounding merged async messages.
+static size_t estimatedSize(const KeyOpFieldsValuesTuple& kco)
+{
+    size_t size = kfvKey(kco).size() + kfvOp(kco).size() + 2 * sizeof(size_t);
+    for (const auto &fv : kfvFieldsValues(kco))
+    {
+        size += fvField(fv).size() + fvValue(fv).size() + 2 * sizeof(size_t);
+    }
+
+    return size;
+}
+
+// Frees a buffer handed to zmq_msg_init_data() once zmq has sent it.
+static void freeMessageBuffer(void* data, void* /*hint*/)
+{
+    delete[] static_cast<char*>(data);
+}
+
 ZmqClient::ZmqClient(const std::string& endpoint)
     : ZmqClient(endpoint, "")
 {
@@ -31,9 +54,27 @@ ZmqClient::ZmqClient(const std::string& endpoint, uint32_t waitTimeMs)
     initialize(endpoint);
 }
 
+ZmqClient::ZmqClient(const std::string& endpoint, uint32_t waitTimeMs, uint32_t window)
+    : m_waitTimeMs(waitTimeMs), m_oneToOneSync(m_waitTimeMs != 0), m_window(m_oneToOneSync ? window : 1)
+{
+    initialize(endpoint);
+}
+
 ZmqClient::~ZmqClient()
 {
+    // Sends what is still queued.
+    stopAsyncSend();
+
+    std::lock_guard<std::mutex> replayLock(m_replayMutex);
     std::lock_guard<std::mutex> lock(m_socketMutex);
+
+    closeMonitor();
+    for (auto &entry : m_replay)
+    {
+        zmq_msg_close(&entry.msg);
+    }
+    m_replay.clear();
+
     if (m_socket)
     {
         int rc = zmq_close(m_socket);
@@ -57,7 +98,7 @@ void ZmqClient::initialize(const std::string& endpoint, const std::string& vrf)
     m_context = nullptr;
     m_socket = nullptr;
     m_vrf = vrf;
-    m_sendbuffer.resize(MQ_RESPONSE_MAX_COUNT);
+    m_shmTransport = ShmRing::isShmEndpoint(endpoint);
 
     connect();
 }
@@ -75,7 +116,24 @@ void ZmqClient::connect()
         return;
     }
 
+    std::lock_guard<std::mutex> replayLock(m_replayMutex);
     std::lock_guard<std::mutex> lock(m_socketMutex);
+
+    if (m_shmTransport)
+    {
+        if (m_oneToOneSync)
+        {
+            SWSS_LOG_THROW("One-to-one sync is not supported on shared memory endpoint: %s", m_endpoint.c_str());
+        }
+
+        // Like zmq_connect(), succeeds before the server is up.
+        SWSS_LOG_NOTICE("connect to shared memory endpoint: %s", m_endpoint.c_str());
+        openShmRing();
+        m_connected = true;
+        return;
+    }
+
+    closeMonitor();
     if (m_socket)
     {
         int rc = zmq_close(m_socket);
@@ -83,6 +141,10 @@ void ZmqClient::connect()
         {
             SWSS_LOG_ERROR("failed to close zmq socket, zmqerrno: %d", zmq_errno());
         }
+
+        // Messages queued on the old socket are gone.
+        m_resumePending = true;
+        m_peerConnected = false;
     }
 
     if (m_context)
@@ -91,7 +153,11 @@ void ZmqClient::connect()
     }
     
     m_context = zmq_ctx_new();
-    if (m_oneToOneSync)
+    if (m_oneToOneSync && m_window > 1)
+    {
+        m_socket = zmq_socket(m_context, ZMQ_DEALER);
+    }
+    else if (m_oneToOneSync)
     {
         m_socket = zmq_socket(m_context, ZMQ_REQ);
     }
@@ -136,6 +202,15 @@ void ZmqClient::connect()
         zmq_setsockopt(m_socket, ZMQ_BINDTODEVICE, m_vrf.c_str(), m_vrf.length());
     }
 
+    if (m_replayEnabled)
+    {
+        // Don't queue messages while disconnected, they are replayed after
+        // the resume handshake instead, so the server gets them in order.
+        int immediate = 1;
+        zmq_setsockopt(m_socket, ZMQ_IMMEDIATE, &immediate, sizeof(immediate));
+        setupMonitor();
+    }
+
     SWSS_LOG_NOTICE("connect to zmq endpoint: %s", m_endpoint.c_str());
     int rc = zmq_connect(m_socket, m_endpoint.c_str());
 
@@ -147,6 +222,10 @@ void ZmqClient::connect()
                 zmq_errno());
     }
 
+    // Replies to requests sent on the old socket will never arrive.
+    m_pendingRequests.clear();
+    m_replies.clear();
+
     m_connected = true;
 }
 
@@ -155,20 +234,124 @@ void ZmqClient::sendMsg(
         const std::string& tableName,
         const std::vector<KeyOpFieldsValuesTuple>& kcos)
 {
-    int serializedlen = (int)BinarySerializer::serializeBuffer(
-                                                        m_sendbuffer.data(),
-                                                        m_sendbuffer.size(),
-                                                        dbName,
-                                                        tableName,
-                                                        kcos);
+    if (m_asyncSend)
+    {
+        queueAsync(dbName, tableName, kcos);
+        return;
+    }
 
-    if (serializedlen >= MQ_RESPONSE_MAX_COUNT)
+    sendNow(dbName, tableName, kcos);
+}
+
+void ZmqClient::sendNow(
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos)
+{
+    if (m_window > 1)
+    {
+        sendRequest(dbName, tableName, kcos);
+        return;
+    }
+
+    if (m_shmTransport)
+    {
+        sendShm(dbName, tableName, kcos);
+        return;
+    }
+
+    zmq_msg_t msg;
+    if (m_replayEnabled)
+    {
+        // Sequence numbers are assigned in send order.
+        std::lock_guard<std::mutex> lock(m_replayMutex);
+        checkReconnect();
+
+        uint64_t number = ++m_sequences[make_pair(dbName, tableName)];
+        size_t serializedlen = serializeMsg(msg, dbName, tableName, kcos, number);
+        addToReplay(dbName, tableName, number, msg);
+        sendSequenced(msg, serializedlen);
+        return;
+    }
+
+    size_t serializedlen = serializeMsg(msg, dbName, tableName, kcos);
+    sendWithRetry(msg, (int)serializedlen);
+}
+
+void ZmqClient::openShmRing()
+{
+    try
     {
-        SWSS_LOG_THROW("ZmqClient sendMsg message was too big (buffer size %d bytes, got %d), reduce the message size, message DROPPED",
+        m_shmRing.reset(new ShmRing(ShmRing::segmentName(m_endpoint), false));
+    }
+    catch (const std::runtime_error &e)
+    {
+        m_shmRing.reset();
+        SWSS_LOG_INFO("shared memory endpoint %s is not ready: %s", m_endpoint.c_str(), e.what());
+    }
+}
+
+void ZmqClient::sendShm(
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos)
+{
+    auto version = static_cast<BinarySerializer::Version>(m_wireFormatVersion);
+    size_t msgsize = BinarySerializer::serializedSize(dbName, tableName, kcos, version);
+    if (msgsize >= MQ_RESPONSE_MAX_COUNT)
+    {
+        SWSS_LOG_THROW("ZmqClient sendMsg message was too big (buffer size %d bytes, got %zu), reduce the message size, message DROPPED",
                 MQ_RESPONSE_MAX_COUNT,
-                serializedlen);
+                msgsize);
+    }
+
+    // Serialize straight into the ring.
+    auto fill = [&](char* buffer)
+    {
+        return BinarySerializer::serializeBuffer(buffer, msgsize, dbName, tableName, kcos, version);
+    };
+
+    int retry_delay = 10;
+    for (int i = 0; i <= MQ_MAX_RETRY; ++i)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_socketMutex);
+
+            // A full ring may belong to a server which is gone.
+            if (!m_shmRing || m_shmRing->isClosed() || (i > 0 && m_shmRing->isStale()))
+            {
+                openShmRing();
+            }
+
+            if (!m_shmRing)
+            {
+                // No server to queue for, unlike a socket there is no
+                // buffer before it creates the ring.
+                auto message = "shm send failed, endpoint: " + m_endpoint + " is not up, msg length:" + to_string(msgsize);
+                SWSS_LOG_ERROR("%s", message.c_str());
+                throw system_error(make_error_code(errc::connection_refused), message);
+            }
+
+            if (m_shmRing->push(msgsize, fill))
+            {
+                SWSS_LOG_DEBUG("shm sended %zu bytes", msgsize);
+                return;
+            }
+        }
+
+        // The server is slow, sleep (2 ^ retry time) * 10 ms
+        retry_delay *= 2;
+        SWSS_LOG_WARN("shared memory ring is full, will retry in %d ms, endpoint: %s", retry_delay, m_endpoint.c_str());
+        usleep(retry_delay * 1000);
     }
 
+    auto message = "shm send failed, endpoint: " + m_endpoint + ", msg length:" + to_string(msgsize);
+    SWSS_LOG_ERROR("%s", message.c_str());
+    throw system_error(make_error_code(errc::io_error), message);
+}
+
+void ZmqClient::sendWithRetry(zmq_msg_t& msg, int serializedlen)
+{
     SWSS_LOG_DEBUG("sending: %d", serializedlen);
     int zmq_err = 0;
     int retry_delay = 10;
@@ -180,13 +363,14 @@ void ZmqClient::sendMsg(
             std::lock_guard<std::mutex> lock(m_socketMutex);
 
             // Use none block mode to use all bandwidth: http://api.zeromq.org/2-1%3Azmq-send
+            // On failure the message is left untouched, so it can be resent.
             if (m_oneToOneSync)
             {
-                rc = zmq_send(m_socket, m_sendbuffer.data(), serializedlen, 0);
+                rc = zmq_msg_send(&msg, m_socket, 0);
             }
             else
             {
-                rc = zmq_send(m_socket, m_sendbuffer.data(), serializedlen, ZMQ_NOBLOCK);
+                rc = zmq_msg_send(&msg, m_socket, ZMQ_NOBLOCK);
             }
         }
         if (rc >= 0)
@@ -217,6 +401,7 @@ void ZmqClient::sendMsg(
         }
         else if (zmq_err == ETERM)
         {
+            zmq_msg_close(&msg);
             m_connected = false;
             auto message =  "zmq connection break, endpoint: " + m_endpoint + ", error: " + to_string(rc);
             SWSS_LOG_ERROR("%s", message.c_str());
@@ -224,6 +409,7 @@ void ZmqClient::sendMsg(
         }
         else
         {
+            zmq_msg_close(&msg);
             // for other error, send failed immediately.
             auto message =  "zmq send failed, endpoint: " + m_endpoint + ", error: " + to_string(rc);
             SWSS_LOG_ERROR("%s", message.c_str());
@@ -233,12 +419,768 @@ void ZmqClient::sendMsg(
         usleep(retry_delay * 1000);
     }
 
+    zmq_msg_close(&msg);
+
     // failed after retry
     auto message =  "zmq send failed, endpoint: " + m_endpoint + ", zmqerrno: " + to_string(zmq_err) + ":" + zmq_strerror(zmq_err) + ", msg length:" + to_string(serializedlen);
     SWSS_LOG_ERROR("%s", message.c_str());
     throw system_error(make_error_code(errc::io_error), message);
 }
 
+size_t ZmqClient::serializeMsg(
+        zmq_msg_t& msg,
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos,
+        uint64_t sequenceNumber)
+{
+    BinarySerializer::Sequence sequence;
+    sequence.session = m_session;
+    sequence.number = sequenceNumber;
+    const BinarySerializer::Sequence* sequencePtr = sequenceNumber ? &sequence : nullptr;
+
+    auto version = static_cast<BinarySerializer::Version>(m_wireFormatVersion);
+    size_t msgsize = BinarySerializer::serializedSize(dbName, tableName, kcos, version, sequencePtr);
+    if (msgsize >= MQ_RESPONSE_MAX_COUNT)
+    {
+        SWSS_LOG_THROW("ZmqClient sendMsg message was too big (buffer size %d bytes, got %zu), reduce the message size, message DROPPED",
+                MQ_RESPONSE_MAX_COUNT,
+                msgsize);
+    }
+
+    if (m_compression && msgsize >= m_compression->getThreshold())
+    {
+        // Serialize into a scratch buffer and compress into a second one.
+        // The zmq message takes over whichever is sent, the plain one if
+        // compression doesn't pay off, so the payload is never copied.
+        std::unique_ptr<char[]> plain(new char[msgsize]);
+        msgsize = BinarySerializer::serializeBuffer(plain.get(), msgsize, dbName, tableName, kcos, version, sequencePtr);
+
+        size_t bound = ZmqCompression::compressBound(msgsize);
+        std::unique_ptr<char[]> compressed(new char[bound]);
+        size_t compressedSize = m_compression->compress(plain.get(), msgsize, compressed.get(), bound);
+        std::unique_ptr<char[]>& payload = compressedSize ? compressed : plain;
+        size_t payloadSize = compressedSize ? compressedSize : msgsize;
+
+        if (zmq_msg_init_data(&msg, payload.get(), payloadSize, freeMessageBuffer, nullptr) != 0)
+        {
+            SWSS_LOG_THROW("zmq_msg_init_data failed, size: %zu, zmqerrno: %d", payloadSize, zmq_errno());
+        }
+
+        payload.release();
+        return payloadSize;
+    }
+
+    // Serialize straight into the zmq message body: zmq takes ownership of
+    // the allocation on send, so the payload is never copied again.
+    if (zmq_msg_init_size(&msg, msgsize) != 0)
+    {
+        SWSS_LOG_THROW("zmq_msg_init_size failed, size: %zu, zmqerrno: %d", msgsize, zmq_errno());
+    }
+
+    try
+    {
+        return BinarySerializer::serializeBuffer(
+                                                static_cast<char*>(zmq_msg_data(&msg)),
+                                                msgsize,
+                                                dbName,
+                                                tableName,
+                                                kcos,
+                                                version,
+                                                sequencePtr);
+    }
+    catch (...)
+    {
+        zmq_msg_close(&msg);
+        throw;
+    }
+}
+
+uint64_t ZmqClient::sendRequest(
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos)
+{
+    if (m_window <= 1)
+    {
+        sendMsg(dbName, tableName, kcos);
+        return 0;
+    }
+
+    zmq_msg_t msg;
+    size_t serializedlen = serializeMsg(msg, dbName, tableName, kcos);
+
+    std::lock_guard<std::mutex> lock(m_socketMutex);
+
+    // Requests without a reply yet, m_replies only holds replies to pending requests.
+    while (m_pendingRequests.size() - m_replies.size() >= m_window)
+    {
+        bool received;
+        try
+        {
+            received = receiveReply((int)m_waitTimeMs);
+        }
+        catch (...)
+        {
+            zmq_msg_close(&msg);
+            throw;
+        }
+
+        if (!received)
+        {
+            zmq_msg_close(&msg);
+            auto message = "zmq send failed, endpoint: " + m_endpoint + ", no reply within " + to_string(m_waitTimeMs) + " ms and the request window is full";
+            SWSS_LOG_ERROR("%s", message.c_str());
+            throw system_error(make_error_code(errc::timed_out), message);
+        }
+    }
+
+    uint64_t requestId = m_nextRequestId++;
+    int rc;
+    do
+    {
+        rc = zmq_send(m_socket, &requestId, sizeof(requestId), ZMQ_SNDMORE);
+        if (rc >= 0)
+        {
+            rc = zmq_msg_send(&msg, m_socket, 0);
+        }
+    } while (rc < 0 && zmq_errno() == EINTR);
+
+    if (rc < 0)
+    {
+        int zmq_err = zmq_errno();
+        zmq_msg_close(&msg);
+        if (zmq_err == ETERM)
+        {
+            m_connected = false;
+        }
+        auto message = "zmq send failed, endpoint: " + m_endpoint + ", zmqerrno: " + to_string(zmq_err) + ":" + zmq_strerror(zmq_err) + ", msg length:" + to_string(serializedlen);
+        SWSS_LOG_ERROR("%s", message.c_str());
+        throw system_error(make_error_code(zmq_err == ETERM ? errc::connection_reset : errc::io_error), message);
+    }
+
+    m_pendingRequests.push_back(requestId);
+    SWSS_LOG_DEBUG("zmq sent request %" PRIu64 ", %zu bytes", requestId, serializedlen);
+    return requestId;
+}
+
+bool ZmqClient::receiveReply(int timeoutMs)
+{
+    zmq_pollitem_t items[1] = {};
+    items[0].socket = m_socket;
+    items[0].events = ZMQ_POLLIN;
+
+    int rc;
+    for (int i = 0; true; ++i)
+    {
+        rc = zmq_poll(items, 1, timeoutMs);
+        if (rc == 0)
+        {
+            return false;
+        }
+        if (rc > 0)
+        {
+            break;
+        }
+        if (zmq_errno() == EINTR && i <= MQ_MAX_RETRY)
+        {
+            continue;
+        }
+        SWSS_LOG_THROW("zmq_poll failed, zmqerrno: %d", zmq_errno());
+    }
+
+    // The reply is the request id followed by the payload.
+    uint64_t requestId = 0;
+    bool valid = true;
+    std::string payload;
+    for (int part = 0; true; part++)
+    {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        do
+        {
+            rc = zmq_msg_recv(&frame, m_socket, 0);
+        } while (rc < 0 && zmq_errno() == EINTR);
+
+        if (rc < 0)
+        {
+            int zmq_err = zmq_errno();
+            zmq_msg_close(&frame);
+            SWSS_LOG_THROW("zmq_recv failed, zmqerrno: %d", zmq_err);
+        }
+
+        const char *data = static_cast<const char*>(zmq_msg_data(&frame));
+        size_t size = zmq_msg_size(&frame);
+        if (part == 0 && size == sizeof(requestId))
+        {
+            memcpy(&requestId, data, sizeof(requestId));
+        }
+        else if (part == 1)
+        {
+            payload.assign(data, size);
+        }
+        else
+        {
+            valid = false;
+        }
+
+        bool more = zmq_msg_more(&frame) != 0;
+        zmq_msg_close(&frame);
+        if (!more)
+        {
+            valid = valid && part == 1;
+            break;
+        }
+    }
+
+    if (!valid)
+    {
+        SWSS_LOG_ERROR("zmq received malformed reply, endpoint: %s, reply DROPPED", m_endpoint.c_str());
+        return true;
+    }
+
+    if (find(m_pendingRequests.begin(), m_pendingRequests.end(), requestId) == m_pendingRequests.end())
+    {
+        // Reply to a request which timed out earlier.
+        SWSS_LOG_WARN("zmq received reply to unknown request %" PRIu64 ", endpoint: %s", requestId, m_endpoint.c_str());
+        return true;
+    }
+
+    m_replies[requestId] = std::move(payload);
+    return true;
+}
+
+void ZmqClient::enableReplay(const std::string& resumeEndpoint, size_t maxMessages)
+{
+    if (m_oneToOneSync || m_shmTransport)
+    {
+        SWSS_LOG_THROW("Replay is not supported in one-to-one sync mode or on shared memory, endpoint: %s", m_endpoint.c_str());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_replayMutex);
+        if (m_replayEnabled)
+        {
+            SWSS_LOG_THROW("Replay is already enabled, endpoint: %s", m_endpoint.c_str());
+        }
+
+        // The session id tells the server when it talks to a new client instance.
+        std::random_device random;
+        do
+        {
+            m_session = ((uint64_t)random() << 32) | random();
+        } while (m_session == 0);
+
+        m_resumeEndpoint = resumeEndpoint;
+        m_replayMaxMessages = std::max<size_t>(maxMessages, 1);
+        m_wireFormatVersion = BinarySerializer::VERSION_2;
+        m_replayEnabled = true;
+        m_connected = false;
+    }
+
+    // Recreate the socket with the monitor and options replay relies on.
+    connect();
+}
+
+void ZmqClient::enableCompression(size_t threshold, int level)
+{
+    if (!ZmqCompression::isSupported())
+    {
+        SWSS_LOG_THROW("ZMQ compression is not supported, zstd support is not compiled in");
+    }
+
+    if (m_shmTransport)
+    {
+        SWSS_LOG_THROW("Compression is not supported on shared memory endpoint: %s", m_endpoint.c_str());
+    }
+
+    if (m_compression)
+    {
+        SWSS_LOG_THROW("Compression is already enabled, endpoint: %s", m_endpoint.c_str());
+    }
+
+    m_wireFormatVersion = BinarySerializer::VERSION_2;
+    m_compression.reset(new ZmqCompression(threshold, level));
+}
+
+ZmqCompression::Stats ZmqClient::getCompressionStats()
+{
+    if (!m_compression)
+    {
+        return ZmqCompression::Stats();
+    }
+
+    return m_compression->getStats();
+}
+
+bool ZmqClient::resume()
+{
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+    if (!m_replayEnabled)
+    {
+        return true;
+    }
+
+    checkReconnect();
+    return !m_resumePending && m_resyncRequired.empty();
+}
+
+std::vector<std::pair<std::string, std::string>> ZmqClient::getResyncRequiredTables()
+{
+    std::lock_guard<std::mutex> lock(m_replayMutex);
+
+    std::vector<std::pair<std::string, std::string>> tables(m_resyncRequired.begin(), m_resyncRequired.end());
+    m_resyncRequired.clear();
+    return tables;
+}
+
+void ZmqClient::setupMonitor()
+{
+    closeMonitor();
+
+    static std::atomic<uint64_t> monitorId(0);
+    std::string address = "inproc://zmqclient-monitor-" + to_string(monitorId++);
+    if (zmq_socket_monitor(m_socket, address.c_str(), ZMQ_EVENT_CONNECTED | ZMQ_EVENT_DISCONNECTED) != 0)
+    {
+        SWSS_LOG_THROW("zmq_socket_monitor failed, endpoint: %s, zmqerrno: %d", m_endpoint.c_str(), zmq_errno());
+    }
+
+    m_monitor = zmq_socket(m_context, ZMQ_PAIR);
+    if (zmq_connect(m_monitor, address.c_str()) != 0)
+    {
+        int zmq_err = zmq_errno();
+        closeMonitor();
+        SWSS_LOG_THROW("failed to connect zmq socket monitor, endpoint: %s, zmqerrno: %d", m_endpoint.c_str(), zmq_err);
+    }
+}
+
+void ZmqClient::closeMonitor()
+{
+    if (m_monitor)
+    {
+        zmq_close(m_monitor);
+        m_monitor = nullptr;
+    }
+}
+
+void ZmqClient::checkReconnect()
+{
+    pollMonitor();
+
+    if (m_resumePending && m_peerConnected)
+    {
+        resumeLocked();
+    }
+}
+
+void ZmqClient::pollMonitor()
+{
+    while (m_monitor)
+    {
+        // An event is a 6 bytes frame holding the event id and a value,
+        // followed by a frame with the endpoint.
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        if (zmq_msg_recv(&frame, m_monitor, ZMQ_DONTWAIT) < 0)
+        {
+            zmq_msg_close(&frame);
+            break;
+        }
+
+        uint16_t event = 0;
+        if (zmq_msg_size(&frame) >= sizeof(event))
+        {
+            memcpy(&event, zmq_msg_data(&frame), sizeof(event));
+        }
+        bool more = zmq_msg_more(&frame) != 0;
+        zmq_msg_close(&frame);
+
+        while (more)
+        {
+            zmq_msg_init(&frame);
+            more = zmq_msg_recv(&frame, m_monitor, 0) >= 0 && zmq_msg_more(&frame);
+            zmq_msg_close(&frame);
+        }
+
+        if (event == ZMQ_EVENT_CONNECTED)
+        {
+            m_peerConnected = true;
+        }
+        else if (event == ZMQ_EVENT_DISCONNECTED)
+        {
+            // Whatever was in flight on the old connection may be lost.
+            m_peerConnected = false;
+            m_resumePending = true;
+        }
+    }
+}
+
+void ZmqClient::sendSequenced(zmq_msg_t& msg, size_t serializedlen)
+{
+    int retry_delay = 10;
+    for (int i = 0; i <= MQ_MAX_RETRY; ++i)
+    {
+        if (m_resumePending || !m_peerConnected)
+        {
+            // Kept in the replay buffer, the resume sends it once connected.
+            zmq_msg_close(&msg);
+            m_resumePending = true;
+            return;
+        }
+
+        if (trySend(msg))
+        {
+            SWSS_LOG_DEBUG("zmq sended %zu bytes", serializedlen);
+            return;
+        }
+
+        int zmq_err = zmq_errno();
+        if (zmq_err != EAGAIN && zmq_err != EINTR)
+        {
+            zmq_msg_close(&msg);
+            auto message =  "zmq send failed, endpoint: " + m_endpoint + ", zmqerrno: " + to_string(zmq_err) + ":" + zmq_strerror(zmq_err);
+            SWSS_LOG_ERROR("%s", message.c_str());
+            throw system_error(make_error_code(errc::io_error), message);
+        }
+
+        // Still connected the server is just slow, back off like any other
+        // send. A disconnect in the meantime hands the message to the resume.
+        retry_delay *= 2;
+        SWSS_LOG_WARN("zmq is full, will retry in %d ms, endpoint: %s, error: %d", retry_delay, m_endpoint.c_str(), zmq_err);
+        usleep(retry_delay * 1000);
+        pollMonitor();
+    }
+
+    zmq_msg_close(&msg);
+
+    auto message =  "zmq send failed, endpoint: " + m_endpoint + ", msg length:" + to_string(serializedlen);
+    SWSS_LOG_ERROR("%s", message.c_str());
+    throw system_error(make_error_code(errc::io_error), message);
+}
+
+bool ZmqClient::trySend(zmq_msg_t& msg)
+{
+    std::lock_guard<std::mutex> lock(m_socketMutex);
+    return zmq_msg_send(&msg, m_socket, ZMQ_NOBLOCK) >= 0;
+}
+
+void ZmqClient::addToReplay(
+        const std::string& dbName,
+        const std::string& tableName,
+        uint64_t number,
+        zmq_msg_t& msg)
+{
+    if (m_replay.size() >= m_replayMaxMessages)
+    {
+        auto &oldest = m_replay.front();
+        auto &evicted = m_evicted[make_pair(oldest.dbName, oldest.tableName)];
+        evicted = std::max(evicted, oldest.number);
+        zmq_msg_close(&oldest.msg);
+        m_replay.pop_front();
+    }
+
+    // zmq_msg_copy() shares the payload instead of copying it.
+    m_replay.emplace_back();
+    auto &entry = m_replay.back();
+    entry.dbName = dbName;
+    entry.tableName = tableName;
+    entry.number = number;
+    zmq_msg_init(&entry.msg);
+    zmq_msg_copy(&entry.msg, &msg);
+}
+
+void ZmqClient::resumeLocked()
+{
+    if (m_sequences.empty())
+    {
+        m_resumePending = false;
+        return;
+    }
+
+    std::vector<KeyOpFieldsValuesTuple> request;
+    for (const auto &stream : m_sequences)
+    {
+        request.emplace_back(stream.first.first, SET_COMMAND, std::vector<FieldValueTuple>{{stream.first.second, ""}});
+    }
+
+    std::string sessionStr = to_string(m_session);
+    std::string payload(BinarySerializer::serializedSize(ZMQ_RESUME_DB, sessionStr, request, BinarySerializer::VERSION_2), '\0');
+    payload.resize(BinarySerializer::serializeBuffer(&payload[0], payload.size(), ZMQ_RESUME_DB, sessionStr, request, BinarySerializer::VERSION_2));
+
+    void* socket = zmq_socket(m_context, ZMQ_REQ);
+    int linger = 0;
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    int timeout = MQ_POLL_TIMEOUT;
+    zmq_setsockopt(socket, ZMQ_SNDTIMEO, &timeout, sizeof(timeout));
+    zmq_setsockopt(socket, ZMQ_RCVTIMEO, &timeout, sizeof(timeout));
+    if (!m_vrf.empty())
+    {
+        zmq_setsockopt(socket, ZMQ_BINDTODEVICE, m_vrf.c_str(), m_vrf.length());
+    }
+
+    std::string dbName;
+    std::string session;
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> reply;
+    std::map<std::pair<std::string, std::string>, uint64_t> applied;
+    bool replied = false;
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    if (zmq_connect(socket, m_resumeEndpoint.c_str()) == 0
+        && zmq_send(socket, payload.data(), payload.size(), 0) >= 0
+        && zmq_msg_recv(&msg, socket, 0) > 0)
+    {
+        try
+        {
+            BinarySerializer::deserializeBuffer(static_cast<const char*>(zmq_msg_data(&msg)), zmq_msg_size(&msg), dbName, session, reply);
+            for (const auto &kco : reply)
+            {
+                for (const auto &fv : kfvFieldsValues(*kco))
+                {
+                    applied[make_pair(kfvKey(*kco), fvField(fv))] = stoull(fvValue(fv));
+                }
+            }
+            replied = dbName == ZMQ_RESUME_DB && session == sessionStr;
+        }
+        catch (const std::exception &e)
+        {
+            SWSS_LOG_ERROR("failed to parse resume reply, endpoint: %s, error: %s", m_resumeEndpoint.c_str(), e.what());
+        }
+    }
+    zmq_msg_close(&msg);
+    zmq_close(socket);
+
+    if (!replied)
+    {
+        // Try again with the next message.
+        SWSS_LOG_WARN("zmq resume failed, endpoint: %s, zmqerrno: %d", m_resumeEndpoint.c_str(), zmq_errno());
+        return;
+    }
+
+    for (const auto &stream : m_sequences)
+    {
+        auto evicted = m_evicted.find(stream.first);
+        if (evicted != m_evicted.end() && applied[stream.first] < evicted->second)
+        {
+            // The gap starts before the oldest message kept for replay.
+            SWSS_LOG_ERROR("zmq can't replay db: %s, table: %s from message %" PRIu64 ", full resync required",
+                           stream.first.first.c_str(), stream.first.second.c_str(), applied[stream.first] + 1);
+            m_resyncRequired.insert(stream.first);
+        }
+    }
+
+    size_t replayed = 0;
+    for (auto &entry : m_replay)
+    {
+        auto stream = make_pair(entry.dbName, entry.tableName);
+        if (entry.number <= applied[stream] || m_resyncRequired.count(stream))
+        {
+            continue;
+        }
+
+        zmq_msg_t copy;
+        zmq_msg_init(&copy);
+        zmq_msg_copy(&copy, &entry.msg);
+        if (!trySend(copy))
+        {
+            // The server reports what it got so far on the next resume.
+            zmq_msg_close(&copy);
+            SWSS_LOG_WARN("zmq replay interrupted, endpoint: %s, replayed %zu messages", m_endpoint.c_str(), replayed);
+            return;
+        }
+        replayed++;
+    }
+
+    SWSS_LOG_NOTICE("zmq resumed on endpoint: %s, replayed %zu messages", m_endpoint.c_str(), replayed);
+    m_resumePending = false;
+}
+
+void ZmqClient::enableAsyncSend(size_t maxQueueSize, AsyncSendPolicy policy)
+{
+    if (m_oneToOneSync)
+    {
+        SWSS_LOG_THROW("Async send is not supported in one-to-one sync mode, endpoint: %s", m_endpoint.c_str());
+    }
+
+    std::lock_guard<std::mutex> lock(m_asyncMutex);
+    if (m_asyncThread)
+    {
+        SWSS_LOG_THROW("Async send is already enabled, endpoint: %s", m_endpoint.c_str());
+    }
+
+    m_asyncMaxQueueSize = std::max<size_t>(maxQueueSize, 1);
+    m_asyncPolicy = policy;
+    m_asyncStop = false;
+    m_asyncThread = std::make_shared<std::thread>(&ZmqClient::asyncSendThread, this);
+    m_asyncSend = true;
+}
+
+void ZmqClient::stopAsyncSend()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        if (!m_asyncThread)
+        {
+            return;
+        }
+
+        m_asyncStop = true;
+    }
+    m_asyncCv.notify_all();
+
+    m_asyncThread->join();
+    m_asyncThread = nullptr;
+    m_asyncSend = false;
+}
+
+void ZmqClient::flush()
+{
+    std::unique_lock<std::mutex> lock(m_asyncMutex);
+    m_asyncCv.wait(lock, [this]() { return m_asyncQueue.empty() && !m_asyncBusy; });
+}
+
+ZmqClient::AsyncSendStats ZmqClient::getAsyncSendStats()
+{
+    std::lock_guard<std::mutex> lock(m_asyncMutex);
+
+    AsyncSendStats stats = m_asyncStats;
+    stats.depth = m_asyncQueue.size();
+    return stats;
+}
+
+void ZmqClient::queueAsync(
+        const std::string& dbName,
+        const std::string& tableName,
+        const std::vector<KeyOpFieldsValuesTuple>& kcos)
+{
+    std::unique_lock<std::mutex> lock(m_asyncMutex);
+    if (m_asyncQueue.size() >= m_asyncMaxQueueSize)
+    {
+        if (m_asyncPolicy == AsyncSendPolicy::Block)
+        {
+            m_asyncCv.wait(lock, [this]() { return m_asyncQueue.size() < m_asyncMaxQueueSize; });
+        }
+        else if (m_asyncPolicy == AsyncSendPolicy::DropOldest)
+        {
+            m_asyncQueue.pop_front();
+            m_asyncStats.dropped++;
+        }
+        else
+        {
+            m_asyncStats.rejected++;
+            auto message = "zmq async send queue is full, endpoint: " + m_endpoint + ", size: " + to_string(m_asyncQueue.size());
+            SWSS_LOG_ERROR("%s", message.c_str());
+            throw system_error(make_error_code(errc::no_buffer_space), message);
+        }
+    }
+
+    m_asyncQueue.push_back(AsyncMessage{dbName, tableName, kcos});
+    m_asyncStats.enqueued++;
+    m_asyncStats.maxDepth = std::max(m_asyncStats.maxDepth, m_asyncQueue.size());
+    lock.unlock();
+
+    m_asyncCv.notify_all();
+}
+
+void ZmqClient::asyncSendThread()
+{
+    SWSS_LOG_ENTER();
+
+    std::deque<AsyncMessage> batch;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_asyncMutex);
+            m_asyncBusy = false;
+            m_asyncCv.notify_all();
+            m_asyncCv.wait(lock, [this]() { return m_asyncStop || !m_asyncQueue.empty(); });
+            if (m_asyncQueue.empty())
+            {
+                break;
+            }
+
+            // Take everything, producers get the whole queue back.
+            batch.swap(m_asyncQueue);
+            m_asyncBusy = true;
+        }
+        m_asyncCv.notify_all();
+
+        uint64_t sent = 0;
+        uint64_t failed = 0;
+        while (!batch.empty())
+        {
+            // Merge consecutive messages of the same table, up to roughly a
+            // quarter of the largest message the server accepts.
+            AsyncMessage message = std::move(batch.front());
+            batch.pop_front();
+            size_t merged = 1;
+            size_t size = 0;
+            for (const auto &kco : message.kcos)
+            {
+                size += estimatedSize(kco);
+            }
+
+            while (!batch.empty()
+                   && batch.front().dbName == message.dbName
+                   && batch.front().tableName == message.tableName)
+            {
+                size_t nextSize = 0;
+                for (const auto &kco : batch.front().kcos)
+                {
+                    nextSize += estimatedSize(kco);
+                }
+
+                if (size + nextSize > MQ_RESPONSE_MAX_COUNT / 4)
+                {
+                    break;
+                }
+
+                size += nextSize;
+                auto &kcos = batch.front().kcos;
+                message.kcos.insert(message.kcos.end(),
+                                    std::make_move_iterator(kcos.begin()),
+                                    std::make_move_iterator(kcos.end()));
+                batch.pop_front();
+                merged++;
+            }
+
+            try
+            {
+                sendNow(message.dbName, message.tableName, message.kcos);
+                sent++;
+            }
+            catch (const std::exception &e)
+            {
+                SWSS_LOG_ERROR("zmq async send failed, endpoint: %s, error: %s, %zu messages DROPPED", m_endpoint.c_str(), e.what(), merged);
+                failed += merged;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(m_asyncMutex);
+        m_asyncStats.sent += sent;
+        m_asyncStats.failed += failed;
+    }
+}
+
+void ZmqClient::setWireFormatVersion(int version)
+{
+    if (version != BinarySerializer::VERSION_1 && version != BinarySerializer::VERSION_2)
+    {
+        SWSS_LOG_THROW("Unsupported ZMQ wire format version: %d", version);
+    }
+
+    if (m_replayEnabled && version != BinarySerializer::VERSION_2)
+    {
+        SWSS_LOG_THROW("Replay requires ZMQ wire format version 2");
+    }
+
+    if (m_compression && version != BinarySerializer::VERSION_2)
+    {
+        SWSS_LOG_THROW("Compression requires ZMQ wire format version 2");
+    }
+
+    m_wireFormatVersion = version;
+}
+
 bool ZmqClient::wait(
     std::string &dbName, std::string &tableName,
     std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> &kcos) {
@@ -248,6 +1190,19 @@ bool ZmqClient::wait(
     return false;
   }
 
+  if (m_window > 1) {
+    uint64_t requestId;
+    {
+      std::lock_guard<std::mutex> lock(m_socketMutex);
+      if (m_pendingRequests.empty()) {
+        SWSS_LOG_ERROR("no request is waiting for a reply");
+        return false;
+      }
+      requestId = m_pendingRequests.front();
+    }
+    return wait(requestId, dbName, tableName, kcos);
+  }
+
   zmq_pollitem_t items[1] = {};
   items[0].socket = m_socket;
   items[0].events = ZMQ_POLLIN;
@@ -270,30 +1225,74 @@ bool ZmqClient::wait(
     SWSS_LOG_THROW("zmq_poll failed, zmqerrno: %d", zmq_errno());
   }
 
+  zmq_msg_t msg;
+  zmq_msg_init(&msg);
   for (int i = 0; true; ++i) {
-    rc = zmq_recv(m_socket, m_sendbuffer.data(), m_sendbuffer.size(), 0);
+    rc = zmq_msg_recv(&msg, m_socket, 0);
 
     if (rc < 0) {
       if (zmq_errno() == EINTR && i <= MQ_MAX_RETRY) {
         continue;
       }
+      zmq_msg_close(&msg);
       SWSS_LOG_THROW("zmq_recv failed, zmqerrno: %d", zmq_errno());
     }
-    if (rc >= (int)m_sendbuffer.size()) {
-      SWSS_LOG_THROW(
-          "zmq_recv message was truncated (over %d bytes, received %d), "
-          "increase buffer size, message DROPPED",
-          (int)m_sendbuffer.size(), rc);
-    }
     break;
   }
 
-  m_sendbuffer.at(rc) =
-      0;  // make sure that we end string with zero before parse
   kcos.clear();
-  BinarySerializer::deserializeBuffer(m_sendbuffer.data(), m_sendbuffer.size(),
-                                      dbName, tableName, kcos);
+  try {
+    BinarySerializer::deserializeBuffer(
+        static_cast<const char *>(zmq_msg_data(&msg)), zmq_msg_size(&msg),
+        dbName, tableName, kcos);
+  } catch (...) {
+    zmq_msg_close(&msg);
+    throw;
+  }
+  zmq_msg_close(&msg);
+
+  return true;
+}
 
+bool ZmqClient::wait(
+    uint64_t requestId, std::string &dbName, std::string &tableName,
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> &kcos) {
+  SWSS_LOG_ENTER();
+
+  if (m_window <= 1) {
+    SWSS_LOG_ERROR("waiting for a request id requires pipelined one-to-one sync mode");
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(m_socketMutex);
+
+  auto pending = find(m_pendingRequests.begin(), m_pendingRequests.end(), requestId);
+  if (pending == m_pendingRequests.end()) {
+    SWSS_LOG_ERROR("request %" PRIu64 " is not waiting for a reply", requestId);
+    return false;
+  }
+
+  auto deadline = chrono::steady_clock::now() + chrono::milliseconds(m_waitTimeMs);
+  auto reply = m_replies.find(requestId);
+  while (reply == m_replies.end()) {
+    auto remaining = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+    if (remaining < 0 || !receiveReply((int)remaining)) {
+      // Give up on the request so it no longer holds a window slot, a late
+      // reply is dropped by receiveReply().
+      SWSS_LOG_ERROR("zmq_poll timed out, request %" PRIu64 " abandoned", requestId);
+      m_pendingRequests.erase(pending);
+      return false;
+    }
+    reply = m_replies.find(requestId);
+  }
+
+  // The request is done with, even if its reply can't be decoded.
+  std::string payload = std::move(reply->second);
+  m_replies.erase(reply);
+  m_pendingRequests.erase(find(m_pendingRequests.begin(), m_pendingRequests.end(), requestId));
+
+  kcos.clear();
+  BinarySerializer::deserializeBuffer(payload.data(), payload.size(), dbName, tableName, kcos);
   return true;
 }
 
@@ -1,24 +1,53 @@
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <map>
+#include <set>
 #include <memory>
 #include <vector>
 #include <queue>
 #include <thread> 
 #include <mutex> 
+#include <condition_variable>
 #include "zmqserver.h"
 
 namespace swss {
 
+class ShmRing;
+
+// What sendMsg() does in async send mode when the queue is full.
+enum class AsyncSendPolicy {
+    // Wait for the sender thread to make room.
+    Block,
+
+    // Drop the oldest queued message to make room.
+    DropOldest,
+
+    // Throw std::system_error with errc::no_buffer_space.
+    Error
+};
+
 class ZmqClient
 {
 public:
 
+    // An "shm://name" endpoint uses a shared memory ring instead of a
+    // socket to reach the ZmqServer of the same endpoint on this host, see
+    // ShmRing. One-to-one sync and replay are not supported over it. There
+    // is no queue before the server creates the ring, sendMsg() throws
+    // std::system_error while the server isn't up.
     ZmqClient(const std::string& endpoint);
     ZmqClient(const std::string& endpoint, const std::string& vrf);
     // If waitTimeMs is set to non-zero, it will enable one-to-one sync with the
     // server. It will use ZMQ_REQ and ZMQ_REP socket type. There can only be
     // one client and one server for a ZMQ socket.
     ZmqClient(const std::string& endpoint, uint32_t waitTimeMs);
+    // One-to-one sync with up to window requests waiting for their replies at
+    // the same time. A window above 1 uses a ZMQ_DEALER socket and tags every
+    // request with an id, replies are matched to requests by that id. The
+    // server side needs no configuration.
+    ZmqClient(const std::string& endpoint, uint32_t waitTimeMs, uint32_t window);
     ~ZmqClient();
 
     bool isConnected();
@@ -29,14 +58,163 @@ public:
                  const std::string& tableName,
                  const std::vector<KeyOpFieldsValuesTuple>& kcos);
 
+    // Wire format version used by sendMsg(), see BinarySerializer::Version.
+    // ZmqServer detects the version of every message it receives, so version 2
+    // can be enabled once all servers this client talks to understand it.
+    void setWireFormatVersion(int version);
+
+    /*
+     * Number every message per (db, table) and keep the last maxMessages
+     * sent for replay. When the connection to the server drops, new
+     * messages are only buffered; once it is re-established the client asks
+     * the ZmqServer's resume endpoint (see ZmqServer::enableResume) for the
+     * last message applied per table and retransmits, in order, only what
+     * the server is missing. Tables whose missing messages were already
+     * dropped from the replay buffer are reported by
+     * getResyncRequiredTables() and need a full resync. Switches the wire
+     * format to version 2 and reconnects, so call it before sending. Not
+     * supported in one-to-one sync mode.
+     */
+    void enableReplay(const std::string& resumeEndpoint, size_t maxMessages = DEFAULT_REPLAY_MESSAGES);
+
+    // Resume happens on the next sendMsg() after a reconnect. Call this to
+    // do it without sending, e.g. periodically while idle. Returns true when
+    // all buffered messages have reached the server and no table needs a
+    // resync.
+    bool resume();
+
+    // (db, table) pairs which could not be recovered by replay since the
+    // last call.
+    std::vector<std::pair<std::string, std::string>> getResyncRequiredTables();
+
+    static constexpr size_t DEFAULT_REPLAY_MESSAGES = 4096;
+
+    /*
+     * Compress messages of at least threshold serialized bytes with zstd,
+     * see ZmqCompression. Servers decompress flagged messages on their own,
+     * so this only needs servers built with compression support. Switches
+     * the wire format to version 2, so call it before sending. Throws if
+     * compression is not compiled in, and on shared memory endpoints, which
+     * don't benefit from it.
+     */
+    void enableCompression(size_t threshold = ZmqCompression::DEFAULT_THRESHOLD,
+                           int level = ZmqCompression::DEFAULT_LEVEL);
+
+    ZmqCompression::Stats getCompressionStats();
+
+    /*
+     * Make sendMsg() only queue the message. A dedicated sender thread
+     * serializes and sends queued messages, merging consecutive messages of
+     * the same table into one, so the caller never waits on a full socket.
+     * policy decides what happens when maxQueueSize messages are queued.
+     * Send failures are logged and counted instead of thrown. Not supported
+     * in one-to-one sync mode.
+     */
+    void enableAsyncSend(size_t maxQueueSize = DEFAULT_ASYNC_QUEUE_SIZE,
+                         AsyncSendPolicy policy = AsyncSendPolicy::Block);
+
+    // Wait until all messages queued so far are sent.
+    void flush();
+
+    struct AsyncSendStats
+    {
+        size_t depth;          // messages queued now
+        size_t maxDepth;       // highest depth seen
+        uint64_t enqueued;     // messages accepted by sendMsg()
+        uint64_t sent;         // zmq messages sent, after merging
+        uint64_t dropped;      // dropped by AsyncSendPolicy::DropOldest
+        uint64_t rejected;     // refused by AsyncSendPolicy::Error
+        uint64_t failed;       // messages lost to send errors
+    };
+
+    AsyncSendStats getAsyncSendStats();
+
+    static constexpr size_t DEFAULT_ASYNC_QUEUE_SIZE = MQ_WATERMARK;
+
+    // Same as sendMsg(), returns the id of the request for wait() in
+    // pipelined one-to-one sync mode, 0 otherwise. Blocks while the window is
+    // full, and throws if no reply arrives within the wait time.
+    uint64_t sendRequest(const std::string& dbName,
+                         const std::string& tableName,
+                         const std::vector<KeyOpFieldsValuesTuple>& kcos);
+
     // This method should only be used in one-to-one sync mode with the server.
+    // In pipelined mode it waits for the reply to the oldest request which
+    // has not been waited for.
     bool wait(std::string& dbName,
               std::string& tableName,
               std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos);
 
+    // Wait for the reply to the given request in pipelined one-to-one sync mode.
+    // On timeout the request is abandoned and its reply ignored.
+    bool wait(uint64_t requestId,
+              std::string& dbName,
+              std::string& tableName,
+              std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos);
+
 private:
     void initialize(const std::string& endpoint, const std::string& vrf = "");
 
+    // sendMsg() on the calling thread.
+    void sendNow(const std::string& dbName,
+                 const std::string& tableName,
+                 const std::vector<KeyOpFieldsValuesTuple>& kcos);
+
+    void sendShm(const std::string& dbName,
+                 const std::string& tableName,
+                 const std::vector<KeyOpFieldsValuesTuple>& kcos);
+
+    // Requires m_socketMutex, leaves m_shmRing null if the server isn't up.
+    void openShmRing();
+
+    void queueAsync(const std::string& dbName,
+                    const std::string& tableName,
+                    const std::vector<KeyOpFieldsValuesTuple>& kcos);
+
+    void asyncSendThread();
+
+    void stopAsyncSend();
+
+    // Initialize msg with the serialized message, returns the serialized length.
+    size_t serializeMsg(zmq_msg_t& msg,
+                        const std::string& dbName,
+                        const std::string& tableName,
+                        const std::vector<KeyOpFieldsValuesTuple>& kcos,
+                        uint64_t sequenceNumber = 0);
+
+    // Send msg, retrying while the socket is busy. msg is closed in any case.
+    void sendWithRetry(zmq_msg_t& msg, int serializedlen);
+
+    // Replay helpers, all require m_replayMutex.
+    void setupMonitor();
+
+    void closeMonitor();
+
+    // Track connection events and resume when needed and connected.
+    void checkReconnect();
+
+    // Track connection events only.
+    void pollMonitor();
+
+    // Send a message kept for replay. While connected a full queue is
+    // retried like sendWithRetry(), while disconnected the message waits
+    // for the resume. msg is closed in any case.
+    void sendSequenced(zmq_msg_t& msg, size_t serializedlen);
+
+    // Single non-blocking send, msg is left untouched on failure.
+    bool trySend(zmq_msg_t& msg);
+
+    void addToReplay(const std::string& dbName,
+                     const std::string& tableName,
+                     uint64_t number,
+                     zmq_msg_t& msg);
+
+    void resumeLocked();
+
+    // Receive one reply in pipelined mode, false on timeout.
+    // Requires m_socketMutex.
+    bool receiveReply(int timeoutMs);
+
     std::string m_endpoint;
 
     std::string m_vrf;
@@ -52,9 +230,69 @@ private:
 
     bool m_oneToOneSync = false;
 
+    int m_wireFormatVersion = 1;
+
+    std::unique_ptr<ZmqCompression> m_compression;
+
+    // Shared memory transport, used instead of m_socket.
+    bool m_shmTransport = false;
+    std::unique_ptr<ShmRing> m_shmRing;
+
+    // Pipelined one-to-one sync, enabled when m_window is above 1.
+    uint32_t m_window = 1;
+    uint64_t m_nextRequestId = 1;
+    // Requests which have not been waited for, in send order.
+    std::deque<uint64_t> m_pendingRequests;
+    // Replies received for those requests.
+    std::map<uint64_t, std::string> m_replies;
+
+    // Replay, lock order is m_replayMutex before m_socketMutex.
+    std::mutex m_replayMutex;
+    std::atomic<bool> m_replayEnabled{false};
+    bool m_resumePending = false;
+    bool m_peerConnected = false;
+    uint64_t m_session = 0;
+    std::string m_resumeEndpoint;
+    size_t m_replayMaxMessages = DEFAULT_REPLAY_MESSAGES;
+    void* m_monitor = nullptr;
+
+    // Last sequence number sent per (db, table).
+    std::map<std::pair<std::string, std::string>, uint64_t> m_sequences;
+    // Highest sequence number dropped from the replay buffer per (db, table).
+    std::map<std::pair<std::string, std::string>, uint64_t> m_evicted;
+    std::set<std::pair<std::string, std::string>> m_resyncRequired;
+
+    struct ReplayEntry
+    {
+        std::string dbName;
+        std::string tableName;
+        uint64_t number;
+        zmq_msg_t msg;
+    };
+
+    std::deque<ReplayEntry> m_replay;
+
     std::mutex m_socketMutex;
 
-    std::vector<char> m_sendbuffer;
+    // Async send mode.
+    struct AsyncMessage
+    {
+        std::string dbName;
+        std::string tableName;
+        std::vector<KeyOpFieldsValuesTuple> kcos;
+    };
+
+    std::atomic<bool> m_asyncSend{false};
+    AsyncSendPolicy m_asyncPolicy = AsyncSendPolicy::Block;
+    size_t m_asyncMaxQueueSize = DEFAULT_ASYNC_QUEUE_SIZE;
+    std::mutex m_asyncMutex;
+    std::condition_variable m_asyncCv;
+    std::deque<AsyncMessage> m_asyncQueue;
+    // The sender thread is working on messages taken off the queue.
+    bool m_asyncBusy = false;
+    bool m_asyncStop = false;
+    AsyncSendStats m_asyncStats = AsyncSendStats();
+    std::shared_ptr<std::thread> m_asyncThread;
 };
 
 }
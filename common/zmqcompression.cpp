@@ -0,0 +1,227 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+#include <time.h>
+#include <memory>
+
+#include "common/binaryserializer.h"
+#include "common/logger.h"
+#include "common/zmqcompression.h"
+
+#if defined(HAVE_ZSTD_H) && defined(HAVE_LIBZSTD)
+#include <zstd.h>
+#define SWSS_ZSTD 1
+#endif
+
+using namespace std;
+
+namespace swss {
+
+constexpr size_t ZmqCompression::DEFAULT_THRESHOLD;
+constexpr int ZmqCompression::DEFAULT_LEVEL;
+
+// CPU time of the calling thread, the compression cost without waiting.
+static uint64_t threadCpuUs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+double ZmqCompression::Stats::ratio() const
+{
+    return bytesOut == 0 ? 1.0 : (double)bytesIn / (double)bytesOut;
+}
+
+ZmqCompression::ZmqCompression(size_t threshold, int level)
+    : m_threshold(threshold)
+    , m_level(level)
+    , m_context(nullptr)
+    , m_compressed(0)
+    , m_skipped(0)
+    , m_bytesIn(0)
+    , m_bytesOut(0)
+    , m_compressUs(0)
+    , m_decompressed(0)
+    , m_decompressUs(0)
+    , m_decompressFailed(0)
+{
+}
+
+ZmqCompression::~ZmqCompression()
+{
+#ifdef SWSS_ZSTD
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(m_context));
+#endif
+}
+
+bool ZmqCompression::isSupported()
+{
+#ifdef SWSS_ZSTD
+    return true;
+#else
+    return false;
+#endif
+}
+
+size_t ZmqCompression::getThreshold() const
+{
+    return m_threshold;
+}
+
+ZmqCompression::Stats ZmqCompression::getStats() const
+{
+    Stats stats;
+    stats.compressed = m_compressed.load();
+    stats.skipped = m_skipped.load();
+    stats.bytesIn = m_bytesIn.load();
+    stats.bytesOut = m_bytesOut.load();
+    stats.compressUs = m_compressUs.load();
+    stats.decompressed = m_decompressed.load();
+    stats.decompressUs = m_decompressUs.load();
+    stats.decompressFailed = m_decompressFailed.load();
+    return stats;
+}
+
+void ZmqCompression::decompress(const char* src, size_t size, std::string& out, size_t maxSize)
+{
+    try
+    {
+        decompressMessage(src, size, out, maxSize);
+    }
+    catch (...)
+    {
+        m_decompressFailed++;
+        throw;
+    }
+}
+
+#ifdef SWSS_ZSTD
+
+size_t ZmqCompression::compressBound(size_t size)
+{
+    return size + ZSTD_compressBound(size);
+}
+
+size_t ZmqCompression::compress(const char* src, size_t size, char* dst, size_t dstSize)
+{
+    if (size < m_threshold || dstSize < compressBound(size))
+    {
+        m_skipped++;
+        return 0;
+    }
+
+    uint64_t start = threadCpuUs();
+
+    // The header and names are copied, only the operations are compressed.
+    size_t offset = BinarySerializer::getOperationsOffset(src, size);
+    memcpy(dst, src, offset);
+    BinarySerializer::setCompressed(dst, offset, true);
+
+    size_t rc;
+    {
+        lock_guard<mutex> lock(m_contextMutex);
+        if (m_context == nullptr)
+        {
+            m_context = ZSTD_createCCtx();
+            if (m_context == nullptr)
+            {
+                SWSS_LOG_THROW("ZSTD_createCCtx failed");
+            }
+        }
+
+        rc = ZSTD_compressCCtx(static_cast<ZSTD_CCtx*>(m_context), dst + offset, dstSize - offset,
+                               src + offset, size - offset, m_level);
+    }
+
+    m_compressUs += threadCpuUs() - start;
+
+    if (ZSTD_isError(rc))
+    {
+        SWSS_LOG_THROW("ZSTD_compressCCtx failed: %s", ZSTD_getErrorName(rc));
+    }
+
+    if (offset + rc >= size)
+    {
+        m_skipped++;
+        return 0;
+    }
+
+    m_compressed++;
+    m_bytesIn += size;
+    m_bytesOut += offset + rc;
+    return offset + rc;
+}
+
+void ZmqCompression::decompressMessage(const char* src, size_t size, std::string& out, size_t maxSize)
+{
+    struct ContextDeleter
+    {
+        void operator()(ZSTD_DCtx* context) const
+        {
+            ZSTD_freeDCtx(context);
+        }
+    };
+
+    // Decode workers decompress in parallel, each with its own context.
+    static thread_local unique_ptr<ZSTD_DCtx, ContextDeleter> context;
+    if (!context)
+    {
+        context.reset(ZSTD_createDCtx());
+        if (!context)
+        {
+            SWSS_LOG_THROW("ZSTD_createDCtx failed");
+        }
+    }
+
+    uint64_t start = threadCpuUs();
+
+    size_t offset = BinarySerializer::getOperationsOffset(src, size);
+    unsigned long long contentSize = ZSTD_getFrameContentSize(src + offset, size - offset);
+    if (contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize == ZSTD_CONTENTSIZE_UNKNOWN)
+    {
+        SWSS_LOG_THROW("compressed message is malformed");
+    }
+
+    if (contentSize > maxSize || offset + contentSize > maxSize)
+    {
+        SWSS_LOG_THROW("compressed message is too big (limit %zu bytes, got %llu)", maxSize, contentSize);
+    }
+
+    out.resize(offset + (size_t)contentSize);
+    memcpy(&out[0], src, offset);
+    BinarySerializer::setCompressed(&out[0], offset, false);
+
+    size_t rc = ZSTD_decompressDCtx(context.get(), &out[offset], (size_t)contentSize, src + offset, size - offset);
+    if (ZSTD_isError(rc) || rc != contentSize)
+    {
+        SWSS_LOG_THROW("compressed message is malformed: %s", ZSTD_isError(rc) ? ZSTD_getErrorName(rc) : "size mismatch");
+    }
+
+    m_decompressed++;
+    m_decompressUs += threadCpuUs() - start;
+}
+
+#else
+
+size_t ZmqCompression::compressBound(size_t size)
+{
+    return size;
+}
+
+size_t ZmqCompression::compress(const char*, size_t, char*, size_t)
+{
+    m_skipped++;
+    return 0;
+}
+
+void ZmqCompression::decompressMessage(const char*, size_t, std::string&, size_t)
+{
+    SWSS_LOG_THROW("received a compressed message, but zstd support is not compiled in");
+}
+
+#endif
+
+}
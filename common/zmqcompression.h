@@ -0,0 +1,97 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+namespace swss {
+
+/*
+ * zstd compression of ZMQ table messages.
+ *
+ * Only the operations of a version 2 message are compressed: the header,
+ * sequence and names are copied as they are and FLAG_COMPRESSED is set, see
+ * BinarySerializer. Messages below the threshold, and messages which would
+ * not shrink, are sent uncompressed, so a receiver always has to check.
+ *
+ * Compression support is optional at build time, see isSupported().
+ */
+class ZmqCompression
+{
+public:
+    explicit ZmqCompression(size_t threshold = DEFAULT_THRESHOLD, int level = DEFAULT_LEVEL);
+    ~ZmqCompression();
+
+    // Built with zstd.
+    static bool isSupported();
+
+    // Bulk messages are large and repetitive, small ones don't pay off.
+    static constexpr size_t DEFAULT_THRESHOLD = 4096;
+
+    // Fast levels give most of the ratio on table messages.
+    static constexpr int DEFAULT_LEVEL = 1;
+
+    size_t getThreshold() const;
+
+    // Buffer size compress() needs for a message of size bytes.
+    static size_t compressBound(size_t size);
+
+    /*
+     * Compress the serialized message src into dst, which has room for
+     * compressBound(size) bytes. Returns the compressed size, or 0 if the
+     * message is below the threshold or doesn't shrink and should be sent
+     * as it is. Thread safe.
+     */
+    size_t compress(const char* src, size_t size, char* dst, size_t dstSize);
+
+    /*
+     * Decompress a message with FLAG_COMPRESSED into out, which then holds
+     * the plain message. Throws on malformed input, a message larger than
+     * maxSize, or without zstd support, and counts the failure. Thread safe.
+     */
+    void decompress(const char* src, size_t size, std::string& out, size_t maxSize);
+
+    struct Stats
+    {
+        uint64_t compressed;      // messages sent compressed
+        uint64_t skipped;         // messages sent plain, below the threshold or incompressible
+        uint64_t bytesIn;         // plain size of the compressed messages
+        uint64_t bytesOut;        // their compressed size
+        uint64_t compressUs;      // CPU time spent in compress()
+        uint64_t decompressed;    // messages decompressed
+        uint64_t decompressUs;    // CPU time spent in decompress()
+        uint64_t decompressFailed; // messages which failed to decompress
+
+        // bytesIn / bytesOut, 1 when nothing was compressed
+        double ratio() const;
+    };
+
+    Stats getStats() const;
+
+private:
+    ZmqCompression(const ZmqCompression&);
+    ZmqCompression& operator=(const ZmqCompression&);
+
+    void decompressMessage(const char* src, size_t size, std::string& out, size_t maxSize);
+
+    size_t m_threshold;
+
+    int m_level;
+
+    // Compression context reused by all messages, ZSTD_CCtx.
+    std::mutex m_contextMutex;
+    void* m_context;
+
+    std::atomic<uint64_t> m_compressed;
+    std::atomic<uint64_t> m_skipped;
+    std::atomic<uint64_t> m_bytesIn;
+    std::atomic<uint64_t> m_bytesOut;
+    std::atomic<uint64_t> m_compressUs;
+    std::atomic<uint64_t> m_decompressed;
+    std::atomic<uint64_t> m_decompressUs;
+    std::atomic<uint64_t> m_decompressFailed;
+};
+
+}
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <iterator>
 #include <string>
 #include <deque>
 #include <limits>
@@ -20,6 +22,11 @@ namespace swss {
 ZmqConsumerStateTable::ZmqConsumerStateTable(DBConnector *db, const std::string &tableName, ZmqServer &zmqServer, int popBatchSize, int pri, bool dbPersistence)
     : Selectable(pri)
     , TableBase(tableName, TableBase::getTableSeparator(db->getDbId()))
+    , m_notified(false)
+    , m_keyCoalescing(false)
+    , m_coalescedCount(0)
+    , m_coalescingReceived(0)
+    , m_coalescingMerged(0)
     , m_db(db)
     , m_dbName(db->getDbName())
     , m_handlerRegistry(zmqServer.getHandlerRegistry())
@@ -61,9 +68,32 @@ ZmqConsumerStateTable::~ZmqConsumerStateTable()
     m_handlerRegistry->removeHandler(m_dbName, getTableName());
 }
 
+void ZmqConsumerStateTable::setKeyCoalescing(bool enable)
+{
+    m_keyCoalescing.store(enable, std::memory_order_release);
+}
+
+ZmqConsumerStateTable::CoalescingStats ZmqConsumerStateTable::getCoalescingStats()
+{
+    std::lock_guard<std::mutex> lock(m_coalescedMutex);
+
+    CoalescingStats stats;
+    stats.received = m_coalescingReceived;
+    stats.coalesced = m_coalescingMerged;
+    stats.pendingKeys = m_coalescedQueue.size();
+    return stats;
+}
+
 void ZmqConsumerStateTable::handleReceivedData(const std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> &kcos)
 {
-    for (auto kco : kcos)
+    bool keyCoalescing = m_keyCoalescing.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(m_coalescedMutex, std::defer_lock);
+    if (keyCoalescing)
+    {
+        lock.lock();
+    }
+
+    for (const auto &kco : kcos)
     {
         std::shared_ptr<KeyOpFieldsValuesTuple> clone = nullptr;
         if (m_asyncDBUpdater != nullptr)
@@ -72,8 +102,12 @@ void ZmqConsumerStateTable::handleReceivedData(const std::vector<std::shared_ptr
             clone = std::make_shared<KeyOpFieldsValuesTuple>(*kco);
         }
 
+        if (keyCoalescing)
+        {
+            coalesce(*kco);
+        }
+        else
         {
-            std::lock_guard<std::mutex> lock(m_receivedQueueMutex);
             m_receivedOperationQueue.push(kco);
         }
 
@@ -82,42 +116,151 @@ void ZmqConsumerStateTable::handleReceivedData(const std::vector<std::shared_ptr
             m_asyncDBUpdater->update(clone);
         }
     }
-    m_selectableEvent.notify(); // will release epoll
+    if (keyCoalescing)
+    {
+        m_coalescedCount.store(m_coalescedQueue.size(), std::memory_order_release);
+        lock.unlock();
+    }
+
+    notify();
 }
 
-/* Get multiple pop elements */
-void ZmqConsumerStateTable::pops(std::deque<KeyOpFieldsValuesTuple> &vkco, const std::string& /*prefix*/)
+void ZmqConsumerStateTable::coalesce(KeyOpFieldsValuesTuple &kco)
 {
-    size_t count;
+    m_coalescingReceived++;
+
+    const std::string &key = kfvKey(kco);
+    const std::string &op = kfvOp(kco);
+    bool mergeable = op == SET_COMMAND || op == HSET_COMMAND;
+
+    auto found = m_coalescedIndex.find(key);
+    if (found != m_coalescedIndex.end())
     {
-        // size() is not thread safe
-        std::lock_guard<std::mutex> lock(m_receivedQueueMutex);
+        PendingKey &pending = *found->second;
+        if (op == DEL_COMMAND)
+        {
+            if (pending.del || !pending.op.empty())
+            {
+                m_coalescingMerged++;
+            }
+            pending.del = true;
+            pending.op.clear();
+            pending.fieldValues.clear();
+            return;
+        }
 
-        // For new data append to m_dataQueue during pops, will not be include in result.
-        count = m_receivedOperationQueue.size();
-        if (!count)
+        if (mergeable && (pending.op.empty() || pending.op == op))
         {
+            if (!pending.op.empty())
+            {
+                m_coalescingMerged++;
+            }
+            pending.op = op;
+            for (auto &fv : kfvFieldsValues(kco))
+            {
+                auto it = find_if(pending.fieldValues.begin(), pending.fieldValues.end(),
+                                  [&fv](const FieldValueTuple &existing) { return fvField(existing) == fvField(fv); });
+                if (it != pending.fieldValues.end())
+                {
+                    fvValue(*it) = std::move(fvValue(fv));
+                }
+                else
+                {
+                    pending.fieldValues.push_back(std::move(fv));
+                }
+            }
             return;
         }
+
+        // Can't be merged, keep it behind the pending state of the key.
+        m_coalescedIndex.erase(found);
     }
 
-    vkco.clear();
-    auto pop_limit = min(count, m_popBatchSize);
-    for (size_t ie = 0; ie < pop_limit; ie++)
+    PendingKey pending;
+    pending.key = key;
+    pending.del = op == DEL_COMMAND;
+    if (!pending.del)
+    {
+        pending.op = op;
+        pending.fieldValues = std::move(kfvFieldsValues(kco));
+    }
+
+    m_coalescedQueue.push_back(std::move(pending));
+    if (mergeable || op == DEL_COMMAND)
+    {
+        m_coalescedIndex[m_coalescedQueue.back().key] = std::prev(m_coalescedQueue.end());
+    }
+}
+
+void ZmqConsumerStateTable::popCoalesced(std::deque<KeyOpFieldsValuesTuple> &vkco, size_t limit)
+{
+    std::lock_guard<std::mutex> lock(m_coalescedMutex);
+
+    while (vkco.size() < limit && !m_coalescedQueue.empty())
     {
-        auto& kco = *(m_receivedOperationQueue.front());
-        vkco.push_back(std::move(kco));
+        PendingKey &pending = m_coalescedQueue.front();
+
+        auto found = m_coalescedIndex.find(pending.key);
+        if (found != m_coalescedIndex.end() && found->second == m_coalescedQueue.begin())
+        {
+            m_coalescedIndex.erase(found);
+        }
+
+        if (pending.del)
+        {
+            vkco.emplace_back(pending.key, DEL_COMMAND, std::vector<FieldValueTuple>());
+        }
 
+        if (!pending.op.empty())
         {
-            std::lock_guard<std::mutex> lock(m_receivedQueueMutex);
-            m_receivedOperationQueue.pop();
+            vkco.emplace_back(std::move(pending.key), std::move(pending.op), std::move(pending.fieldValues));
         }
+
+        m_coalescedQueue.pop_front();
+    }
+
+    m_coalescedCount.store(m_coalescedQueue.size(), std::memory_order_release);
+}
+
+void ZmqConsumerStateTable::notify()
+{
+    // Writing the eventfd is a syscall; skip it while a previous signal is
+    // still pending, readData() will pick up everything queued since.
+    if (!m_notified.exchange(true, std::memory_order_acq_rel))
+    {
+        m_selectableEvent.notify(); // will release epoll
+    }
+}
+
+/* Get multiple pop elements */
+void ZmqConsumerStateTable::pops(std::deque<KeyOpFieldsValuesTuple> &vkco, const std::string& /*prefix*/)
+{
+    // For new data append to the queue during pops, will not be include in result.
+    size_t count = m_receivedOperationQueue.size();
+    size_t coalescedCount = m_coalescedCount.load(std::memory_order_acquire);
+    if (!count && !coalescedCount)
+    {
+        return;
+    }
+
+    vkco.clear();
+    auto pop_limit = min(count, m_popBatchSize);
+    std::shared_ptr<KeyOpFieldsValuesTuple> kco;
+    for (size_t ie = 0; ie < pop_limit && m_receivedOperationQueue.pop(kco); ie++)
+    {
+        vkco.push_back(std::move(*kco));
+    }
+
+    // Operations queued before coalescing was enabled are popped first.
+    if (coalescedCount && vkco.size() < m_popBatchSize)
+    {
+        popCoalesced(vkco, m_popBatchSize);
     }
 
-    if (count > m_popBatchSize)
+    if (hasData())
     {
         // Notify epoll to wake up and continue to pop.
-        m_selectableEvent.notify();
+        notify();
     }
 }
 
@@ -2,12 +2,15 @@
 
 #include <string>
 #include <deque>
+#include <atomic>
 #include <list>
-#include <condition_variable>
+#include <mutex>
+#include <unordered_map>
 #include "asyncdbupdater.h"
 #include "consumertablebase.h"
 #include "dbconnector.h"
 #include "selectableevent.h"
+#include "spscqueue.h"
 #include "table.h"
 #include "zmqserver.h"
 
@@ -23,6 +26,33 @@ public:
 
     ~ZmqConsumerStateTable() override;
 
+    struct CoalescingStats
+    {
+        /* operations received while coalescing was enabled */
+        uint64_t received;
+
+        /* operations merged into, or overriding, a pending operation */
+        uint64_t coalesced;
+
+        /* keys currently waiting to be popped */
+        size_t pendingKeys;
+    };
+
+    /*
+     * Keep only the latest state of each key until it is popped, like
+     * ConsumerStateTable does: a SET merges its fields into a pending SET of
+     * the same key, a DEL drops whatever is pending for the key, and a SET
+     * after a pending DEL is popped as the DEL followed by the SET. Keys are
+     * popped in the order they first arrived. Queue size then depends on the
+     * number of distinct keys rather than on the update rate.
+     *
+     * Operations are only coalesced until popped. Database persistence, when
+     * enabled, still sees every operation.
+     */
+    void setKeyCoalescing(bool enable);
+
+    CoalescingStats getCoalescingStats();
+
     /* Get multiple pop elements */
     void pops(std::deque<KeyOpFieldsValuesTuple> &vkco, const std::string &prefix = EMPTY_PREFIX);
 
@@ -35,7 +65,12 @@ public:
     /* Read all data from the fd assicaited with Selectable */
     uint64_t readData() override
     {
-        return m_selectableEvent.readData();
+        uint64_t ret = m_selectableEvent.readData();
+
+        // Re-enable notifications only after the eventfd is drained, data
+        // pushed from now on will signal it again.
+        m_notified.exchange(false, std::memory_order_acq_rel);
+        return ret;
     }
 
     /*
@@ -48,8 +83,7 @@ public:
     */
     bool hasData() override
     {
-        std::lock_guard<std::mutex> lock(m_receivedQueueMutex);
-        return !m_receivedOperationQueue.empty();
+        return !m_receivedOperationQueue.empty() || m_coalescedCount.load(std::memory_order_acquire) > 0;
     }
 
     /* true if Selectable has data in its cache */
@@ -75,9 +109,43 @@ public:
 private:
     void handleReceivedData(const std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> &kcos);
 
-    std::mutex m_receivedQueueMutex;
+    void notify();
 
-    std::queue<std::shared_ptr<KeyOpFieldsValuesTuple>, std::list<std::shared_ptr<KeyOpFieldsValuesTuple>>> m_receivedOperationQueue;
+    struct PendingKey
+    {
+        std::string key;
+
+        /* a DEL is pending, it is popped before op */
+        bool del;
+
+        /* SET or HSET to pop after the DEL, empty if none */
+        std::string op;
+
+        std::vector<FieldValueTuple> fieldValues;
+    };
+
+    void coalesce(KeyOpFieldsValuesTuple &kco);
+
+    void popCoalesced(std::deque<KeyOpFieldsValuesTuple> &vkco, size_t limit);
+
+    /*
+     * Filled by the ZmqServer thread, which is the only producer for a given
+     * table, and drained by pops().
+     */
+    SpscQueue<std::shared_ptr<KeyOpFieldsValuesTuple>> m_receivedOperationQueue;
+
+    /* true while the eventfd has been signaled and not read yet */
+    std::atomic<bool> m_notified;
+
+    std::atomic<bool> m_keyCoalescing;
+
+    /* pending keys in first-arrival order, and an index of them by key */
+    std::mutex m_coalescedMutex;
+    std::list<PendingKey> m_coalescedQueue;
+    std::unordered_map<std::string, std::list<PendingKey>::iterator> m_coalescedIndex;
+    std::atomic<size_t> m_coalescedCount;
+    uint64_t m_coalescingReceived;
+    uint64_t m_coalescingMerged;
 
     swss::SelectableEvent m_selectableEvent;
 
@@ -18,6 +18,9 @@ using namespace std;
 
 namespace swss {
 
+constexpr size_t ZmqProducerStateTable::DEFAULT_BATCH_MAX_BYTES;
+constexpr uint32_t ZmqProducerStateTable::DEFAULT_BATCH_MAX_DELAY_MS;
+
 ZmqProducerStateTable::ZmqProducerStateTable(DBConnector *db, const string &tableName, ZmqClient &zmqClient, bool dbPersistence)
     : ProducerStateTable(db, tableName),
     m_zmqClient(zmqClient),
@@ -36,6 +39,20 @@ ZmqProducerStateTable::ZmqProducerStateTable(RedisPipeline *pipeline, const stri
     initialize(pipeline->getDBConnector(), tableName, dbPersistence);
 }
 
+ZmqProducerStateTable::~ZmqProducerStateTable()
+{
+    stopBatchThread();
+
+    try
+    {
+        flush();
+    }
+    catch (const std::exception &e)
+    {
+        SWSS_LOG_ERROR("Failed to flush batched operations of table %s: %s", m_tableNameStr.c_str(), e.what());
+    }
+}
+
 void ZmqProducerStateTable::initialize(DBConnector *db, const std::string &tableName, bool dbPersistence)
 {
     if (dbPersistence)
@@ -56,13 +73,16 @@ void ZmqProducerStateTable::set(
                     const string &op /*= SET_COMMAND*/,
                     const string &prefix)
 {
-    std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
-        KeyOpFieldsValuesTuple{key, op, values}
-    };
-    m_zmqClient.sendMsg(
-                        m_dbName,
-                        m_tableNameStr,
-                        kcos);
+    if (!batch(key, values, op, false))
+    {
+        std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
+            KeyOpFieldsValuesTuple{key, op, values}
+        };
+        m_zmqClient.sendMsg(
+                            m_dbName,
+                            m_tableNameStr,
+                            kcos);
+    }
 
     if (m_asyncDBUpdater != nullptr)
     {
@@ -84,13 +104,16 @@ void ZmqProducerStateTable::del(
                     const string &op /*= DEL_COMMAND*/,
                     const string &prefix)
 {
-    std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
-        KeyOpFieldsValuesTuple{key, op, std::vector<FieldValueTuple>{}}
-    };
-    m_zmqClient.sendMsg(
-                        m_dbName,
-                        m_tableNameStr,
-                        kcos);
+    if (!batch(key, std::vector<FieldValueTuple>{}, op, true))
+    {
+        std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
+            KeyOpFieldsValuesTuple{key, op, std::vector<FieldValueTuple>{}}
+        };
+        m_zmqClient.sendMsg(
+                            m_dbName,
+                            m_tableNameStr,
+                            kcos);
+    }
 
     if (m_asyncDBUpdater != nullptr)
     {
@@ -105,6 +128,7 @@ void ZmqProducerStateTable::del(
 
 void ZmqProducerStateTable::set(const std::vector<KeyOpFieldsValuesTuple> &values)
 {
+    flush();
     m_zmqClient.sendMsg(
                         m_dbName,
                         m_tableNameStr,
@@ -128,6 +152,7 @@ void ZmqProducerStateTable::del(const std::vector<std::string> &keys)
     {
         kcos.push_back(KeyOpFieldsValuesTuple{key, DEL_COMMAND, std::vector<FieldValueTuple>{}});
     }
+    flush();
     m_zmqClient.sendMsg(
                         m_dbName,
                         m_tableNameStr,
@@ -148,7 +173,13 @@ void ZmqProducerStateTable::del(const std::vector<std::string> &keys)
 
 void ZmqProducerStateTable::send(const std::vector<KeyOpFieldsValuesTuple> &kcos)
 {
-    m_zmqClient.sendMsg(
+    sendRequest(kcos);
+}
+
+uint64_t ZmqProducerStateTable::sendRequest(const std::vector<KeyOpFieldsValuesTuple> &kcos)
+{
+    flush();
+    uint64_t requestId = m_zmqClient.sendRequest(
                         m_dbName,
                         m_tableNameStr,
                         kcos);
@@ -162,6 +193,8 @@ void ZmqProducerStateTable::send(const std::vector<KeyOpFieldsValuesTuple> &kcos
             m_asyncDBUpdater->update(clone);
         }
     }
+
+    return requestId;
 }
 
 bool ZmqProducerStateTable::wait(std::string& dbName,
@@ -171,6 +204,14 @@ bool ZmqProducerStateTable::wait(std::string& dbName,
     return m_zmqClient.wait(dbName, tableName, kcos);
 }
 
+bool ZmqProducerStateTable::wait(uint64_t requestId,
+                                 std::string& dbName,
+                                 std::string& tableName,
+                                 std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos)
+{
+    return m_zmqClient.wait(requestId, dbName, tableName, kcos);
+}
+
 size_t ZmqProducerStateTable::dbUpdaterQueueSize()
 {
     if (m_asyncDBUpdater == nullptr)
@@ -182,4 +223,170 @@ size_t ZmqProducerStateTable::dbUpdaterQueueSize()
     return m_asyncDBUpdater->queueSize();
 }
 
+void ZmqProducerStateTable::setBatchingWindow(size_t maxCount, size_t maxBytes, uint32_t maxDelayMs)
+{
+    stopBatchThread();
+    flush();
+
+    {
+        std::lock_guard<std::mutex> lock(m_batchMutex);
+        m_batchMaxCount = maxCount;
+        m_batchMaxBytes = maxBytes;
+        m_batchMaxDelay = std::chrono::milliseconds(maxDelayMs);
+    }
+
+    if (maxCount == 0)
+    {
+        SWSS_LOG_DEBUG("Batching disabled, tableName: %s", m_tableNameStr.c_str());
+        return;
+    }
+
+    SWSS_LOG_DEBUG("Batching enabled, tableName: %s, count: %zu, bytes: %zu, delay: %u ms",
+                   m_tableNameStr.c_str(), maxCount, maxBytes, maxDelayMs);
+
+    m_runBatchThread = true;
+    m_batchThread = std::make_shared<std::thread>(&ZmqProducerStateTable::batchThread, this);
+}
+
+void ZmqProducerStateTable::flush()
+{
+    std::lock_guard<std::mutex> lock(m_batchMutex);
+    flushBatch();
+}
+
+bool ZmqProducerStateTable::batch(const std::string &key, const std::vector<FieldValueTuple> &values, const std::string &op, bool isDel)
+{
+    std::lock_guard<std::mutex> lock(m_batchMutex);
+    if (m_batchMaxCount == 0)
+    {
+        return false;
+    }
+
+    size_t bytes = key.size() + op.size() + 2 * sizeof(size_t);
+    for (const auto &fv : values)
+    {
+        bytes += fvField(fv).size() + fvValue(fv).size() + 2 * sizeof(size_t);
+    }
+
+    auto it = m_batchIndex.find(key);
+    if (it != m_batchIndex.end() && kfvOp(m_batch[it->second]) == op)
+    {
+        if (isDel)
+        {
+            // The same DEL is already pending for the key.
+            return true;
+        }
+
+        // Merge into the pending operation, later values win.
+        auto &pendingValues = kfvFieldsValues(m_batch[it->second]);
+        for (const auto &fv : values)
+        {
+            auto fit = std::find_if(pendingValues.begin(), pendingValues.end(),
+                                    [&fv](const FieldValueTuple &p) { return fvField(p) == fvField(fv); });
+            if (fit != pendingValues.end())
+            {
+                fvValue(*fit) = fvValue(fv);
+            }
+            else
+            {
+                pendingValues.push_back(fv);
+            }
+        }
+
+        m_batchBytes += bytes;
+        if (m_batchBytes >= m_batchMaxBytes)
+        {
+            flushBatch();
+        }
+        return true;
+    }
+
+    // A different op on a pending key is queued after it, so the consumer
+    // sees both in order.
+    if (m_batch.empty())
+    {
+        m_batchDeadline = std::chrono::steady_clock::now() + m_batchMaxDelay;
+        m_batchCv.notify_all();
+    }
+
+    m_batchIndex[key] = m_batch.size();
+    m_batch.emplace_back(key, op, values);
+    m_batchBytes += bytes;
+
+    if (m_batch.size() >= m_batchMaxCount || m_batchBytes >= m_batchMaxBytes)
+    {
+        flushBatch();
+    }
+
+    return true;
+}
+
+void ZmqProducerStateTable::flushBatch()
+{
+    // Caller holds m_batchMutex, which also keeps batches in order on the wire.
+    if (m_batch.empty())
+    {
+        return;
+    }
+
+    std::vector<KeyOpFieldsValuesTuple> kcos;
+    kcos.swap(m_batch);
+    m_batchIndex.clear();
+    m_batchBytes = 0;
+
+    m_zmqClient.sendMsg(
+                        m_dbName,
+                        m_tableNameStr,
+                        kcos);
+}
+
+void ZmqProducerStateTable::stopBatchThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_batchMutex);
+        m_runBatchThread = false;
+    }
+
+    m_batchCv.notify_all();
+    if (m_batchThread)
+    {
+        m_batchThread->join();
+        m_batchThread = nullptr;
+    }
+}
+
+void ZmqProducerStateTable::batchThread()
+{
+    SWSS_LOG_ENTER();
+
+    std::unique_lock<std::mutex> lock(m_batchMutex);
+    while (m_runBatchThread)
+    {
+        if (m_batch.empty())
+        {
+            m_batchCv.wait(lock);
+            continue;
+        }
+
+        if (m_batchCv.wait_until(lock, m_batchDeadline) != std::cv_status::timeout)
+        {
+            continue;
+        }
+
+        if (m_batch.empty() || std::chrono::steady_clock::now() < m_batchDeadline)
+        {
+            continue;
+        }
+
+        try
+        {
+            flushBatch();
+        }
+        catch (const std::exception &e)
+        {
+            SWSS_LOG_ERROR("Failed to send batched operations of table %s: %s", m_tableNameStr.c_str(), e.what());
+        }
+    }
+}
+
 }
@@ -5,6 +5,9 @@
 #include <queue>
 #include <thread> 
 #include <mutex> 
+#include <chrono>
+#include <condition_variable>
+#include <unordered_map>
 #include "asyncdbupdater.h"
 #include "producerstatetable.h"
 #include "redispipeline.h"
@@ -18,6 +21,7 @@ class ZmqProducerStateTable : public ProducerStateTable
 public:
     ZmqProducerStateTable(DBConnector *db, const std::string &tableName, ZmqClient &zmqClient, bool dbPersistence = true);
     ZmqProducerStateTable(RedisPipeline *pipeline, const std::string &tableName, ZmqClient &zmqClient, bool buffered = false, bool dbPersistence = true);
+    ~ZmqProducerStateTable() override;
 
     /* Implements set() and del() commands using notification messages */
     virtual void set(const std::string &key,
@@ -42,16 +46,75 @@ public:
                       std::string& tableName,
                       std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos);
 
+    // Same as send(), returns a request id to wait for the response of this
+    // particular request when the ZmqClient pipelines one-to-one sync
+    // requests, 0 otherwise.
+    uint64_t sendRequest(const std::vector<KeyOpFieldsValuesTuple> &kcos);
+
+    // Wait for the response to a request returned by sendRequest().
+    bool wait(uint64_t requestId,
+              std::string& dbName,
+              std::string& tableName,
+              std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos);
+
     size_t dbUpdaterQueueSize();
+
+    /*
+     * Opt-in batching window for set() and del(). Operations are accumulated
+     * and sent as one message once maxCount operations or maxBytes serialized
+     * bytes are pending, or maxDelayMs after the first pending operation.
+     * Updates to a key that is still pending are coalesced when they carry
+     * the same op: a SET merges its fields into the pending SET and a
+     * repeated DEL is dropped. Any other op is queued after the pending
+     * one, each operation keeps its op on the wire. Database persistence
+     * is not delayed. The batched set()/del()/send() overloads flush the
+     * window first and then send immediately. Not intended for one-to-one
+     * sync mode. maxCount 0 disables batching.
+     */
+    void setBatchingWindow(size_t maxCount,
+                           size_t maxBytes = DEFAULT_BATCH_MAX_BYTES,
+                           uint32_t maxDelayMs = DEFAULT_BATCH_MAX_DELAY_MS);
+
+    /* Send the operations pending in the batching window now */
+    void flush();
+
+    static constexpr size_t DEFAULT_BATCH_MAX_BYTES = 1024 * 1024;
+    static constexpr uint32_t DEFAULT_BATCH_MAX_DELAY_MS = 10;
+
 private:
     void initialize(DBConnector *db, const std::string &tableName, bool dbPersistence);
 
+    // Returns true if the operation was queued in the batching window.
+    bool batch(const std::string &key, const std::vector<FieldValueTuple> &values, const std::string &op, bool isDel);
+
+    void flushBatch();
+
+    void stopBatchThread();
+
+    void batchThread();
+
     ZmqClient& m_zmqClient;
 
     const std::string m_dbName;
     const std::string m_tableNameStr;
 
     std::unique_ptr<AsyncDBUpdater> m_asyncDBUpdater;
+
+    // Batching window, disabled while m_batchMaxCount is zero.
+    size_t m_batchMaxCount = 0;
+    size_t m_batchMaxBytes = DEFAULT_BATCH_MAX_BYTES;
+    std::chrono::milliseconds m_batchMaxDelay;
+
+    std::vector<KeyOpFieldsValuesTuple> m_batch;
+    // Key -> index of the latest operation on that key in m_batch.
+    std::unordered_map<std::string, size_t> m_batchIndex;
+    size_t m_batchBytes = 0;
+    std::chrono::steady_clock::time_point m_batchDeadline;
+
+    std::mutex m_batchMutex;
+    std::condition_variable m_batchCv;
+    bool m_runBatchThread = false;
+    std::shared_ptr<std::thread> m_batchThread;
 };
 
 }
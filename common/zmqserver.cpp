@@ -1,4 +1,7 @@
+#include <inttypes.h>
 #include <unistd.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <string>
 #include <deque>
 #include <limits>
@@ -7,50 +10,68 @@
 #include <pthread.h>
 #include "zmqserver.h"
 #include "binaryserializer.h"
+#include "shmring.h"
 
 using namespace std;
 
 namespace swss {
 
+constexpr size_t ZmqHandlerRegistry::SHARD_COUNT;
+
+ZmqHandlerRegistry::Shard& ZmqHandlerRegistry::getShard(
+    const std::string& dbName,
+    const std::string& tableName)
+{
+    size_t hash = std::hash<std::string>()(dbName) * 31 + std::hash<std::string>()(tableName);
+    return m_shards[hash % SHARD_COUNT];
+}
+
 void ZmqHandlerRegistry::registerHandler(
     const std::string& dbName,
     const std::string& tableName,
     ZmqMessageHandler* handler)
 {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    auto& shard = getShard(dbName, tableName);
+    std::lock_guard<std::mutex> lock(shard.mutex);
 
-    auto dbResult = m_handlers.insert(make_pair(dbName, map<string, ZmqMessageHandler*>()));
-    if (dbResult.second) {
-        SWSS_LOG_DEBUG("ZmqHandlerRegistry add mapping for db: %s", dbName.c_str());
+    auto& entry = shard.handlers[make_pair(dbName, tableName)];
+    if (entry) {
+        // Keep the first registration, as before.
+        return;
     }
 
-    auto tableResult = dbResult.first->second.insert(make_pair(tableName, handler));
-    if (tableResult.second) {
-        SWSS_LOG_DEBUG("ZmqHandlerRegistry register handler for db: %s, table: %s",
-                       dbName.c_str(), tableName.c_str());
-    }
+    entry = std::make_shared<HandlerEntry>();
+    entry->handler = handler;
+    SWSS_LOG_DEBUG("ZmqHandlerRegistry register handler for db: %s, table: %s",
+                   dbName.c_str(), tableName.c_str());
 }
 
 void ZmqHandlerRegistry::removeHandler(
     const std::string& dbName,
     const std::string& tableName)
 {
-    // Take the same mutex that dispatch() holds across the callback. Once we
-    // acquire it, no callback into this (dbName, tableName) handler is in
-    // flight and no further one can start — making it safe for the caller to
-    // destroy the handler object after removeHandler() returns.
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<HandlerEntry> entry;
+    {
+        auto& shard = getShard(dbName, tableName);
+        std::lock_guard<std::mutex> lock(shard.mutex);
 
-    auto dbIter = m_handlers.find(dbName);
-    if (dbIter == m_handlers.end()) {
-        return;
-    }
+        auto it = shard.handlers.find(make_pair(dbName, tableName));
+        if (it == shard.handlers.end()) {
+            return;
+        }
 
-    dbIter->second.erase(tableName);
-    if (dbIter->second.empty()) {
-        m_handlers.erase(dbIter);
+        entry = std::move(it->second);
+        shard.handlers.erase(it);
     }
 
+    // Take the mutex that dispatch() holds across the callback. Once we
+    // acquire it, no callback into this handler is in flight, and clearing
+    // the pointer stops any dispatch that already looked the entry up from
+    // starting one — making it safe for the caller to destroy the handler
+    // object after removeHandler() returns.
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    entry->handler = nullptr;
+
     SWSS_LOG_DEBUG("ZmqHandlerRegistry removed handler for db: %s, table: %s",
                    dbName.c_str(), tableName.c_str());
 }
@@ -60,25 +81,28 @@ void ZmqHandlerRegistry::dispatch(
     const std::string& tableName,
     const std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos)
 {
-    // Hold the mutex for the duration of the callback. Concurrent
-    // removeHandler() on this (dbName, tableName) blocks until we return,
-    // so the handler cannot be destroyed mid-call.
-    std::lock_guard<std::mutex> lock(m_mutex);
+    std::shared_ptr<HandlerEntry> entry;
+    {
+        auto& shard = getShard(dbName, tableName);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.handlers.find(make_pair(dbName, tableName));
+        if (it == shard.handlers.end()) {
+            SWSS_LOG_DEBUG("ZmqHandlerRegistry can't find handler for db: %s, table: %s",
+                           dbName.c_str(), tableName.c_str());
+            return;
+        }
 
-    auto dbIter = m_handlers.find(dbName);
-    if (dbIter == m_handlers.end()) {
-        SWSS_LOG_DEBUG("ZmqHandlerRegistry can't find any handler for db: %s", dbName.c_str());
-        return;
+        entry = it->second;
     }
 
-    auto tableIter = dbIter->second.find(tableName);
-    if (tableIter == dbIter->second.end()) {
-        SWSS_LOG_DEBUG("ZmqHandlerRegistry can't find handler for db: %s, table: %s",
-                       dbName.c_str(), tableName.c_str());
-        return;
+    // Hold the handler's mutex for the duration of the callback. Concurrent
+    // removeHandler() on this (dbName, tableName) blocks until we return,
+    // so the handler cannot be destroyed mid-call.
+    std::lock_guard<std::mutex> lock(entry->mutex);
+    if (entry->handler != nullptr) {
+        entry->handler->handleReceivedData(kcos);
     }
-
-    tableIter->second->handleReceivedData(kcos);
 }
 
 ZmqServer::ZmqServer(const std::string& endpoint)
@@ -97,15 +121,26 @@ ZmqServer::ZmqServer(const std::string& endpoint, const std::string& vrf, bool l
 }
 
 ZmqServer::ZmqServer(const std::string& endpoint, const std::string& vrf, bool lazyBind, bool oneToOneSync)
+    : ZmqServer(endpoint, vrf, lazyBind, oneToOneSync, 0)
+{
+}
+
+ZmqServer::ZmqServer(const std::string& endpoint, const std::string& vrf, bool lazyBind, bool oneToOneSync, unsigned int decodeThreads)
     : m_mqPollThread(nullptr),
     m_endpoint(endpoint),
     m_vrf(vrf),
     m_context(nullptr),
     m_socket(nullptr),
     m_oneToOneSync(oneToOneSync),
-    m_allowZmqPoll(true),
+    m_decodeThreads(decodeThreads),
     m_registry(std::make_shared<ZmqHandlerRegistry>())
 {
+    if (m_oneToOneSync && m_decodeThreads > 0)
+    {
+        SWSS_LOG_WARN("ZmqServer decode threads are not supported in one-to-one sync mode, endpoint: %s", endpoint.c_str());
+        m_decodeThreads = 0;
+    }
+
     if (!lazyBind)
     {
         bind();
@@ -116,13 +151,23 @@ ZmqServer::ZmqServer(const std::string& endpoint, const std::string& vrf, bool l
 
 ZmqServer::~ZmqServer()
 {
-    m_allowZmqPoll = true;
     m_runThread = false;
     if (m_mqPollThread)
     {
         m_mqPollThread->join();
     }
 
+    m_runResumeThread = false;
+    if (m_resumeThread)
+    {
+        m_resumeThread->join();
+    }
+
+    // Messages already received are still dispatched.
+    stopDecodeWorkers();
+
+    m_shmRing.reset();
+
     if (m_socket)
     {
         zmq_close(m_socket);
@@ -133,6 +178,11 @@ ZmqServer::~ZmqServer()
         zmq_ctx_destroy(m_context);
     }
 
+    if (m_replyEventFd >= 0)
+    {
+        close(m_replyEventFd);
+    }
+
     // m_registry's refcount drops here. If any registered handler still holds
     // a reference, the registry survives until that handler is destroyed; its
     // destructor will call removeHandler() safely against the surviving
@@ -142,16 +192,43 @@ ZmqServer::~ZmqServer()
 void ZmqServer::bind()
 {
     SWSS_LOG_ENTER();
-    if (m_socket)
+    if (m_socket || m_shmRing)
     {
         SWSS_LOG_THROW("ZmqServer has already been bound to the endpoint: %s", m_endpoint.c_str());
     }
 
+    if (ShmRing::isShmEndpoint(m_endpoint))
+    {
+        if (m_oneToOneSync)
+        {
+            SWSS_LOG_THROW("One-to-one sync is not supported on shared memory endpoint: %s", m_endpoint.c_str());
+        }
+
+        m_shmRing.reset(new ShmRing(ShmRing::segmentName(m_endpoint), true, m_shmCapacity ? m_shmCapacity : ShmRing::DEFAULT_CAPACITY));
+
+        startDecodeWorkers();
+        m_runThread = true;
+        m_mqPollThread = std::make_shared<std::thread>(&ZmqServer::shmPollThread, this);
+        return;
+    }
+
     m_context = zmq_ctx_new();
 
     if(m_oneToOneSync)
     {
-        m_socket = zmq_socket(m_context, ZMQ_REP);
+        // ZMQ_ROUTER serves both ZMQ_REQ clients and pipelined ZMQ_DEALER
+        // clients, see ZmqClient.
+        m_socket = zmq_socket(m_context, ZMQ_ROUTER);
+
+        // Report replies to clients which went away instead of dropping them silently.
+        int mandatory = 1;
+        zmq_setsockopt(m_socket, ZMQ_ROUTER_MANDATORY, &mandatory, sizeof(mandatory));
+
+        m_replyEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_replyEventFd < 0)
+        {
+            SWSS_LOG_THROW("failed to create reply eventfd, errno: %d", errno);
+        }
     }
     else
     {
@@ -225,19 +302,209 @@ ZmqMessageHandler* ZmqServer::findMessageHandler(
     return nullptr;
 }
 
-void ZmqServer::handleReceivedData(const char* buffer, const size_t size)
+void ZmqServer::handleReceivedData(const char* buffer, size_t size)
 {
     std::string dbName;
     std::string tableName;
     std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos;
-    BinarySerializer::deserializeBuffer(buffer, size, dbName, tableName, kcos);
+    BinarySerializer::Sequence sequence;
+
+    std::string plain;
+    if (BinarySerializer::isCompressed(buffer, size))
+    {
+        // A message which fails to decompress is counted in the compression
+        // stats and dropped by the caller, the poll threads carry on.
+        m_compression.decompress(buffer, size, plain, MQ_RESPONSE_MAX_COUNT);
+        buffer = plain.data();
+        size = plain.size();
+    }
+
+    BinarySerializer::deserializeBuffer(buffer, size, dbName, tableName, kcos, &sequence);
+
+    if (sequence.number != 0 && !acceptSequence(dbName, tableName, sequence.session, sequence.number))
+    {
+        return;
+    }
 
     m_registry->dispatch(dbName, tableName, kcos);
 }
 
+bool ZmqServer::acceptSequence(
+    const std::string& dbName,
+    const std::string& tableName,
+    uint64_t session,
+    uint64_t number)
+{
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+
+    auto& position = m_streams[make_pair(dbName, tableName)];
+    if (position.session == session)
+    {
+        if (number <= position.number)
+        {
+            // Retransmitted after a resume, but made it through before.
+            m_sequenceStats.duplicates++;
+            return false;
+        }
+
+        if (number != position.number + 1)
+        {
+            m_sequenceStats.gaps++;
+            SWSS_LOG_WARN("ZmqServer missed messages %" PRIu64 " to %" PRIu64 " of db: %s, table: %s",
+                          position.number + 1, number - 1, dbName.c_str(), tableName.c_str());
+        }
+    }
+    else
+    {
+        if (number != 1)
+        {
+            m_sequenceStats.gaps++;
+            SWSS_LOG_WARN("ZmqServer joined stream of db: %s, table: %s at message %" PRIu64,
+                          dbName.c_str(), tableName.c_str(), number);
+        }
+
+        position.session = session;
+    }
+
+    position.number = number;
+    return true;
+}
+
+ZmqServer::SequenceStats ZmqServer::getSequenceStats()
+{
+    std::lock_guard<std::mutex> lock(m_streamMutex);
+    return m_sequenceStats;
+}
+
+ZmqCompression::Stats ZmqServer::getCompressionStats()
+{
+    return m_compression.getStats();
+}
+
+void ZmqServer::enableResume(const std::string& resumeEndpoint)
+{
+    if (m_resumeThread)
+    {
+        SWSS_LOG_THROW("ZmqServer resume is already enabled on endpoint: %s", m_endpoint.c_str());
+    }
+
+    m_runResumeThread = true;
+    m_resumeThread = std::make_shared<std::thread>(&ZmqServer::resumeThread, this, resumeEndpoint);
+}
+
+void ZmqServer::setShmCapacity(size_t capacity)
+{
+    if (m_shmRing)
+    {
+        SWSS_LOG_THROW("ZmqServer has already been bound to the endpoint: %s", m_endpoint.c_str());
+    }
+
+    m_shmCapacity = capacity;
+}
+
+void ZmqServer::resumeThread(std::string resumeEndpoint)
+{
+    SWSS_LOG_ENTER();
+
+    void* context = zmq_ctx_new();
+    void* socket = zmq_socket(context, ZMQ_REP);
+
+    int linger = 0;
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    if (!m_vrf.empty())
+    {
+        zmq_setsockopt(socket, ZMQ_BINDTODEVICE, m_vrf.c_str(), m_vrf.length());
+    }
+
+    if (zmq_bind(socket, resumeEndpoint.c_str()) != 0)
+    {
+        SWSS_LOG_ERROR("zmq_bind failed on resume endpoint: %s, zmqerrno: %d", resumeEndpoint.c_str(), zmq_errno());
+        m_runResumeThread = false;
+    }
+
+    zmq_pollitem_t poll_item = {};
+    poll_item.socket = socket;
+    poll_item.events = ZMQ_POLLIN;
+
+    while (m_runResumeThread)
+    {
+        int rc = zmq_poll(&poll_item, 1, MQ_POLL_TIMEOUT);
+        if (rc <= 0 || !(poll_item.revents & ZMQ_POLLIN))
+        {
+            continue;
+        }
+
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        if (zmq_msg_recv(&msg, socket, 0) < 0)
+        {
+            zmq_msg_close(&msg);
+            continue;
+        }
+
+        try
+        {
+            handleResumeRequest(socket, static_cast<const char*>(zmq_msg_data(&msg)), zmq_msg_size(&msg));
+        }
+        catch (const std::exception& e)
+        {
+            SWSS_LOG_ERROR("ZmqServer failed to handle resume request, endpoint: %s, error: %s", resumeEndpoint.c_str(), e.what());
+
+            // ZMQ_REP must reply before the next request, an empty reply
+            // tells the client the request failed.
+            zmq_send(socket, nullptr, 0, 0);
+        }
+        zmq_msg_close(&msg);
+    }
+
+    zmq_close(socket);
+    zmq_ctx_destroy(context);
+}
+
+void ZmqServer::handleResumeRequest(void* socket, const char* buffer, size_t size)
+{
+    std::string dbName;
+    std::string sessionStr;
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos;
+    BinarySerializer::deserializeBuffer(buffer, size, dbName, sessionStr, kcos);
+    if (dbName != ZMQ_RESUME_DB)
+    {
+        SWSS_LOG_THROW("unexpected resume request for db: %s", dbName.c_str());
+    }
+
+    uint64_t session = stoull(sessionStr);
+    std::vector<KeyOpFieldsValuesTuple> reply;
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        for (const auto& kco : kcos)
+        {
+            std::vector<FieldValueTuple> fvs;
+            for (const auto& fv : kfvFieldsValues(*kco))
+            {
+                auto it = m_streams.find(make_pair(kfvKey(*kco), fvField(fv)));
+                uint64_t number = 0;
+                if (it != m_streams.end() && it->second.session == session)
+                {
+                    number = it->second.number;
+                }
+                fvs.emplace_back(fvField(fv), to_string(number));
+            }
+            reply.emplace_back(kfvKey(*kco), SET_COMMAND, std::move(fvs));
+        }
+    }
+
+    std::string payload(BinarySerializer::serializedSize(ZMQ_RESUME_DB, sessionStr, reply, BinarySerializer::VERSION_2), '\0');
+    payload.resize(BinarySerializer::serializeBuffer(&payload[0], payload.size(), ZMQ_RESUME_DB, sessionStr, reply, BinarySerializer::VERSION_2));
+    if (zmq_send(socket, payload.data(), payload.size(), 0) < 0)
+    {
+        SWSS_LOG_ERROR("zmq send resume reply failed, zmqerrno: %d", zmq_errno());
+    }
+}
+
 void ZmqServer::startMqPollThread()
 {
-    m_buffer.resize(MQ_RESPONSE_MAX_COUNT);
+    startDecodeWorkers();
+
     m_runThread = true;
     m_mqPollThread = std::make_shared<std::thread>(&ZmqServer::mqPollThread, this);
 }
@@ -248,39 +515,55 @@ void ZmqServer::mqPollThread()
     SWSS_LOG_NOTICE("mqPollThread begin");
 
     // zmq_poll will use less CPU
-    zmq_pollitem_t poll_item;
-    poll_item.fd = 0;
-    poll_item.socket = m_socket;
-    poll_item.events = ZMQ_POLLIN;
-    poll_item.revents = 0;
+    // In one-to-one sync mode replies queued by sendMsg() are signaled
+    // through m_replyEventFd, only this thread touches the socket.
+    zmq_pollitem_t poll_items[2] = {};
+    poll_items[0].socket = m_socket;
+    poll_items[0].events = ZMQ_POLLIN;
+    poll_items[1].fd = m_replyEventFd;
+    poll_items[1].events = ZMQ_POLLIN;
+    int poll_count = m_oneToOneSync ? 2 : 1;
 
     SWSS_LOG_NOTICE("bind to zmq endpoint: %s", m_endpoint.c_str());
     while (m_runThread)
     {
-        m_allowZmqPoll = false;
-
         // receive message
-        auto rc = zmq_poll(&poll_item, 1, 1000);
-        if (rc == 0 || !(poll_item.revents & ZMQ_POLLIN))
+        auto rc = zmq_poll(poll_items, poll_count, 1000);
+        if (m_oneToOneSync && rc > 0 && (poll_items[1].revents & ZMQ_POLLIN))
+        {
+            sendQueuedReplies();
+        }
+
+        if (rc <= 0 || !(poll_items[0].revents & ZMQ_POLLIN))
         {
             // timeout or other event
-            SWSS_LOG_DEBUG("zmq_poll timeout or invalied event rc: %d, revents: %d", rc, poll_item.revents);
+            SWSS_LOG_DEBUG("zmq_poll timeout or invalied event rc: %d, revents: %d", rc, poll_items[0].revents);
             continue;
         }
 
-        // receive message
+        // In one-to-one sync mode the request starts with the routing envelope.
+        PendingReply reply;
+        if (m_oneToOneSync && !receiveEnvelope(reply))
+        {
+            continue;
+        }
+
+        // receive message, the payload is decoded in place from the zmq message
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
         if (m_oneToOneSync)
         {
-            rc = zmq_recv(m_socket, m_buffer.data(), MQ_RESPONSE_MAX_COUNT, 0);
+            rc = zmq_msg_recv(&msg, m_socket, 0);
         }
         else
         {
-            rc = zmq_recv(m_socket, m_buffer.data(), MQ_RESPONSE_MAX_COUNT, ZMQ_DONTWAIT);
+            rc = zmq_msg_recv(&msg, m_socket, ZMQ_DONTWAIT);
         }
 
         if (rc < 0)
         {
             int zmq_err = zmq_errno();
+            zmq_msg_close(&msg);
             SWSS_LOG_DEBUG("zmq_recv failed, endpoint: %s,zmqerrno: %d", m_endpoint.c_str(), zmq_err);
             if (zmq_err == EINTR || zmq_err == EAGAIN)
             {
@@ -292,25 +575,281 @@ void ZmqServer::mqPollThread()
             }
         }
 
-        if (rc >= MQ_RESPONSE_MAX_COUNT)
+        size_t size = zmq_msg_size(&msg);
+        if (size >= MQ_RESPONSE_MAX_COUNT)
         {
-            SWSS_LOG_THROW("zmq_recv message was truncated (over %d bytes, received %d), increase buffer size, message DROPPED",
+            zmq_msg_close(&msg);
+            SWSS_LOG_THROW("zmq_recv message was truncated (over %d bytes, received %zu), increase buffer size, message DROPPED",
                     MQ_RESPONSE_MAX_COUNT,
-                    rc);
+                    size);
         }
 
-        m_buffer.at(rc) = 0; // make sure that we end string with zero before parse
-        SWSS_LOG_DEBUG("zmq received %d bytes", rc);
+        SWSS_LOG_DEBUG("zmq received %zu bytes", size);
+
+        if (m_oneToOneSync)
+        {
+            // Queue the reply slot before dispatch, so the handler can reply
+            // as soon as it has the data.
+            reply.version = BinarySerializer::getVersion(static_cast<const char*>(zmq_msg_data(&msg)), size);
+
+            std::lock_guard<std::mutex> lock(m_replyMutex);
+            m_pendingReplies.push_back(std::move(reply));
+        }
 
         // deserialize and write to redis:
-        handleReceivedData(m_buffer.data(), rc);
-        while (m_oneToOneSync && !m_allowZmqPoll) {
-          usleep(10);
+        try
+        {
+            if (!m_decodeWorkers.empty())
+            {
+                queueToDecodeWorker(msg);
+            }
+            else
+            {
+                handleReceivedData(static_cast<const char*>(zmq_msg_data(&msg)), size);
+            }
+        }
+        catch (const std::exception &e)
+        {
+            SWSS_LOG_ERROR("ZmqServer failed to handle received message, endpoint: %s, error: %s, message DROPPED", m_endpoint.c_str(), e.what());
+
+            if (m_oneToOneSync)
+            {
+                // Replies pop from the front, if the slot of this request
+                // is still queued it is the last one.
+                std::lock_guard<std::mutex> lock(m_replyMutex);
+                if (!m_pendingReplies.empty())
+                {
+                    m_pendingReplies.pop_back();
+                }
+            }
         }
+        zmq_msg_close(&msg);
     }
     SWSS_LOG_NOTICE("mqPollThread end");
 }
 
+void ZmqServer::shmPollThread()
+{
+    SWSS_LOG_ENTER();
+    SWSS_LOG_NOTICE("shmPollThread begin, endpoint: %s", m_endpoint.c_str());
+
+    auto handle = [this](const char* buffer, size_t size)
+    {
+        if (m_decodeWorkers.empty())
+        {
+            handleReceivedData(buffer, size);
+            return;
+        }
+
+        // The ring slot is reused once this returns, the worker gets a copy.
+        zmq_msg_t msg;
+        zmq_msg_init_size(&msg, size);
+        memcpy(zmq_msg_data(&msg), buffer, size);
+        queueToDecodeWorker(msg);
+        zmq_msg_close(&msg);
+    };
+
+    while (m_runThread)
+    {
+        try
+        {
+            m_shmRing->pop(MQ_POLL_TIMEOUT, handle);
+        }
+        catch (const std::exception &e)
+        {
+            SWSS_LOG_ERROR("ZmqServer failed to handle received message, endpoint: %s, error: %s, message DROPPED", m_endpoint.c_str(), e.what());
+        }
+    }
+    SWSS_LOG_NOTICE("shmPollThread end");
+}
+
+bool ZmqServer::receiveEnvelope(PendingReply &reply)
+{
+    // Routing id added by the ROUTER socket, then either the empty delimiter
+    // of a ZMQ_REQ client or the request id of a pipelined ZMQ_DEALER client.
+    for (int part = 0; part < 2; part++)
+    {
+        zmq_msg_t frame;
+        zmq_msg_init(&frame);
+        int rc;
+        do
+        {
+            rc = zmq_msg_recv(&frame, m_socket, 0);
+        } while (rc < 0 && zmq_errno() == EINTR);
+
+        if (rc < 0)
+        {
+            int zmq_err = zmq_errno();
+            zmq_msg_close(&frame);
+            SWSS_LOG_THROW("zmq_recv failed, endpoint: %s,zmqerrno: %d", m_endpoint.c_str(), zmq_err);
+        }
+
+        const char *data = static_cast<const char*>(zmq_msg_data(&frame));
+        size_t size = zmq_msg_size(&frame);
+        bool more = zmq_msg_more(&frame) != 0;
+        bool valid = more;
+        if (part == 0)
+        {
+            reply.routingId.assign(data, size);
+        }
+        else if (size == 0)
+        {
+            reply.pipelined = false;
+        }
+        else if (size == sizeof(reply.requestId))
+        {
+            reply.pipelined = true;
+            memcpy(&reply.requestId, data, sizeof(reply.requestId));
+        }
+        else
+        {
+            valid = false;
+        }
+        zmq_msg_close(&frame);
+
+        if (!valid)
+        {
+            SWSS_LOG_ERROR("zmq received malformed request, endpoint: %s, message DROPPED", m_endpoint.c_str());
+            while (more)
+            {
+                zmq_msg_init(&frame);
+                rc = zmq_msg_recv(&frame, m_socket, 0);
+                more = rc >= 0 && zmq_msg_more(&frame);
+                zmq_msg_close(&frame);
+            }
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void ZmqServer::sendQueuedReplies()
+{
+    uint64_t count;
+    if (read(m_replyEventFd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+    {
+        SWSS_LOG_ERROR("failed to read reply eventfd, endpoint: %s, errno: %d", m_endpoint.c_str(), errno);
+    }
+
+    std::deque<QueuedReply> replies;
+    {
+        std::lock_guard<std::mutex> lock(m_replyMutex);
+        replies.swap(m_queuedReplies);
+    }
+
+    for (const auto &reply : replies)
+    {
+        const std::string &routingId = reply.target.routingId;
+        int rc = zmq_send(m_socket, routingId.data(), routingId.size(), ZMQ_SNDMORE | ZMQ_DONTWAIT);
+        if (rc >= 0)
+        {
+            if (reply.target.pipelined)
+            {
+                rc = zmq_send(m_socket, &reply.target.requestId, sizeof(reply.target.requestId), ZMQ_SNDMORE | ZMQ_DONTWAIT);
+            }
+            else
+            {
+                rc = zmq_send(m_socket, nullptr, 0, ZMQ_SNDMORE | ZMQ_DONTWAIT);
+            }
+        }
+        if (rc >= 0)
+        {
+            rc = zmq_send(m_socket, reply.payload.data(), reply.payload.size(), ZMQ_DONTWAIT);
+        }
+
+        if (rc < 0)
+        {
+            // EHOSTUNREACH: the client went away while the reply was pending.
+            SWSS_LOG_ERROR("zmq send reply failed, endpoint: %s, zmqerrno: %d", m_endpoint.c_str(), zmq_errno());
+            continue;
+        }
+
+        SWSS_LOG_DEBUG("zmq sent %zu bytes", reply.payload.size());
+    }
+}
+
+void ZmqServer::startDecodeWorkers()
+{
+    for (unsigned int i = 0; i < m_decodeThreads; i++)
+    {
+        m_decodeWorkers.emplace_back(new DecodeWorker());
+        auto &worker = *m_decodeWorkers.back();
+        worker.thread = std::thread(&ZmqServer::decodeWorkerThread, this, std::ref(worker));
+    }
+}
+
+void ZmqServer::stopDecodeWorkers()
+{
+    for (auto &worker : m_decodeWorkers)
+    {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            worker->stop = true;
+        }
+        worker->cv.notify_all();
+        worker->thread.join();
+    }
+
+    m_decodeWorkers.clear();
+}
+
+void ZmqServer::queueToDecodeWorker(zmq_msg_t &msg)
+{
+    std::string dbName;
+    std::string tableName;
+    BinarySerializer::deserializeTableName(static_cast<const char*>(zmq_msg_data(&msg)), zmq_msg_size(&msg), dbName, tableName);
+
+    size_t hash = std::hash<std::string>()(dbName) * 31 + std::hash<std::string>()(tableName);
+    auto &worker = *m_decodeWorkers[hash % m_decodeWorkers.size()];
+
+    std::unique_lock<std::mutex> lock(worker.mutex);
+    worker.cv.wait(lock, [&worker]() { return worker.messages.size() < (size_t)MQ_WATERMARK; });
+
+    // deque::emplace_back() does not move existing elements, so queued
+    // zmq_msg_t stay where zmq_msg_move() put them.
+    worker.messages.emplace_back();
+    zmq_msg_init(&worker.messages.back());
+    zmq_msg_move(&worker.messages.back(), &msg);
+    lock.unlock();
+
+    worker.cv.notify_all();
+}
+
+void ZmqServer::decodeWorkerThread(DecodeWorker &worker)
+{
+    SWSS_LOG_ENTER();
+
+    while (true)
+    {
+        zmq_msg_t msg;
+        {
+            std::unique_lock<std::mutex> lock(worker.mutex);
+            worker.cv.wait(lock, [&worker]() { return worker.stop || !worker.messages.empty(); });
+            if (worker.messages.empty())
+            {
+                break;
+            }
+
+            zmq_msg_init(&msg);
+            zmq_msg_move(&msg, &worker.messages.front());
+            zmq_msg_close(&worker.messages.front());
+            worker.messages.pop_front();
+        }
+        worker.cv.notify_all();
+
+        try
+        {
+            handleReceivedData(static_cast<const char*>(zmq_msg_data(&msg)), zmq_msg_size(&msg));
+        }
+        catch (const std::exception &e)
+        {
+            SWSS_LOG_ERROR("ZmqServer failed to handle received message, endpoint: %s, error: %s, message DROPPED", m_endpoint.c_str(), e.what());
+        }
+        zmq_msg_close(&msg);
+    }
+}
+
 void ZmqServer::sendMsg(
     const std::string &dbName, const std::string &tableName,
     const std::vector<swss::KeyOpFieldsValuesTuple> &values)
@@ -319,64 +858,40 @@ void ZmqServer::sendMsg(
     return;
   }
 
-  int serializedlen = (int)BinarySerializer::serializeBuffer(
-      m_buffer.data(), m_buffer.size(), dbName, tableName, values);
-
-  SWSS_LOG_DEBUG("sending: %d", serializedlen);
-  int zmq_err = 0;
-  int retry_delay = 10;
-  int rc = 0;
-  for (int i = 0; i <= MQ_MAX_RETRY; ++i) {
-    rc = zmq_send(m_socket, m_buffer.data(), serializedlen, 0);
-
-    if (rc >= 0) {
-      m_allowZmqPoll = true;
-      SWSS_LOG_DEBUG("zmq sent %d bytes", serializedlen);
-      return;
-    }
-
-    zmq_err = zmq_errno();
-    // sleep (2 ^ retry time) * 10 ms
-    retry_delay *= 2;
-    if (zmq_err == EINTR || zmq_err == EFSM) {
-      // EINTR: interrupted by signal
-      // EFSM: socket state not ready
-      //       For example when ZMQ socket still not receive reply message from
-      //       last sended package. There was state machine inside ZMQ socket,
-      //       when the socket is not in ready to send state, this error will
-      //       happen.
-      // for more detail, please check: http://api.zeromq.org/2-1:zmq-send
-      SWSS_LOG_DEBUG("zmq send retry, endpoint: %s, error: %d",
-                     m_endpoint.c_str(), zmq_err);
-
-      retry_delay = 0;
-    } else if (zmq_err == EAGAIN) {
-      // EAGAIN: ZMQ is full to need try again
-      SWSS_LOG_WARN("zmq is full, will retry in %d ms, endpoint: %s, error: %d",
-                    retry_delay, m_endpoint.c_str(), zmq_err);
-    } else if (zmq_err == ETERM) {
-      auto message = "zmq connection break, endpoint: " + m_endpoint +
-                     ", error: " + to_string(rc);
-      SWSS_LOG_ERROR("%s", message.c_str());
-      throw system_error(make_error_code(errc::connection_reset), message);
-    } else {
-      // for other error, send failed immediately.
-      auto message = "zmq send failed, endpoint: " + m_endpoint +
-                     ", error: " + to_string(rc);
-      SWSS_LOG_ERROR("%s", message.c_str());
-      throw system_error(make_error_code(errc::io_error), message);
-    }
-
-    usleep(retry_delay * 1000);
+  // Replies are matched to requests in the order the requests arrived. The
+  // reply is handed to the poll thread, which owns the socket.
+  std::unique_lock<std::mutex> lock(m_replyMutex);
+  if (m_pendingReplies.empty()) {
+    auto message = "zmq send failed, endpoint: " + m_endpoint +
+                   ", no request is waiting for a reply";
+    SWSS_LOG_ERROR("%s", message.c_str());
+    throw system_error(make_error_code(errc::io_error), message);
+  }
+
+  QueuedReply reply;
+  reply.target = std::move(m_pendingReplies.front());
+  m_pendingReplies.pop_front();
+
+  auto version = static_cast<BinarySerializer::Version>(reply.target.version);
+  size_t msgsize =
+      BinarySerializer::serializedSize(dbName, tableName, values, version);
+  reply.payload.resize(msgsize);
+  size_t serializedlen = BinarySerializer::serializeBuffer(
+      &reply.payload[0], msgsize, dbName, tableName, values, version);
+  reply.payload.resize(serializedlen);
+
+  m_queuedReplies.push_back(std::move(reply));
+  lock.unlock();
+
+  uint64_t one = 1;
+  if (write(m_replyEventFd, &one, sizeof(one)) < 0) {
+    auto message = "zmq send failed, endpoint: " + m_endpoint +
+                   ", can't signal reply eventfd, errno: " + to_string(errno);
+    SWSS_LOG_ERROR("%s", message.c_str());
+    throw system_error(make_error_code(errc::io_error), message);
   }
 
-  // failed after retry
-  auto message = "zmq send failed, endpoint: " + m_endpoint +
-                 ", zmqerrno: " + to_string(zmq_err) + ":" +
-                 zmq_strerror(zmq_err) +
-                 ", msg length:" + to_string(serializedlen);
-  SWSS_LOG_ERROR("%s", message.c_str());
-  throw system_error(make_error_code(errc::io_error), message);
+  SWSS_LOG_DEBUG("zmq queued reply of %zu bytes", serializedlen);
 }
 
 }
@@ -6,8 +6,11 @@
 #include <string>
 #include <deque>
 #include <condition_variable>
+#include <thread>
 #include <vector>
+#include <zmq.h>
 #include "table.h"
+#include "zmqcompression.h"
 
 #define MQ_RESPONSE_MAX_COUNT (16*1024*1024)
 #define MQ_SIZE 100
@@ -15,11 +18,15 @@
 #define MQ_POLL_TIMEOUT (1000)
 #define MQ_WATERMARK 10000
 
+#define ZMQ_RESUME_DB "ZMQ_RESUME"
+
 /***** ZMQ PORT *****/
 static const int ORCH_ZMQ_PORT = 8100;
 
 namespace swss {
 
+class ShmRing;
+
 class ZmqMessageHandler
 {
 public:
@@ -29,11 +36,13 @@ public:
 
 // Shared (db, table) -> handler map. Co-owned by ZmqServer and every
 // registered handler so neither party requires the other to outlive it.
-// The mutex is held across handler dispatch, so removeHandler() blocks
-// until any in-flight callback into the handler being removed has returned
-// — making it safe for the caller to destroy the handler immediately after
-// removeHandler() returns. Handler callbacks therefore must not themselves
-// call registerHandler / removeHandler (would self-deadlock).
+// Handlers are spread over shards by (db, table) hash, and each handler has
+// its own mutex which is held across dispatch into it. removeHandler() takes
+// that mutex too, so it blocks until any in-flight callback into the handler
+// being removed has returned — making it safe for the caller to destroy the
+// handler immediately after removeHandler() returns. Dispatch into different
+// handlers runs concurrently. A handler callback must not remove itself
+// (would self-deadlock).
 class ZmqHandlerRegistry
 {
 public:
@@ -48,9 +57,26 @@ public:
                   const std::string& tableName,
                   const std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos);
 
+    static constexpr size_t SHARD_COUNT = 16;
+
 private:
-    std::mutex m_mutex;
-    std::map<std::string, std::map<std::string, ZmqMessageHandler*>> m_handlers;
+    struct HandlerEntry
+    {
+        std::mutex mutex;
+
+        // Reset to null by removeHandler() while holding mutex.
+        ZmqMessageHandler* handler;
+    };
+
+    struct Shard
+    {
+        std::mutex mutex;
+        std::map<std::pair<std::string, std::string>, std::shared_ptr<HandlerEntry>> handlers;
+    };
+
+    Shard& getShard(const std::string& dbName, const std::string& tableName);
+
+    Shard m_shards[SHARD_COUNT];
 };
 
 class ZmqServer
@@ -60,12 +86,20 @@ public:
     static constexpr int DEFAULT_POP_BATCH_SIZE = 128;
 
     // If oneToOneSync is set to non-zero, it will enable one-to-one sync with
-    // the client. It will use ZMQ_REQ and ZMQ_REP socket type. There can only
-    // be one client and one server for a ZMQ socket.
+    // the client. The server uses a ZMQ_ROUTER socket, which accepts ZMQ_REQ
+    // clients as well as pipelined ZMQ_DEALER clients (see ZmqClient). Each
+    // sendMsg() replies to the oldest request which has not been replied to.
     ZmqServer(const std::string& endpoint);
     ZmqServer(const std::string& endpoint, const std::string& vrf);
     ZmqServer(const std::string& endpoint, const std::string& vrf, bool lazyBind);
     ZmqServer(const std::string& endpoint, const std::string& vrf, bool lazyBind, bool oneToOneSync);
+
+    // With decodeThreads set to non-zero, received messages are deserialized
+    // and dispatched by that many worker threads instead of the receive
+    // thread. Messages are assigned to workers by (db, table), so updates of
+    // a table are still handled in order while different tables proceed in
+    // parallel. Ignored in one-to-one sync mode, which replies in order.
+    ZmqServer(const std::string& endpoint, const std::string& vrf, bool lazyBind, bool oneToOneSync, unsigned int decodeThreads);
     ~ZmqServer();
 
     void registerMessageHandler(
@@ -81,11 +115,46 @@ public:
                                 const std::string& tableName);
 
     // This method should only be used in one-to-one sync mode with the client.
+    // Throws std::system_error when no request is waiting for a reply.
     void sendMsg(const std::string& dbName, const std::string& tableName,
         const std::vector<swss::KeyOpFieldsValuesTuple>& values);
 
     void bind();
 
+    /*
+     * Track the sequence numbers of messages from clients with replay
+     * enabled (see ZmqClient::enableReplay), and answer their resume requests
+     * on resumeEndpoint with the last sequence number applied per table, so
+     * that after a reconnect they only retransmit what was lost. Duplicate
+     * messages are dropped and gaps are counted.
+     *
+     * A resume request is a message for db ZMQ_RESUME_DB with the client
+     * session id as table name, and one operation per table keyed by the db
+     * name, with the table name as field. The reply has the same layout with
+     * the last applied sequence number as value.
+     */
+    void enableResume(const std::string& resumeEndpoint);
+
+    // Size of the shared memory ring of an "shm://name" endpoint, which
+    // takes messages up to half of it. Only effective before bind(), so
+    // with lazyBind. Defaults to ShmRing::DEFAULT_CAPACITY.
+    void setShmCapacity(size_t capacity);
+
+    struct SequenceStats
+    {
+        /* messages dropped because they were applied already */
+        uint64_t duplicates;
+
+        /* times messages were found missing from a table's stream */
+        uint64_t gaps;
+    };
+
+    SequenceStats getSequenceStats();
+
+    // Compressed messages are always accepted, see ZmqClient::enableCompression.
+    // decompressFailed counts those dropped because they failed to decompress.
+    ZmqCompression::Stats getCompressionStats();
+
     // Internal: returns the shared handler registry so a handler implementation
     // can co-own it. This lets the handler's destructor call removeHandler()
     // without depending on the ZmqServer still being alive (the registry
@@ -96,18 +165,77 @@ public:
 private:
     void handleReceivedData(const char* buffer, const size_t size);
 
+    // false if the message was applied already and must be dropped
+    bool acceptSequence(const std::string& dbName,
+                        const std::string& tableName,
+                        uint64_t session,
+                        uint64_t number);
+
+    void resumeThread(std::string resumeEndpoint);
+
+    void handleResumeRequest(void* socket, const char* buffer, size_t size);
+
     void startMqPollThread();
 
     void mqPollThread();
 
+    // Receive loop of an "shm://name" endpoint.
+    void shmPollThread();
+
+    // Where the reply to a one-to-one sync request goes.
+    struct PendingReply
+    {
+        std::string routingId;
+
+        // Request id of a pipelined client, ZMQ_REQ clients have none.
+        bool pipelined = false;
+        uint64_t requestId = 0;
+
+        // Replies use the wire format of the request, see BinarySerializer::Version.
+        int version = 1;
+    };
+
+    struct QueuedReply
+    {
+        PendingReply target;
+        std::string payload;
+    };
+
+    // Receive the routing envelope of a one-to-one sync request. Returns
+    // false if the request was malformed and has been dropped.
+    bool receiveEnvelope(PendingReply &reply);
+
+    void sendQueuedReplies();
+
+    struct DecodeWorker
+    {
+        std::mutex mutex;
+        std::condition_variable cv;
+
+        // Received messages, owned by the queue until taken by the worker.
+        std::deque<zmq_msg_t> messages;
+
+        bool stop = false;
+
+        std::thread thread;
+    };
+
+    void startDecodeWorkers();
+
+    void stopDecodeWorkers();
+
+    // Hand a received message over to the worker of its table, blocks while
+    // that worker has MQ_WATERMARK messages queued.
+    void queueToDecodeWorker(zmq_msg_t &msg);
+
+    void decodeWorkerThread(DecodeWorker &worker);
+
     // Retained as a no-op stub for source compatibility with external test
     // mocks (e.g. sonic-swss's fake_zmqserver.cpp) that override this symbol
     // at link time. The internal dispatch path no longer calls it — handler
     // lookup happens inside ZmqHandlerRegistry::dispatch().
     ZmqMessageHandler* findMessageHandler(const std::string dbName, const std::string tableName);
 
-    std::vector<char> m_buffer;
-
     volatile bool m_runThread;
 
     std::shared_ptr<std::thread> m_mqPollThread;
@@ -120,9 +248,39 @@ private:
 
     void* m_socket;
 
+    // Shared memory transport, used instead of m_socket.
+    std::unique_ptr<ShmRing> m_shmRing;
+    size_t m_shmCapacity = 0;
+
     bool m_oneToOneSync = false;
 
-    bool m_allowZmqPoll;
+    // One-to-one sync mode: requests waiting for sendMsg(), in arrival
+    // order, and replies waiting for the poll thread to send them.
+    std::mutex m_replyMutex;
+    std::deque<PendingReply> m_pendingReplies;
+    std::deque<QueuedReply> m_queuedReplies;
+    int m_replyEventFd = -1;
+
+    // Last applied position of every sequenced (db, table) stream.
+    struct StreamPosition
+    {
+        uint64_t session = 0;
+        uint64_t number = 0;
+    };
+
+    std::mutex m_streamMutex;
+    std::map<std::pair<std::string, std::string>, StreamPosition> m_streams;
+    SequenceStats m_sequenceStats = {};
+
+    // Decompresses messages with FLAG_COMPRESSED.
+    ZmqCompression m_compression;
+
+    volatile bool m_runResumeThread = false;
+    std::shared_ptr<std::thread> m_resumeThread;
+
+    unsigned int m_decodeThreads = 0;
+
+    std::vector<std::unique_ptr<DecodeWorker>> m_decodeWorkers;
 
     // Default-initialized in-class so that link-time mocks of ZmqServer
     // (which may not initialize this member in their stub constructors) still
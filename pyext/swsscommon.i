@@ -53,6 +53,7 @@
 #include "status_code_util.h"
 #include "redis_table_waiter.h"
 #include "restart_waiter.h"
+#include "zmqcompression.h"
 #include "zmqclient.h"
 #include "zmqserver.h"
 #include "zmqconsumerstatetable.h"
@@ -291,6 +292,7 @@ T castSelectableObj(swss::Selectable *temp)
 %include "redisselect.h"
 %include "redistran.h"
 %include "configdb.h"
+%include "zmqcompression.h"
 %include "zmqserver.h"
 %include "zmqclient.h"
 %include "zmqconsumerstatetable.h"
@@ -434,8 +436,10 @@ static inline void zmqProducerBatchedSend(swss::ZmqProducerStateTable &p,
 %include "notificationproducer.h"
 %include "warm_restart.h"
 %include "dbinterface.h"
+%ignore swss::Logger::RateLimiter;
 %include "logger.h"
 %include "events.h"
+%template(EventPublishEntries) std::vector<event_publish_entry_t>;
 
 %include "status_code_util.h"
 #include "redis_table_waiter.h"
@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <syslog.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "common/asynclogger.h"
+#include "common/logger.h"
+
+using namespace std;
+using namespace swss;
+
+struct Collector
+{
+    void operator()(int prio, const char *text, size_t size)
+    {
+        lock_guard<mutex> lock(m_mutex);
+        messages.emplace_back(prio, string(text, size));
+    }
+
+    vector<pair<int, string>> take()
+    {
+        lock_guard<mutex> lock(m_mutex);
+        vector<pair<int, string>> out;
+        out.swap(messages);
+        return out;
+    }
+
+    mutex m_mutex;
+    vector<pair<int, string>> messages;
+};
+
+static bool logMessage(AsyncLogger &logger, int prio, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    bool rc = logger.log(prio, fmt, ap);
+    va_end(ap);
+    return rc;
+}
+
+TEST(AsyncLogger, order)
+{
+    Collector collector;
+    AsyncLogger logger([&collector](int prio, const char *text, size_t size) {
+        collector(prio, text, size);
+    });
+
+    const int threads = 4;
+    const int count = 5000;
+    vector<thread> writers;
+    for (int t = 0; t < threads; t++)
+    {
+        writers.emplace_back([&logger, t]() {
+            for (int i = 0; i < count; i++)
+            {
+                // Sizes which don't divide the ring, to wrap at odd places.
+                string pad((size_t)(i % 300), 'x');
+                while (!logMessage(logger, LOG_INFO, "%d %d %s", t, i, pad.c_str()))
+                {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto &w : writers)
+    {
+        w.join();
+    }
+    logger.flush();
+
+    map<int, int> next;
+    auto messages = collector.take();
+    ASSERT_EQ((size_t)(threads * count), messages.size());
+    for (const auto &m : messages)
+    {
+        int t, i;
+        ASSERT_EQ(2, sscanf(m.second.c_str(), "%d %d", &t, &i));
+        EXPECT_EQ(LOG_INFO, m.first);
+        EXPECT_EQ(next[t]++, i);
+        EXPECT_EQ((size_t)(i % 300), m.second.size() - m.second.find(' ', m.second.find(' ') + 1) - 1);
+    }
+
+    // Rings of exited threads are released.
+    logMessage(logger, LOG_INFO, "poke");
+    for (int i = 0; i < 100; i++)
+    {
+        logger.flush();
+        {
+            lock_guard<mutex> lock(logger.m_ringsMutex);
+            if (logger.m_rings.size() == 1)
+            {
+                break;
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(20));
+    }
+    EXPECT_EQ(1u, logger.m_rings.size());
+
+    // Retried above when a ring was full.
+    auto stats = logger.getStats();
+    EXPECT_EQ((uint64_t)(threads * count + 1), stats.written);
+    EXPECT_EQ(0u, stats.direct);
+}
+
+TEST(AsyncLogger, full)
+{
+    Collector collector;
+    mutex gate;
+    atomic<bool> stalled(true);
+    vector<pair<int, string>> direct;
+    thread::id caller = this_thread::get_id();
+
+    unique_ptr<AsyncLogger> logger(new AsyncLogger([&](int prio, const char *text, size_t size) {
+        if (stalled && this_thread::get_id() == caller)
+        {
+            direct.emplace_back(prio, string(text, size));
+            return;
+        }
+        lock_guard<mutex> lock(gate);
+        collector(prio, text, size);
+    }, 0));
+
+    // Stall the writer, the smallest ring fills up.
+    gate.lock();
+    EXPECT_TRUE(logMessage(*logger, LOG_INFO, "first"));
+    int queued = 1;
+    while (logMessage(*logger, LOG_INFO, "%01000d", queued))
+    {
+        queued++;
+    }
+    while (logMessage(*logger, LOG_INFO, "%d", queued))
+    {
+        queued++;
+    }
+    EXPECT_FALSE(logMessage(*logger, LOG_DEBUG, "dropped"));
+    EXPECT_TRUE(logMessage(*logger, LOG_ERR, "error %d", 1));
+    EXPECT_TRUE(logMessage(*logger, LOG_CRIT, "crit"));
+
+    // Truncated to the limit.
+    string big(AsyncLogger::MAX_MESSAGE_SIZE * 2, 'b');
+    EXPECT_TRUE(logMessage(*logger, LOG_ERR, "%s", big.c_str()));
+
+    auto stats = logger->getStats();
+    EXPECT_EQ(3u, stats.dropped);
+    EXPECT_EQ(3u, stats.direct);
+    EXPECT_EQ(3u, direct.size());
+    if (direct.size() == 3)
+    {
+        EXPECT_EQ(make_pair(LOG_ERR, string("error 1")), direct[0]);
+        EXPECT_EQ(AsyncLogger::MAX_MESSAGE_SIZE - 1, direct[2].second.size());
+    }
+
+    stalled = false;
+    gate.unlock();
+    logger.reset();
+
+    // All queued messages, then the drop report.
+    auto messages = collector.take();
+    ASSERT_EQ((size_t)queued + 1, messages.size());
+    EXPECT_EQ("first", messages[0].second);
+    EXPECT_EQ(LOG_WARNING, messages.back().first);
+    EXPECT_NE(string::npos, messages.back().second.find("dropped 3 log messages"));
+}
+
+TEST(AsyncLogger, logger)
+{
+    auto prio = Logger::getMinPrio();
+    Logger::setMinPrio(Logger::SWSS_INFO);
+    Logger::swssOutputNotify("", "STDOUT");
+    Logger::setAsync(true);
+    EXPECT_TRUE(Logger::isAsync());
+
+    testing::internal::CaptureStdout();
+    SWSS_LOG_INFO("async %d", 42);
+    SWSS_LOG_DEBUG("filtered");
+    Logger::flush();
+    fflush(stdout);
+    string out = testing::internal::GetCapturedStdout();
+
+    Logger::setAsync(false);
+    EXPECT_FALSE(Logger::isAsync());
+    Logger::swssOutputNotify("", "SYSLOG");
+    Logger::setMinPrio(prio);
+
+    EXPECT_EQ("  INFO:- TestBody: async 42\n", out);
+    EXPECT_LE(1u, Logger::getAsyncStats().written);
+}
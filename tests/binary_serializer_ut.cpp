@@ -3,6 +3,7 @@
 
 #include "common/table.h"
 #include "common/binaryserializer.h"
+#include "common/zmqcompression.h"
 
 using namespace std;
 using namespace swss;
@@ -125,3 +126,182 @@ TEST(BinarySerializer, protocol_buffer)
     EXPECT_EQ(db_table, test_table);
     EXPECT_EQ(deserialized_kcos, kcos);
 }
+
+TEST(BinarySerializer, version2_serialize_deserialize)
+{
+    std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
+        KeyOpFieldsValuesTuple{"set_key", SET_COMMAND, std::vector<FieldValueTuple>{{"f1", "v1"}, {"f2", string(300, 'x')}}},
+        KeyOpFieldsValuesTuple{"hset_key", HSET_COMMAND, std::vector<FieldValueTuple>{{"f", "v"}}},
+        KeyOpFieldsValuesTuple{"del_key", DEL_COMMAND, std::vector<FieldValueTuple>{}},
+        KeyOpFieldsValuesTuple{"empty_set_key", SET_COMMAND, std::vector<FieldValueTuple>{}},
+        KeyOpFieldsValuesTuple{"custom_key", "CUSTOM", std::vector<FieldValueTuple>{{"f", ""}}}};
+
+    size_t v1_len = BinarySerializer::serializedSize("test_db", "test_table", kcos);
+    size_t v2_len = BinarySerializer::serializedSize("test_db", "test_table", kcos, BinarySerializer::VERSION_2);
+    EXPECT_LT(v2_len, v1_len);
+
+    std::vector<char> buffer(v2_len);
+    size_t serialized_len = BinarySerializer::serializeBuffer(
+                                                            buffer.data(),
+                                                            buffer.size(),
+                                                            "test_db",
+                                                            "test_table",
+                                                            kcos,
+                                                            BinarySerializer::VERSION_2);
+    EXPECT_EQ(serialized_len, v2_len);
+    EXPECT_EQ(BinarySerializer::getVersion(buffer.data(), serialized_len), BinarySerializer::VERSION_2);
+
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos_ptrs;
+    string db_name;
+    string db_table;
+    BinarySerializer::deserializeBuffer(buffer.data(), serialized_len, db_name, db_table, kcos_ptrs);
+
+    std::vector<KeyOpFieldsValuesTuple> deserialized_kcos;
+    for (auto kco_ptr : kcos_ptrs)
+    {
+        deserialized_kcos.push_back(*kco_ptr);
+    }
+
+    EXPECT_EQ(db_name, "test_db");
+    EXPECT_EQ(db_table, "test_table");
+    // Version 2 carries the operation explicitly, so HSET, custom operations
+    // and SET without fields survive the round trip.
+    EXPECT_EQ(deserialized_kcos, kcos);
+
+    // Every truncation of the message is detected.
+    for (size_t len = 0; len < serialized_len; len++)
+    {
+        kcos_ptrs.clear();
+        EXPECT_THROW(BinarySerializer::deserializeBuffer(buffer.data(), len, db_name, db_table, kcos_ptrs), runtime_error);
+    }
+}
+
+TEST(BinarySerializer, version_detection)
+{
+    char buffer[200];
+    std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
+        KeyOpFieldsValuesTuple{"test_entry_key", SET_COMMAND, std::vector<FieldValueTuple>{{"f", "v"}}}};
+
+    size_t serialized_len = BinarySerializer::serializeBuffer(buffer, sizeof(buffer), "test_db", "test_table", kcos);
+    EXPECT_EQ(BinarySerializer::getVersion(buffer, serialized_len), BinarySerializer::VERSION_1);
+
+    serialized_len = BinarySerializer::serializeBuffer(buffer, sizeof(buffer), "test_db", "test_table", kcos, BinarySerializer::VERSION_2);
+    EXPECT_EQ(BinarySerializer::getVersion(buffer, serialized_len), BinarySerializer::VERSION_2);
+
+    EXPECT_THROW(BinarySerializer::serializeBuffer(buffer, 20, "test_db", "test_table", kcos, BinarySerializer::VERSION_2), runtime_error);
+}
+
+TEST(BinarySerializer, deserialize_invalid_attribute_count)
+{
+    char buffer[200];
+    std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
+        KeyOpFieldsValuesTuple{"key", SET_COMMAND, std::vector<FieldValueTuple>{{"f", "v"}}}};
+    size_t serialized_len = BinarySerializer::serializeBuffer(buffer, sizeof(buffer), "db", "table", kcos);
+
+    // Layout: count, "db", "table", "key", "1", ... -- corrupt the "1".
+    size_t count_offset = sizeof(size_t) * 5 + strlen("db") + strlen("table") + strlen("key");
+    ASSERT_EQ(buffer[count_offset], '1');
+    buffer[count_offset] = 'x';
+
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos_ptrs;
+    string db_name;
+    string db_table;
+    EXPECT_THROW(BinarySerializer::deserializeBuffer(buffer, serialized_len, db_name, db_table, kcos_ptrs), runtime_error);
+}
+
+TEST(BinarySerializer, sequence)
+{
+    char buffer[200];
+    std::vector<KeyOpFieldsValuesTuple> kcos = std::vector<KeyOpFieldsValuesTuple>{
+        KeyOpFieldsValuesTuple{"key", SET_COMMAND, std::vector<FieldValueTuple>{{"f", "v"}}}};
+
+    BinarySerializer::Sequence sequence;
+    sequence.session = 0x123456789abcdefULL;
+    sequence.number = 300;
+    size_t serialized_len = BinarySerializer::serializeBuffer(buffer, sizeof(buffer), "db", "table", kcos, BinarySerializer::VERSION_2, &sequence);
+    EXPECT_EQ(serialized_len, BinarySerializer::serializedSize("db", "table", kcos, BinarySerializer::VERSION_2, &sequence));
+
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos_ptrs;
+    string db_name;
+    string db_table;
+    BinarySerializer::Sequence decoded;
+    BinarySerializer::deserializeBuffer(buffer, serialized_len, db_name, db_table, kcos_ptrs, &decoded);
+    EXPECT_EQ(db_name, "db");
+    EXPECT_EQ(db_table, "table");
+    ASSERT_EQ(kcos_ptrs.size(), 1u);
+    EXPECT_EQ(kfvKey(*kcos_ptrs[0]), "key");
+    EXPECT_EQ(decoded.session, sequence.session);
+    EXPECT_EQ(decoded.number, sequence.number);
+
+    db_name.clear();
+    db_table.clear();
+    BinarySerializer::deserializeTableName(buffer, serialized_len, db_name, db_table);
+    EXPECT_EQ(db_name, "db");
+    EXPECT_EQ(db_table, "table");
+
+    // Messages without a sequence report number 0.
+    serialized_len = BinarySerializer::serializeBuffer(buffer, sizeof(buffer), "db", "table", kcos, BinarySerializer::VERSION_2);
+    kcos_ptrs.clear();
+    BinarySerializer::deserializeBuffer(buffer, serialized_len, db_name, db_table, kcos_ptrs, &decoded);
+    EXPECT_EQ(decoded.number, 0u);
+
+    // Version 1 can't carry a sequence.
+    EXPECT_THROW(BinarySerializer::serializeBuffer(buffer, sizeof(buffer), "db", "table", kcos, BinarySerializer::VERSION_1, &sequence), runtime_error);
+}
+
+TEST(BinarySerializer, compression)
+{
+    std::vector<KeyOpFieldsValuesTuple> kcos;
+    for (int i = 0; i < 200; i++)
+    {
+        kcos.emplace_back("ACL_RULE_" + to_string(i), SET_COMMAND, std::vector<FieldValueTuple>{
+            {"PRIORITY", "1000"}, {"PACKET_ACTION", "DROP"}, {"SRC_IP", "10.0.0." + to_string(i % 256) + "/32"}});
+    }
+
+    BinarySerializer::Sequence sequence;
+    sequence.session = 7;
+    sequence.number = 42;
+    std::vector<char> plain(BinarySerializer::serializedSize("db", "table", kcos, BinarySerializer::VERSION_2, &sequence));
+    size_t plain_len = BinarySerializer::serializeBuffer(plain.data(), plain.size(), "db", "table", kcos, BinarySerializer::VERSION_2, &sequence);
+    EXPECT_FALSE(BinarySerializer::isCompressed(plain.data(), plain_len));
+
+    ZmqCompression compression(1024);
+    std::vector<char> compressed(ZmqCompression::compressBound(plain_len));
+    size_t compressed_len = compression.compress(plain.data(), plain_len, compressed.data(), compressed.size());
+    if (!ZmqCompression::isSupported())
+    {
+        EXPECT_EQ(compressed_len, 0u);
+        return;
+    }
+
+    ASSERT_GT(compressed_len, 0u);
+    EXPECT_LT(compressed_len, plain_len / 4);
+    EXPECT_TRUE(BinarySerializer::isCompressed(compressed.data(), compressed_len));
+
+    // Routing doesn't need to decompress.
+    string db_name;
+    string db_table;
+    BinarySerializer::deserializeTableName(compressed.data(), compressed_len, db_name, db_table);
+    EXPECT_EQ(db_name, "db");
+    EXPECT_EQ(db_table, "table");
+
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos_ptrs;
+    EXPECT_THROW(BinarySerializer::deserializeBuffer(compressed.data(), compressed_len, db_name, db_table, kcos_ptrs), runtime_error);
+
+    std::string decompressed;
+    compression.decompress(compressed.data(), compressed_len, decompressed, plain_len);
+    EXPECT_EQ(decompressed, std::string(plain.data(), plain_len));
+    EXPECT_THROW(compression.decompress(compressed.data(), compressed_len, decompressed, plain_len - 1), runtime_error);
+    EXPECT_THROW(compression.decompress(compressed.data(), compressed_len - 1, decompressed, plain_len), runtime_error);
+
+    // Below the threshold.
+    EXPECT_EQ(compression.compress(plain.data(), 100, compressed.data(), compressed.size()), 0u);
+
+    auto stats = compression.getStats();
+    EXPECT_EQ(stats.compressed, 1u);
+    EXPECT_EQ(stats.skipped, 1u);
+    EXPECT_EQ(stats.bytesIn, plain_len);
+    EXPECT_EQ(stats.bytesOut, compressed_len);
+    EXPECT_EQ(stats.decompressed, 1u);
+    EXPECT_GT(stats.ratio(), 4.0);
+}
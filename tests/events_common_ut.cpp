@@ -6,6 +6,7 @@
 #include <regex>
 #include "gtest/gtest.h"
 #include "common/events_common.h"
+#include "common/events.h"
 
 using namespace std;
 
@@ -145,3 +146,225 @@ TEST(events_common, send_recv_control_character)
     zmq_close(sock_p1);
     zmq_ctx_term(zmq_ctx);
 }
+
+static void
+set_wire_version(const char *version)
+{
+    const char *tfile_name = "/tmp/init_cfg_wire.json";
+    ofstream tfile(tfile_name);
+    tfile << "{\"events\": {\"wire_version\": \"" << version << "\"}}\n";
+    tfile.close();
+
+    read_init_config(tfile_name);
+}
+
+static internal_event_t
+sample_event()
+{
+    return {
+        { EVENT_STR_DATA, "{\"sonic-events-bgp:bgp-state\":{\"ip\":\"10.10.10.10\",\"status\":\"down\",\"timestamp\":\"2022-08-17T02:39:21.286611Z\"}}" },
+        { EVENT_RUNTIME_ID, "1b4e28ba-2fa1-11d2-883f-0016d3cca427" },
+        { EVENT_SEQUENCE, "12345" },
+        { EVENT_EPOCH, "1660703961286611000" } };
+}
+
+TEST(events_common, wire_version)
+{
+    /* Text unless deployments opt in */
+    read_init_config(NULL);
+    EXPECT_EQ(EVENTS_WIRE_TEXT, events_wire_version());
+
+    set_wire_version("2");
+    EXPECT_EQ(EVENTS_WIRE_BINARY, events_wire_version());
+
+    /* Bad values fall back to text */
+    for (const char *bad: { "0", "3", "-1", "2x", "binary", " " }) {
+        set_wire_version(bad);
+        EXPECT_EQ(EVENTS_WIRE_TEXT, events_wire_version()) << bad;
+    }
+
+    read_init_config(NULL);
+}
+
+TEST(events_common, binary_serialize)
+{
+    set_wire_version("2");
+    EXPECT_EQ(EVENTS_WIRE_BINARY, events_wire_version());
+
+    internal_event_t evt = sample_event(), evt1;
+    string s;
+
+    EXPECT_EQ(0, serialize(evt, s));
+    EXPECT_TRUE(is_binary_serialized(s.data(), s.size()));
+    EXPECT_EQ(0, deserialize(s, evt1));
+    EXPECT_EQ(evt, evt1);
+
+    /* Empty values and NUL bytes survive */
+    internal_event_t odd = { { "", "" }, { string("a\0b", 3), string(300, '\0') } };
+    EXPECT_EQ(0, serialize(odd, s));
+    EXPECT_EQ(0, deserialize(s, evt1));
+    EXPECT_EQ(odd, evt1);
+
+    event_serialized_lst_t lst = { "", "one", string(200, 'x') }, lst1;
+    EXPECT_EQ(0, serialize(lst, s));
+    EXPECT_EQ(0, deserialize(s, lst1));
+    EXPECT_EQ(lst, lst1);
+
+    string str("source"), str1;
+    EXPECT_EQ(0, serialize(str, s));
+    EXPECT_EQ(0, deserialize(s, str1));
+    EXPECT_EQ(str, str1);
+
+    /* No binary form, stays text */
+    int code = 5, code1 = 0;
+    EXPECT_EQ(0, serialize(code, s));
+    EXPECT_FALSE(is_binary_serialized(s.data(), s.size()));
+    EXPECT_EQ(0, deserialize(s, code1));
+    EXPECT_EQ(code, code1);
+
+    read_init_config(NULL);
+}
+
+TEST(events_common, binary_serialize_compat)
+{
+    internal_event_t evt = sample_event(), evt1;
+    string text, binary;
+
+    /* Version 1 publishers and caches keep working */
+    set_wire_version("1");
+    EXPECT_EQ(EVENTS_WIRE_TEXT, events_wire_version());
+    EXPECT_EQ(0, serialize(evt, text));
+    EXPECT_FALSE(is_binary_serialized(text.data(), text.size()));
+
+    set_wire_version("2");
+    EXPECT_EQ(0, serialize(evt, binary));
+    EXPECT_LT(binary.size(), text.size());
+
+    EXPECT_EQ(0, deserialize(text, evt1));
+    EXPECT_EQ(evt, evt1);
+
+    /* Mixed cache contents */
+    event_serialized_lst_t lst = { text, binary }, lst1;
+    string s;
+    EXPECT_EQ(0, serialize(lst, s));
+    EXPECT_EQ(0, deserialize(s, lst1));
+    ASSERT_EQ(2u, lst1.size());
+    for (const auto &e: lst1) {
+        evt1.clear();
+        EXPECT_EQ(0, deserialize(e, evt1));
+        EXPECT_EQ(evt, evt1);
+    }
+
+    read_init_config(NULL);
+}
+
+TEST(events_common, binary_serialize_malformed)
+{
+    internal_event_t evt = sample_event(), evt1;
+    string s;
+
+    set_wire_version("2");
+    EXPECT_EQ(0, serialize(evt, s));
+    read_init_config(NULL);
+
+    /* Every truncation is rejected */
+    for (size_t i = 1; i < s.size(); ++i) {
+        EXPECT_EQ(ERR_MESSAGE_INVALID, deserialize(s.substr(0, i), evt1));
+        EXPECT_TRUE(evt1.empty());
+    }
+
+    EXPECT_EQ(ERR_MESSAGE_INVALID, deserialize(s + "x", evt1));
+
+    /* Unknown format */
+    string newer(s);
+    newer[1] = (char)(EVENTS_BINARY_FORMAT + 1);
+    EXPECT_EQ(ERR_MESSAGE_INVALID, deserialize(newer, evt1));
+
+    /* Wrong kind */
+    event_serialized_lst_t lst;
+    EXPECT_EQ(ERR_MESSAGE_INVALID, deserialize(s, lst));
+
+    /* Huge count */
+    string big = s.substr(0, 3) + "\xff\xff\xff\xff\x0f";
+    EXPECT_EQ(ERR_MESSAGE_INVALID, deserialize(big, lst));
+}
+
+TEST(events_common, convert_to_json_ts)
+{
+    string ts("2022-08-17T02:39:21.286611Z");
+    map_str_str_t params = { {"ip", "10.10.10.10"}, {"\"quoted\"\n", "tab\t"}, {"zone", "a"} };
+    map_str_str_t with_ts(params);
+
+    with_ts[EVENT_TS_PARAM] = ts;
+    EXPECT_EQ(convert_to_json("src:tag", with_ts), convert_to_json("src:tag", params, ts));
+
+    /* Kept when given */
+    EXPECT_EQ(convert_to_json("src:tag", with_ts), convert_to_json("src:tag", with_ts, "other"));
+
+    /* Only the timestamp, and last in order */
+    map_str_str_t none, ts_only = { {EVENT_TS_PARAM, ts} }, first = { {"a", "b"} };
+    EXPECT_EQ(convert_to_json("src:tag", ts_only), convert_to_json("src:tag", none, ts));
+    first[EVENT_TS_PARAM] = ts;
+    EXPECT_EQ(convert_to_json("src:tag", first), convert_to_json("src:tag", { {"a", "b"} }, ts));
+
+    /* Non-ASCII goes through nlohmann */
+    map_str_str_t utf8 = { {"name", "caf\xc3\xa9"} }, utf8_ts(utf8);
+    utf8_ts[EVENT_TS_PARAM] = ts;
+    EXPECT_EQ(convert_to_json("src:tag", utf8_ts), convert_to_json("src:tag", utf8, ts));
+
+    string key;
+    map_str_str_t rd_params;
+    EXPECT_EQ(0, convert_from_json(convert_to_json("src:tag", params, ts), key, rd_params));
+    EXPECT_EQ("src:tag", key);
+    EXPECT_EQ(with_ts, rd_params);
+}
+
+TEST(events_common, topic_filters)
+{
+    set_wire_version("2");
+
+    /* Everything */
+    EXPECT_EQ(vector<string>({ "" }), events_topic_filters({}));
+
+    string topic, other, ctrl, filter;
+    serialize(string("sonic-events-bgp:bgp-state"), topic);
+    serialize(string("sonic-events-bgp-ext:bgp-state"), other);
+    serialize(string("sonic-events-bgp:" EVENT_STR_CTRL_DEINIT), ctrl);
+
+    auto matches = [](const vector<string> &subs, const string &t) {
+        for (const auto &s: subs) {
+            if (t.compare(0, s.size(), s) == 0) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    /* A source does not match a longer one, its control messages pass */
+    vector<string> subs = events_topic_filters({ "sonic-events-bgp" });
+    EXPECT_TRUE(matches(subs, topic));
+    EXPECT_TRUE(matches(subs, ctrl));
+    EXPECT_FALSE(matches(subs, other));
+
+    subs = events_topic_filters({ "sonic-events-bgp:bgp-state", "sonic-events-bgp:bgp-down" });
+    EXPECT_TRUE(matches(subs, topic));
+    EXPECT_TRUE(matches(subs, ctrl));
+    EXPECT_FALSE(matches(subs, other));
+    /* Shared control subscription, and one for text topics */
+    EXPECT_EQ(4u, subs.size());
+    EXPECT_EQ(EVENTS_TEXT_ARCHIVE_PREFIX, subs.back());
+
+    /* Text topics are filtered on receive */
+    set_wire_version("1");
+    serialize(string("sonic-events-bgp:bgp-state"), topic);
+    EXPECT_EQ(0u, topic.find(EVENTS_TEXT_ARCHIVE_PREFIX));
+    EXPECT_EQ(vector<string>({ "" }), events_topic_filters({ "sonic-events-bgp" }));
+    read_init_config(NULL);
+
+    EXPECT_EQ("{\"sonic-events-bgp:", events_str_filter("sonic-events-bgp"));
+    EXPECT_EQ("{\"sonic-events-bgp:bgp-state\"", events_str_filter("sonic-events-bgp:bgp-state"));
+    string evt_str = convert_to_json("sonic-events-bgp:bgp-state", {});
+    EXPECT_EQ(0u, evt_str.find(events_str_filter("sonic-events-bgp")));
+    EXPECT_EQ(0u, evt_str.find(events_str_filter("sonic-events-bgp:bgp-state")));
+    EXPECT_NE(0u, evt_str.find(events_str_filter("sonic-events-bgp:bgp")));
+}
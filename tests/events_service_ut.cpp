@@ -7,6 +7,7 @@
 #include "gtest/gtest.h"
 #include "common/events_common.h"
 #include "common/events_service.h"
+#include "common/events_cache.h"
 
 using namespace std;
 
@@ -21,6 +22,8 @@ void serve_commands()
 {
     int code;
     event_serialized_lst_t lst, opt_lst;
+    event_cache cache;
+    EXPECT_EQ(0, cache.init(4096));
     EXPECT_EQ(0, service_svr.init_server(zmq_ctx, 1000));
     while(!do_terminate) {
         if (0 != service_svr.channel_read(code, lst)) {
@@ -36,7 +39,7 @@ void serve_commands()
                 server_wr_lst.clear();
                 break;
             case EVENT_CACHE_START:
-                server_ret = 0;
+                server_ret = cache.push(lst);
                 server_wr_lst.clear();
                 break;
             case EVENT_CACHE_STOP:
@@ -44,8 +47,9 @@ void serve_commands()
                 server_wr_lst.clear();
                 break;
             case EVENT_CACHE_READ:
+                /* Streamed in chunks of at least one event */
                 server_ret = 0;
-                server_wr_lst = { "rerer", "rrrr", "cccc" };
+                cache.read(server_wr_lst, 10);
                 break;
             case EVENT_ECHO:
                 server_ret = 0;
@@ -120,6 +124,12 @@ TEST(events_common, cache_cmds)
     EXPECT_EQ(EVENT_CACHE_READ, server_rd_code);
     EXPECT_TRUE(server_rd_lst.empty());
     EXPECT_EQ(server_wr_lst, lst);
+    EXPECT_EQ(event_serialized_lst_t({ "hello", "world" }), lst);
+
+    EXPECT_EQ(0, service_cl.cache_read(lst));
+    EXPECT_EQ(event_serialized_lst_t({ "ok" }), lst);
+    EXPECT_EQ(0, service_cl.cache_read(lst));
+    EXPECT_TRUE(lst.empty());
 
     string s("hello"), s1;
     EXPECT_EQ(0, service_cl.echo_send(s));
@@ -144,3 +154,115 @@ TEST(events_common, cache_cmds)
 }
 
 
+
+
+TEST(events_cache, ring)
+{
+    event_cache cache;
+    event_serialized_lst_t lst;
+
+    EXPECT_EQ(-1, cache.push(string("early")));
+    EXPECT_EQ(0, cache.init(4096));
+    EXPECT_EQ(2040u, cache.max_event_size());
+
+    /* Oldest dropped for room, across many wraps */
+    deque<string> expected;
+    for (int i = 0; i < 2000; ++i) {
+        string ev(to_string(i) + string((size_t)(i * 37) % 700, 'x'));
+
+        EXPECT_EQ(0, cache.push(ev));
+        expected.push_back(ev);
+        size_t sz = 0;
+        for (const auto &e: expected) {
+            sz += 8 + ((e.size() + 7) & ~(size_t)7);
+        }
+        while (sz > 4096) {
+            sz -= 8 + ((expected.front().size() + 7) & ~(size_t)7);
+            expected.pop_front();
+        }
+        /* Wrap skips may drop a few more */
+        ASSERT_GE(expected.size(), cache.count());
+        while (expected.size() > cache.count()) {
+            expected.pop_front();
+        }
+
+        if (i % 97 == 0) {
+            cache.read(lst, 1000);
+            ASSERT_FALSE(lst.empty());
+            for (const auto &e: lst) {
+                EXPECT_EQ(expected.front(), e);
+                expected.pop_front();
+            }
+        }
+    }
+    EXPECT_LT(0u, cache.dropped());
+
+    size_t bytes = 0;
+    for (const auto &e: expected) {
+        bytes += e.size();
+    }
+    EXPECT_EQ(bytes, cache.bytes());
+
+    while (cache.read(lst, 1), !lst.empty()) {
+        /* One at a time, even when larger than the chunk */
+        ASSERT_EQ(1u, lst.size());
+        EXPECT_EQ(expected.front(), lst[0]);
+        expected.pop_front();
+    }
+    EXPECT_TRUE(expected.empty());
+    EXPECT_EQ(0u, cache.count());
+    EXPECT_EQ(0u, cache.bytes());
+
+    /* Too big for the budget */
+    uint64_t dropped = cache.dropped();
+    EXPECT_EQ(-1, cache.push(string(2041, 'x')));
+    EXPECT_EQ(dropped + 1, cache.dropped());
+    EXPECT_EQ(0, cache.push(string(2040, 'x')));
+    EXPECT_EQ(1u, cache.count());
+    cache.clear();
+    EXPECT_EQ(0u, cache.count());
+}
+
+TEST(events_cache, spill)
+{
+    const char *path = "/tmp/events_cache_ut.bin";
+    event_serialized_lst_t lst, in = { "one", "two", string(100, 't') };
+
+    unlink(path);
+    {
+        event_cache cache;
+
+        EXPECT_EQ(0, cache.init(8192, path));
+        EXPECT_EQ(0, cache.push(in));
+        cache.read(lst, 1);
+        EXPECT_EQ(event_serialized_lst_t({ "one" }), lst);
+    }
+
+    /* Survives a restart */
+    {
+        event_cache cache;
+
+        EXPECT_EQ(0, cache.init(8192, path));
+        EXPECT_EQ(2u, cache.count());
+        cache.read(lst);
+        EXPECT_EQ(event_serialized_lst_t(in.begin() + 1, in.end()), lst);
+        EXPECT_EQ(0, cache.push(string("three")));
+    }
+
+    /* A different budget starts over */
+    {
+        event_cache cache;
+
+        EXPECT_EQ(0, cache.init(4096, path));
+        EXPECT_EQ(0u, cache.count());
+    }
+
+    /* Config driven */
+    {
+        event_cache cache;
+
+        EXPECT_EQ(0, cache.init());
+        EXPECT_EQ((size_t)DEFAULT_CACHE_MAX_BYTES / 2 - 8, cache.max_event_size());
+    }
+    unlink(path);
+}
@@ -695,3 +695,247 @@ TEST(events, options)
 
 
 
+
+static vector<internal_event_t> batch_evts;
+static vector<string> batch_topics;
+static bool terminate_batch_sub = false;
+
+/* Mock a subscriber keeping every event read */
+void run_batch_sub()
+{
+    void *mock_sub = zmq_socket (zmq_ctx, ZMQ_SUB);
+    int block_ms = 200;
+
+    EXPECT_TRUE(NULL != mock_sub);
+    EXPECT_EQ(0, zmq_bind(mock_sub, get_config(XSUB_END_KEY).c_str()));
+    EXPECT_EQ(0, zmq_setsockopt(mock_sub, ZMQ_SUBSCRIBE, "", 0));
+    EXPECT_EQ(0, zmq_setsockopt(mock_sub, ZMQ_RCVTIMEO, &block_ms, sizeof (block_ms)));
+
+    while(!terminate_batch_sub) {
+        string source;
+        internal_event_t ev_int;
+
+        if ((0 == zmq_message_read(mock_sub, 0, source, ev_int)) && !ev_int.empty()) {
+            batch_evts.push_back(ev_int);
+            batch_topics.push_back(source);
+        }
+    }
+    terminate_batch_sub = false;
+    zmq_close(mock_sub);
+}
+
+TEST(events, publish_batch)
+{
+    string evt_source("sonic-events-if");
+    vector<event_publish_entry_t> events;
+
+    for (int i = 0; i < 50; ++i) {
+        event_publish_entry_t e;
+
+        e.tag = "if-state";
+        e.params["ifname"] = "Ethernet" + to_string(i * 4);
+        e.params["status"] = (i % 2) ? "up" : "down";
+        if (i == 0) {
+            e.params[EVENT_TS_PARAM] = "2022-08-17T02:39:21.286611Z";
+        }
+        events.push_back(e);
+    }
+
+    zmq_ctx = zmq_ctx_new();
+    EXPECT_TRUE(NULL != zmq_ctx);
+
+    batch_evts.clear();
+    batch_topics.clear();
+    thread thr(&pub_serve_commands);
+    thread thr_sub(&run_batch_sub);
+
+    event_handle_t h = events_init_publisher(evt_source);
+    EXPECT_TRUE(NULL != h);
+
+    /* Take a pause to allow publish to connect async */
+    this_thread::sleep_for(chrono::milliseconds(300));
+
+    EXPECT_EQ(0, event_publish_batch(h, vector<event_publish_entry_t>()));
+    EXPECT_EQ(0, event_publish_batch(h, events));
+    EXPECT_EQ(-1, event_publish_batch(NULL, events));
+
+    for (int i = 0; (batch_evts.size() < events.size()) && (i < 100); ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    terminate_svc = true;
+    terminate_batch_sub = true;
+    thr.join();
+    thr_sub.join();
+
+    ASSERT_EQ(events.size(), batch_evts.size());
+
+    string batch_ts;
+    for (size_t i = 0; i < events.size(); ++i) {
+        string key;
+        event_params_t params;
+
+        EXPECT_EQ(seq_to_str((sequence_t)(i + 1)), batch_evts[i][EVENT_SEQUENCE]);
+        EXPECT_EQ(batch_evts[0][EVENT_RUNTIME_ID], batch_evts[i][EVENT_RUNTIME_ID]);
+        EXPECT_EQ(0, convert_from_json(batch_evts[i][EVENT_STR_DATA], key, params));
+        EXPECT_EQ(evt_source + ":if-state", key);
+        EXPECT_EQ(key, batch_topics[i]);
+
+        /* The batch shares one timestamp, given ones are kept */
+        string ts = params[EVENT_TS_PARAM];
+        events_validate_ts(ts);
+        if (i == 0) {
+            EXPECT_EQ(events[0].params, params);
+        }
+        else {
+            if (batch_ts.empty()) {
+                batch_ts = ts;
+            }
+            EXPECT_EQ(batch_ts, ts);
+            params.erase(EVENT_TS_PARAM);
+            EXPECT_EQ(events[i].params, params);
+        }
+    }
+
+    events_deinit_publisher(h);
+    zmq_ctx_term(zmq_ctx);
+    zmq_ctx = NULL;
+}
+
+static internal_event_t
+filter_event(const string &key, const string &runtime_id, sequence_t seq)
+{
+    internal_event_t ev;
+
+    ev[EVENT_STR_DATA] = convert_to_json(key, {});
+    ev[EVENT_RUNTIME_ID] = runtime_id;
+    ev[EVENT_SEQUENCE] = seq_to_str(seq);
+    ev[EVENT_EPOCH] = "1";
+    return ev;
+}
+
+TEST(events, subscribe_filter)
+{
+    zmq_ctx = zmq_ctx_new();
+    EXPECT_TRUE(NULL != zmq_ctx);
+
+    /* Mock the proxy, subscribers connect to its XPUB end */
+    void *mock_pub = zmq_socket (zmq_ctx, ZMQ_PUB);
+    EXPECT_EQ(0, zmq_bind(mock_pub, get_config(XPUB_END_KEY).c_str()));
+
+    event_subscribe_sources_t sources = { "src-a", "src-b:up" };
+    event_handle_t hsub = events_init_subscriber(false, 100, &sources);
+    EXPECT_TRUE(NULL != hsub);
+
+    /* Subscriptions propagate async */
+    this_thread::sleep_for(chrono::milliseconds(300));
+
+    auto send = [mock_pub](const string &key, const internal_event_t &ev) {
+        EXPECT_EQ(0, zmq_message_send(mock_pub, key, ev));
+    };
+    send("src-a:t1", filter_event("src-a:t1", "ra", 1));
+    send("src-ab:t1", filter_event("src-ab:t1", "rab", 1));
+    send("src-b:up", filter_event("src-b:up", "rb", 1));
+    send("src-b:down", filter_event("src-b:down", "rb", 2));
+    send("src-b:up", filter_event("src-b:up", "rb", 3));
+    send("src-c:t1", filter_event("src-c:t1", "rc", 1));
+
+    /* Wire version 1 topics can't be filtered by ZMQ */
+    string text_topic;
+    {
+        ostringstream ss;
+        boost::archive::text_oarchive oarch(ss);
+        oarch << string("src-c:t2");
+        text_topic = ss.str();
+    }
+    zmq_msg_t msg;
+    string part2;
+    EXPECT_EQ(0, serialize(filter_event("src-c:t2", "rc", 2), part2));
+    zmq_msg_init_size(&msg, text_topic.size());
+    memcpy(zmq_msg_data(&msg), text_topic.data(), text_topic.size());
+    EXPECT_EQ((int)text_topic.size(), zmq_msg_send(&msg, mock_pub, ZMQ_SNDMORE));
+    zmq_msg_init_size(&msg, part2.size());
+    memcpy(zmq_msg_data(&msg), part2.data(), part2.size());
+    EXPECT_EQ((int)part2.size(), zmq_msg_send(&msg, mock_pub, 0));
+
+    send("src-a:t2", filter_event("src-a:t2", "ra", 2));
+
+    vector<string> keys;
+    vector<uint32_t> missed;
+    while (true) {
+        event_receive_op_t evt;
+
+        if (event_receive(hsub, evt) != 0) {
+            break;
+        }
+        keys.push_back(evt.key);
+        missed.push_back(evt.missed_cnt);
+    }
+
+    EXPECT_EQ(vector<string>({ "src-a:t1", "src-b:up", "src-b:up", "src-a:t2" }), keys);
+    /* Sequences are per publisher, the filtered out tag counts */
+    EXPECT_EQ(vector<uint32_t>({ 0, 0, 1, 0 }), missed);
+
+    events_deinit_subscriber(hsub);
+    zmq_close(mock_pub);
+    zmq_ctx_term(zmq_ctx);
+    zmq_ctx = NULL;
+}
+
+/*
+ * Publisher throughput, one event per call and in batches. Events are
+ * dropped when no subscriber is connected, so this measures the cost on
+ * the publishing side.
+ */
+TEST(events, publish_benchmark)
+{
+    const int count = 20000;
+    const int batch_size = 100;
+    vector<event_publish_entry_t> events;
+
+    for (int i = 0; i < batch_size; ++i) {
+        event_publish_entry_t e;
+
+        e.tag = "if-state";
+        e.params["ifname"] = "Ethernet" + to_string(i * 4);
+        e.params["status"] = "down";
+        events.push_back(e);
+    }
+
+    zmq_ctx = zmq_ctx_new();
+    thread thr(&pub_serve_commands);
+
+    event_handle_t h = events_init_publisher("sonic-events-bench");
+    EXPECT_TRUE(NULL != h);
+
+    /* First publish waits for the service echo */
+    EXPECT_EQ(0, event_publish(h, "warmup"));
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < count; ++i) {
+        const auto &e = events[i % batch_size];
+        EXPECT_EQ(0, event_publish(h, e.tag, &e.params));
+    }
+    auto single = chrono::steady_clock::now() - start;
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < count; i += batch_size) {
+        EXPECT_EQ(0, event_publish_batch(h, events));
+    }
+    auto batched = chrono::steady_clock::now() - start;
+
+    auto rate = [count](chrono::steady_clock::duration d) {
+        return (long long)(count * 1000000LL / max<long long>(1,
+                    chrono::duration_cast<chrono::microseconds>(d).count()));
+    };
+    cout << "event publish x " << count << ": single " << rate(single)
+         << " events/s, batch of " << batch_size << " " << rate(batched)
+         << " events/s" << endl;
+
+    terminate_svc = true;
+    thr.join();
+
+    events_deinit_publisher(h);
+    zmq_ctx_term(zmq_ctx);
+    zmq_ctx = NULL;
+}
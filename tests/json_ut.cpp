@@ -1,4 +1,7 @@
+#include <chrono>
+#include <iostream>
 #include <nlohmann/json.hpp>
+#include "common/json.h"
 #include "common/producertable.h"
 #include "gtest/gtest.h"
 
@@ -75,3 +78,95 @@ TEST(JSON, test)
     }
     file.close();
 }
+
+// Reference implementation, the nlohmann::json path the fast path replaces.
+static string buildJsonReference(const vector<FieldValueTuple> &fv)
+{
+    json j = json::array();
+    for (const auto &i : fv)
+    {
+        j.push_back(fvField(i));
+        j.push_back(fvValue(i));
+    }
+
+    return j.dump();
+}
+
+static void readJsonReference(const string &str, vector<FieldValueTuple> &fv)
+{
+    json j = json::parse(str);
+    for (size_t i = 0; i < j.size(); i += 2)
+    {
+        fv.emplace_back(j[i], j[i + 1]);
+    }
+}
+
+TEST(JSON, string_array)
+{
+    vector<vector<FieldValueTuple>> cases = {
+        {},
+        {{"", ""}},
+        {{"fdb_event", "[{\"fdb_entry\":\"{\\\"mac\\\":\\\"00:11:22:33:44:55\\\"}\"}]"}},
+        {{"ctrl", string("\x01\x1f\b\f\n\r\t\x7f", 8)}, {"slash/", "back\\slash"}},
+        {{"utf8", "caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80"}},
+    };
+
+    for (const auto &fv : cases)
+    {
+        string str = JSon::buildJson(fv);
+        EXPECT_EQ(str, buildJsonReference(fv));
+
+        vector<FieldValueTuple> decoded;
+        JSon::readJson(str, decoded);
+        EXPECT_EQ(decoded, fv);
+    }
+
+    // Input nlohmann::json::dump() doesn't produce, but accepts.
+    vector<FieldValueTuple> decoded;
+    JSon::readJson(" [ \"a\\/\\u00e9\\ud83d\\ude00\" ,\n\"\\u0041\" ] ", decoded);
+    vector<FieldValueTuple> expected{{"a/\xc3\xa9\xf0\x9f\x98\x80", "A"}};
+    EXPECT_EQ(decoded, expected);
+
+    // Anything else takes the nlohmann::json path, with its errors.
+    EXPECT_THROW(JSon::readJson("[\"a\", 1]", decoded), json::exception);
+    EXPECT_THROW(JSon::readJson("[\"a\"]", decoded), json::exception);
+    EXPECT_THROW(JSon::readJson("[\"a\",\"b\"", decoded), json::exception);
+    EXPECT_THROW(JSon::readJson("[\"\\ud800\",\"b\"]", decoded), json::exception);
+    EXPECT_THROW(JSon::buildJson(vector<FieldValueTuple>{{"\xff", ""}}), json::exception);
+
+    const char *values[] = {"op", "da\"ta", nullptr};
+    EXPECT_EQ(JSon::buildJson(values), "[\"op\",\"da\\\"ta\"]");
+}
+
+TEST(JSON, string_array_benchmark)
+{
+    // A port state notification, the shape of a notification storm.
+    vector<FieldValueTuple> fv{
+        {"port_state_change", "[{\"port_id\":\"oid:0x100000000037a\",\"port_state\":\"SAI_PORT_OPER_STATUS_UP\"}]"},
+        {"timestamp", "2024-01-01.00:00:00.000000"}};
+
+    const int iterations = 20000;
+    string str = JSon::buildJson(fv);
+    vector<FieldValueTuple> decoded;
+
+    auto start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        decoded.clear();
+        readJsonReference(buildJsonReference(fv), decoded);
+    }
+    auto reference = chrono::steady_clock::now() - start;
+
+    start = chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        decoded.clear();
+        JSon::readJson(JSon::buildJson(fv), decoded);
+    }
+    auto fast = chrono::steady_clock::now() - start;
+
+    EXPECT_EQ(decoded, fv);
+    cout << "JSon build+read of " << str.size() << " bytes x " << iterations
+         << ": nlohmann::json " << chrono::duration_cast<chrono::microseconds>(reference).count()
+         << " us, fast path " << chrono::duration_cast<chrono::microseconds>(fast).count() << " us" << endl;
+}
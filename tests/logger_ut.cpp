@@ -95,3 +95,115 @@ TEST(LOGGER, CustomLogObserver)
     cout << "Checking log level for table1." << endl;
     checkLoglevel(db, key1, "DEBUG");
 }
+
+static void logStorm(int i)
+{
+    SWSS_LOG_ERROR_RATELIMITED("storm %d", i);
+}
+
+static vector<string> captureLines(const function<void ()> &log)
+{
+    Logger::swssOutputNotify("", "STDOUT");
+    testing::internal::CaptureStdout();
+    log();
+    fflush(stdout);
+    string out = testing::internal::GetCapturedStdout();
+    Logger::swssOutputNotify("", "SYSLOG");
+
+    vector<string> lines;
+    istringstream ss(out);
+    for (string line; getline(ss, line);)
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+TEST(LOGGER, RateLimit)
+{
+    Logger::setRateLimit(10, 5);
+
+    // The burst passes, the rest is counted.
+    auto lines = captureLines([]() {
+        for (int i = 0; i < 1000; i++)
+        {
+            logStorm(i);
+        }
+    });
+    ASSERT_EQ(5u, lines.size());
+    EXPECT_EQ(" ERROR:- logStorm: storm 4", lines[4]);
+
+    // Refilled at 10 per second, the next message carries the count.
+    usleep(250000);
+    lines = captureLines([]() {
+        logStorm(1000);
+        logStorm(1001);
+    });
+    ASSERT_EQ(2u, lines.size());
+    EXPECT_EQ(" ERROR:- logStorm: storm 1000 (995 similar messages suppressed)", lines[0]);
+    EXPECT_EQ(" ERROR:- logStorm: storm 1001", lines[1]);
+
+    // Or the periodic summary.
+    lines = captureLines([]() {
+        for (int i = 0; i < 100; i++)
+        {
+            logStorm(i);
+        }
+        Logger::reportSuppressed();
+        Logger::reportSuppressed();
+    });
+    ASSERT_LE(1u, lines.size());
+    EXPECT_NE(string::npos, lines.back().find("messages suppressed at line"));
+    EXPECT_EQ(0u, lines.back().find(" ERROR:- logStorm: "));
+
+    // Filtered messages take no tokens.
+    lines = captureLines([]() {
+        usleep(600000);
+        for (int i = 0; i < 100; i++)
+        {
+            SWSS_LOG_DEBUG_RATELIMITED("filtered %d", i);
+        }
+        for (int i = 0; i < 10; i++)
+        {
+            logStorm(i);
+        }
+    });
+    EXPECT_EQ(5u, lines.size());
+
+    // No limit.
+    Logger::setRateLimit(0, 0);
+    lines = captureLines([]() {
+        for (int i = 0; i < 100; i++)
+        {
+            logStorm(i);
+        }
+    });
+    EXPECT_EQ(100u, lines.size());
+
+    Logger::setRateLimit(Logger::DEFAULT_LOG_RATE, Logger::DEFAULT_LOG_BURST);
+}
+
+TEST(LOGGER, RateLimitConfig)
+{
+    DBConnector db("CONFIG_DB", 0);
+    clearConfigDB();
+
+    string key = "ratelimit";
+    swss::Table table(&db, CFG_LOGGER_TABLE_NAME);
+    table.hset(key, DAEMON_LOGRATE, "50");
+    Logger::linkToDbNative(key);
+
+    auto& logger = Logger::getInstance();
+    EXPECT_EQ(50u, logger.m_logRate.load());
+    EXPECT_EQ(Logger::DEFAULT_LOG_BURST, logger.m_logBurst.load());
+
+    table.hset(key, DAEMON_LOGBURST, "20");
+    table.hset(key, DAEMON_LOGRATE, "bad");
+
+    sleep(1);
+
+    EXPECT_EQ(50u, logger.m_logRate.load());
+    EXPECT_EQ(20u, logger.m_logBurst.load());
+
+    Logger::setRateLimit(Logger::DEFAULT_LOG_RATE, Logger::DEFAULT_LOG_BURST);
+}
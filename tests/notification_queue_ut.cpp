@@ -1,8 +1,11 @@
 // Unit tests for the NotificationQueueBase strategy classes:
 //   FifoNotificationQueue     -- verifies strict arrival-order preservation
 //   LruDedupNotificationQueue -- verifies LRU dedup semantics
+//   KeyedDedupNotificationQueue -- verifies keyed replace-in-place semantics
 //   peekOp                    -- verifies the op-extraction helper
 //                                that drives setOpAllowList admission
+//   unpackNotificationBatch   -- verifies the split of batch messages
+//   readNotificationStreamReply -- verifies the parse of XREAD replies
 //
 // These tests are pure in-memory; they do NOT require a running redis-server.
 // End-to-end coverage of setOpAllowList filtering (which needs a real
@@ -11,11 +14,17 @@
 
 #include <gtest/gtest.h>
 
+#include <deque>
+
 #include "common/notificationconsumer.h"
+#include "common/notificationproducer.h"
 
 using swss::FifoNotificationQueue;
 using swss::LruDedupNotificationQueue;
+using swss::KeyedDedupNotificationQueue;
 using swss::peekOp;
+using swss::unpackNotificationBatch;
+using swss::readNotificationStreamReply;
 
 // ---------------------------------------------------------------------------
 // FifoNotificationQueue tests
@@ -199,6 +208,82 @@ TEST(LruDedupNotificationQueue, MaybeLogStatsCounterGateAndEmission)
     EXPECT_EQ(s2.dedup_hits, 0u);
 }
 
+// ---------------------------------------------------------------------------
+// KeyedDedupNotificationQueue tests
+// ---------------------------------------------------------------------------
+
+// Key is the text before the first ':'.
+static std::string prefixKey(const std::string &msg)
+{
+    return msg.substr(0, msg.find(':'));
+}
+
+TEST(KeyedDedupNotificationQueue, NewerPayloadKeepsSlot)
+{
+    KeyedDedupNotificationQueue q(prefixKey, "test");
+
+    // Arrival: a:1, b:1, a:2, c:1, a:3
+    q.push("a:1");        // [a:1]
+    q.push("b:1");        // [a:1, b:1]
+    q.push("a:2");        // [a:2, b:1]        (replaced in place)
+    q.push("c:1");        // [a:2, b:1, c:1]
+    q.push("a:3");        // [a:3, b:1, c:1]
+
+    EXPECT_EQ(q.size(), 3u);
+    EXPECT_EQ(q.front(), "a:3"); q.pop();
+    EXPECT_EQ(q.front(), "b:1"); q.pop();
+
+    // A popped key starts a new slot at the tail.
+    q.push("a:4");        // [c:1, a:4]
+    EXPECT_EQ(q.front(), "c:1"); q.pop();
+    EXPECT_EQ(q.front(), "a:4"); q.pop();
+    EXPECT_TRUE(q.empty());
+
+    auto s = q.getStats();
+    EXPECT_EQ(s.pushed, 6u);
+    EXPECT_EQ(s.dedup_hits, 2u);
+    EXPECT_EQ(s.high_watermark, 3u);
+    EXPECT_EQ(s.current_depth, 0u);
+}
+
+TEST(KeyedDedupNotificationQueue, EmptyKeyIsNeverDeduped)
+{
+    KeyedDedupNotificationQueue q([](const std::string &) { return std::string(); });
+    q.push("x");
+    q.push("x");
+
+    EXPECT_EQ(q.size(), 2u);
+    EXPECT_EQ(q.getStats().dedup_hits, 0u);
+    q.pop();
+    q.pop();
+    q.pop();   // defensive no-op on empty
+    EXPECT_TRUE(q.empty());
+    EXPECT_EQ(q.getStats().current_depth, 0u);
+}
+
+TEST(KeyedDedupNotificationQueue, DepthBoundedByLiveObjects)
+{
+    // Port state storm: 16 ports flapping with a changing timestamp.
+    KeyedDedupNotificationQueue q(swss::notificationOpDataKey, "test");
+    for (int i = 0; i < 4096; i++)
+    {
+        q.push("[\"port_state_change\",\"oid:" + std::to_string(i % 16) +
+               "\",\"timestamp\",\"" + std::to_string(i) + "\"]");
+    }
+
+    EXPECT_EQ(q.size(), 16u);
+    EXPECT_EQ(q.getStats().high_watermark, 16u);
+    EXPECT_EQ(q.front(), "[\"port_state_change\",\"oid:0\",\"timestamp\",\"4080\"]");
+}
+
+TEST(NotificationOpDataKey, ExtractsOpAndData)
+{
+    EXPECT_EQ(swss::notificationOpDataKey("[\"op\",\"data\",\"f\",\"v\"]"), std::string("op\0data", 7));
+    EXPECT_EQ(swss::notificationOpDataKey("[\"op\",\"da\\\"ta\"]"), std::string("op\0da\"ta", 8));
+    EXPECT_EQ(swss::notificationOpDataKey("[\"op\"]"), "");
+    EXPECT_EQ(swss::notificationOpDataKey("not_json"), "");
+}
+
 // ---------------------------------------------------------------------------
 // peekOp tests
 //
@@ -254,12 +339,141 @@ TEST(PeekOp, NonArrayInputsReturnEmpty)
     EXPECT_EQ(peekOp(" [\"SET\",\"x\"]"),    "");   // leading space breaks the prefix
 }
 
-TEST(PeekOp, DoesNotUnescape)
+TEST(PeekOp, Unescapes)
+{
+    // peekOp decodes the op like JSon::readJson would, so an escaped quote
+    // doesn't end it early.
+    EXPECT_EQ(peekOp("[\"\\\"OP\",\"x\"]"), "\"OP");
+    EXPECT_EQ(peekOp("[\"a\\\\b\\u0041\",\"x\"]"), "a\\bA");
+
+    // Malformed escapes fall back to the raw bytes up to the next quote.
+    EXPECT_EQ(peekOp("[\"bad\\q\",\"x\"]"), "bad\\q");
+}
+
+// ---------------------------------------------------------------------------
+// unpackNotificationBatch tests
+// ---------------------------------------------------------------------------
+
+TEST(NotificationBatch, RoundTrip)
+{
+    // Brackets, quotes and backslashes inside strings must not confuse the
+    // scanner.
+    std::vector<swss::KeyOpFieldsValuesTuple> notifications{
+        swss::KeyOpFieldsValuesTuple{"oid:0x1", "fdb_event", {{"f", "v"}}},
+        swss::KeyOpFieldsValuesTuple{"[x]\\\"]", "port_state", {}},
+        swss::KeyOpFieldsValuesTuple{"", "flush", {{"]", "["}}}};
+
+    std::string batch = swss::NotificationProducer::buildBatch(notifications.begin(), notifications.end());
+
+    std::vector<std::string> unpacked;
+    ASSERT_TRUE(unpackNotificationBatch(batch, unpacked));
+    ASSERT_EQ(unpacked.size(), 3u);
+    EXPECT_EQ(unpacked[0], "[\"fdb_event\",\"oid:0x1\",\"f\",\"v\"]");
+    EXPECT_EQ(peekOp(unpacked[1]), "port_state");
+    EXPECT_EQ(peekOp(unpacked[2]), "flush");
+
+    std::vector<swss::FieldValueTuple> values;
+    swss::JSon::readJson(unpacked[1], values);
+    ASSERT_EQ(values.size(), 1u);
+    EXPECT_EQ(fvValue(values[0]), "[x]\\\"]");
+}
+
+TEST(NotificationBatch, PlainMessageIsNotABatch)
+{
+    std::vector<std::string> unpacked;
+    EXPECT_FALSE(unpackNotificationBatch("[\"SET\",\"key\"]", unpacked));
+    EXPECT_FALSE(unpackNotificationBatch("", unpacked));
+    EXPECT_TRUE(unpacked.empty());
+}
+
+TEST(NotificationBatch, MalformedBatchThrows)
+{
+    std::vector<std::string> unpacked;
+    EXPECT_THROW(unpackNotificationBatch("[[\"a\"]", unpacked), std::runtime_error);
+    EXPECT_THROW(unpackNotificationBatch("[[\"a\"],]", unpacked), std::runtime_error);
+    EXPECT_THROW(unpackNotificationBatch("[[\"a]", unpacked), std::runtime_error);
+    EXPECT_THROW(unpackNotificationBatch("[[\"a\"]x", unpacked), std::runtime_error);
+    EXPECT_TRUE(unpacked.empty());
+}
+
+// ---------------------------------------------------------------------------
+// readNotificationStreamReply tests
+// ---------------------------------------------------------------------------
+
+namespace {
+
+// Owns a hand-built reply tree, as hiredis would return it.
+struct ReplyBuilder
+{
+    std::deque<redisReply> replies;
+    std::deque<std::vector<redisReply*>> arrays;
+    std::deque<std::string> strings;
+
+    redisReply *str(const std::string &value)
+    {
+        strings.push_back(value);
+        replies.emplace_back();
+        redisReply *r = &replies.back();
+        r->type = REDIS_REPLY_STRING;
+        r->str = &strings.back()[0];
+        r->len = strings.back().size();
+        return r;
+    }
+
+    redisReply *nil()
+    {
+        replies.emplace_back();
+        replies.back().type = REDIS_REPLY_NIL;
+        return &replies.back();
+    }
+
+    redisReply *array(std::vector<redisReply*> elements)
+    {
+        arrays.push_back(std::move(elements));
+        replies.emplace_back();
+        redisReply *r = &replies.back();
+        r->type = REDIS_REPLY_ARRAY;
+        r->elements = arrays.back().size();
+        r->element = arrays.back().data();
+        return r;
+    }
+};
+
+} // namespace
+
+TEST(NotificationStreamReply, ReadsEntries)
+{
+    ReplyBuilder b;
+    redisReply *reply = b.array({
+        b.array({b.str("NOTIFICATIONS"), b.array({
+            b.array({b.str("1-0"), b.array({b.str("msg"), b.str("[\"a\",\"1\"]")})}),
+            b.array({b.str("1-1"), b.array({b.str("other"), b.str("x")})}),
+            b.array({b.str("2-0"), b.nil()}),
+            b.array({b.str("3-0"), b.array({b.str("other"), b.str("x"), b.str("msg"), b.str("[\"b\",\"2\"]")})}),
+        })}),
+    });
+
+    std::vector<std::string> msgs;
+    std::string lastId = "$";
+    readNotificationStreamReply(reply, msgs, lastId);
+    EXPECT_EQ(msgs, (std::vector<std::string>{"[\"a\",\"1\"]", "[\"b\",\"2\"]"}));
+    EXPECT_EQ(lastId, "3-0");
+
+    // Timed out read.
+    msgs.clear();
+    readNotificationStreamReply(b.nil(), msgs, lastId);
+    EXPECT_TRUE(msgs.empty());
+    EXPECT_EQ(lastId, "3-0");
+}
+
+TEST(NotificationStreamReply, MalformedReplyThrows)
 {
-    // Documented limitation: peekOp stops at the first '"', so a
-    // backslash-escaped quote inside the op string is not interpreted.
-    // This matches the producer side (NotificationProducer never emits
-    // ops containing quotes), but pin the behavior down so a change is
-    // caught.
-    EXPECT_EQ(peekOp("[\"\\\"OP\",\"x\"]"), "\\");   // sees the literal backslash, stops at the next "
+    ReplyBuilder b;
+    std::vector<std::string> msgs;
+    std::string lastId;
+    EXPECT_THROW(readNotificationStreamReply(b.str("x"), msgs, lastId), std::runtime_error);
+    EXPECT_THROW(readNotificationStreamReply(b.array({b.array({b.str("s")})}), msgs, lastId), std::runtime_error);
+    EXPECT_THROW(readNotificationStreamReply(b.array({b.array({b.str("s"), b.array({b.str("1-0")})})}), msgs, lastId),
+                 std::runtime_error);
+    EXPECT_TRUE(msgs.empty());
 }
@@ -423,3 +423,234 @@ TEST(Notifications, ConsumerMaybeLogStatsCounterGate)
     EXPECT_EQ(stats.received, (uint64_t)kCount);
     EXPECT_EQ(stats.dropped_allowlist, 0u);
 }
+
+TEST(Notifications, batch)
+{
+    SWSS_LOG_ENTER();
+
+    swss::DBConnector dbNtf("ASIC_DB", 0, true);
+    swss::NotificationConsumer nc(&dbNtf, "NOTIFICATIONS", 100, (size_t)messages);
+    swss::NotificationProducer notifications(&dbNtf, "NOTIFICATIONS");
+    notifications.setBatchingEnabled(true);
+
+    std::vector<swss::KeyOpFieldsValuesTuple> batch;
+    for (int i = 0; i < messages; i++)
+    {
+        batch.emplace_back(std::to_string(i + 1), "ntf", std::vector<swss::FieldValueTuple>{{"f", "v"}});
+    }
+    EXPECT_EQ(notifications.send(batch), 1);
+
+    std::deque<swss::KeyOpFieldsValuesTuple> vkco;
+    size_t popped = 0;
+    while (nc.peek() > 0 && popped < (size_t)messages)
+    {
+        nc.pops(vkco);
+        for (auto &kco : vkco)
+        {
+            popped++;
+            EXPECT_EQ(kfvOp(kco), "ntf");
+            EXPECT_EQ(kfvKey(kco), std::to_string(popped));
+            EXPECT_EQ(kfvFieldsValues(kco).size(), 1u);
+        }
+    }
+    EXPECT_EQ(popped, (size_t)messages);
+
+    // One PUBLISH per MAX_BATCH_SIZE notifications.
+    auto stats = nc.getStats();
+    EXPECT_EQ(stats.received, (uint64_t)messages);
+    EXPECT_EQ(stats.batches, (messages + swss::NotificationProducer::MAX_BATCH_SIZE - 1) / swss::NotificationProducer::MAX_BATCH_SIZE);
+}
+
+TEST(Notifications, KeyedDedup)
+{
+    SWSS_LOG_ENTER();
+
+    const std::string kChannel = "KEYEDDEDUP_TEST_NOTIFICATIONS";
+    swss::DBConnector dbNtf("ASIC_DB", 0, true);
+    swss::NotificationConsumer nc(&dbNtf, kChannel, 100, (size_t)64,
+                                  swss::NotificationQueuePolicy::KeyedDedup);
+    ASSERT_NE(nc.getKeyedDedupQueue(), nullptr);
+    EXPECT_EQ(nc.getLruDedupQueue(), nullptr);
+    nc.setStatsLabel("UnitTest:KeyedDedup");
+
+    // One batch, so every notification is queued before the first pop.
+    swss::NotificationProducer producer(&dbNtf, kChannel);
+    producer.setBatchingEnabled(true);
+    std::vector<swss::KeyOpFieldsValuesTuple> notifications;
+    for (int i = 0; i < 100; i++)
+    {
+        notifications.emplace_back("oid:" + std::to_string(i % 4), "port_state_change",
+                                   std::vector<swss::FieldValueTuple>{{"timestamp", std::to_string(i)}});
+    }
+    ASSERT_EQ(producer.send(notifications), 1);
+
+    std::deque<swss::KeyOpFieldsValuesTuple> vkco;
+    for (int i = 0; i < 100 && nc.peek() <= 0; i++)
+    {
+        usleep(10 * 1000);
+    }
+    nc.pops(vkco);
+
+    // The latest payload per object, in first-seen order.
+    ASSERT_EQ(vkco.size(), 4u);
+    for (int i = 0; i < 4; i++)
+    {
+        EXPECT_EQ(kfvKey(vkco[i]), "oid:" + std::to_string(i));
+        EXPECT_EQ(fvValue(kfvFieldsValues(vkco[i])[0]), std::to_string(96 + i));
+    }
+
+    auto stats = nc.getKeyedDedupQueue()->getStats();
+    EXPECT_EQ(stats.pushed, 100u);
+    EXPECT_EQ(stats.dedup_hits, 96u);
+    EXPECT_EQ(stats.high_watermark, 4u);
+}
+
+static size_t popStream(swss::NotificationConsumer &nc, std::deque<swss::KeyOpFieldsValuesTuple> &all, size_t expected)
+{
+    swss::Select s;
+    s.addSelectable(&nc);
+
+    while (all.size() < expected)
+    {
+        swss::Selectable *sel;
+        if (s.select(&sel, 1000) != swss::Select::OBJECT)
+        {
+            break;
+        }
+
+        std::deque<swss::KeyOpFieldsValuesTuple> vkco;
+        nc.pops(vkco);
+        all.insert(all.end(), vkco.begin(), vkco.end());
+    }
+
+    return all.size();
+}
+
+TEST(Notifications, stream)
+{
+    SWSS_LOG_ENTER();
+
+    const std::string kChannel = "STREAM_TEST_NOTIFICATIONS";
+    swss::DBConnector dbNtf("ASIC_DB", 0, true);
+    dbNtf.del(kChannel);
+
+    swss::NotificationProducer producer(&dbNtf, kChannel, swss::NotificationTransport::Stream);
+    std::vector<swss::FieldValueTuple> values{{"f", "v"}};
+
+    std::string lastId;
+    {
+        swss::NotificationStreamOptions options;
+        swss::NotificationConsumer nc(&dbNtf, kChannel, 100, 256, swss::NotificationQueuePolicy::Fifo, options);
+
+        for (int i = 0; i < messages; i++)
+        {
+            EXPECT_EQ(producer.send("ntf", std::to_string(i + 1), values), -1);
+        }
+
+        std::deque<swss::KeyOpFieldsValuesTuple> all;
+        ASSERT_EQ(popStream(nc, all, messages), (size_t)messages);
+        for (int i = 0; i < messages; i++)
+        {
+            EXPECT_EQ(kfvOp(all[i]), "ntf");
+            EXPECT_EQ(kfvKey(all[i]), std::to_string(i + 1));
+            EXPECT_EQ(kfvFieldsValues(all[i]), values);
+        }
+
+        lastId = nc.getStreamId();
+        EXPECT_FALSE(lastId.empty());
+    }
+
+    // Sent while no consumer runs, a restarted one resumes after lastId.
+    std::vector<swss::KeyOpFieldsValuesTuple> batch;
+    for (int i = 0; i < 10; i++)
+    {
+        batch.emplace_back(std::to_string(i + 1), "later", values);
+    }
+    EXPECT_EQ(producer.send(batch), -1);
+
+    swss::NotificationStreamOptions options;
+    options.startId = lastId;
+    swss::NotificationConsumer nc(&dbNtf, kChannel, 100, 256, swss::NotificationQueuePolicy::Fifo, options);
+
+    std::deque<swss::KeyOpFieldsValuesTuple> all;
+    ASSERT_EQ(popStream(nc, all, 10), 10u);
+    EXPECT_EQ(kfvOp(all.front()), "later");
+    EXPECT_EQ(kfvKey(all.back()), "10");
+    EXPECT_EQ(nc.getStats().batches, 1u);
+
+    dbNtf.del(kChannel);
+}
+
+TEST(Notifications, streamGroup)
+{
+    SWSS_LOG_ENTER();
+
+    const std::string kChannel = "STREAM_GROUP_TEST_NOTIFICATIONS";
+    swss::DBConnector dbNtf("ASIC_DB", 0, true);
+    dbNtf.del(kChannel);
+
+    swss::NotificationProducer producer(&dbNtf, kChannel, swss::NotificationTransport::Stream, 100);
+    std::vector<swss::FieldValueTuple> values;
+
+    swss::NotificationStreamOptions options;
+    options.group = "ntf_ut";
+    options.count = 8;
+    {
+        swss::NotificationConsumer nc(&dbNtf, kChannel, 100, 256, swss::NotificationQueuePolicy::Fifo, options);
+        producer.send("ntf", "1", values);
+
+        std::deque<swss::KeyOpFieldsValuesTuple> all;
+        ASSERT_EQ(popStream(nc, all, 1), 1u);
+        EXPECT_EQ(kfvKey(all[0]), "1");
+    }
+
+    // The group remembers what was read, only the new entries arrive.
+    for (int i = 2; i <= 50; i++)
+    {
+        producer.send("ntf", std::to_string(i), values);
+    }
+
+    swss::NotificationConsumer nc(&dbNtf, kChannel, 100, 256, swss::NotificationQueuePolicy::Fifo, options);
+    std::deque<swss::KeyOpFieldsValuesTuple> all;
+    ASSERT_EQ(popStream(nc, all, 49), 49u);
+    EXPECT_EQ(kfvKey(all.front()), "2");
+    EXPECT_EQ(kfvKey(all.back()), "50");
+
+    dbNtf.del(kChannel);
+}
+
+TEST(Notifications, streamGroupDeleted)
+{
+    SWSS_LOG_ENTER();
+
+    const std::string kChannel = "STREAM_GROUP_DELETED_TEST_NOTIFICATIONS";
+    swss::DBConnector dbNtf("ASIC_DB", 0, true);
+    dbNtf.del(kChannel);
+
+    swss::NotificationProducer producer(&dbNtf, kChannel, swss::NotificationTransport::Stream);
+    std::vector<swss::FieldValueTuple> values;
+
+    swss::NotificationStreamOptions options;
+    options.group = "ntf_ut";
+    swss::NotificationConsumer nc(&dbNtf, kChannel, 100, 256, swss::NotificationQueuePolicy::Fifo, options);
+    producer.send("ntf", "1", values);
+
+    std::deque<swss::KeyOpFieldsValuesTuple> all;
+    ASSERT_EQ(popStream(nc, all, 1), 1u);
+
+    // Deleted under the blocked read, which fails right away or, on older
+    // Redis, once the stream is added again. The consumer re-creates the
+    // group and keeps reading, entries added before that may be missed.
+    dbNtf.del(kChannel);
+    all.clear();
+    for (int i = 2; i <= 10 && all.empty(); i++)
+    {
+        producer.send("ntf", std::to_string(i), values);
+        popStream(nc, all, 1);
+    }
+
+    ASSERT_EQ(all.size(), 1u);
+    EXPECT_EQ(kfvOp(all[0]), "ntf");
+
+    dbNtf.del(kChannel);
+}
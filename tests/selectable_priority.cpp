@@ -2,6 +2,7 @@
 #include "common/consumertable.h"
 #include "common/notificationconsumer.h"
 #include "common/select.h"
+#include "common/iouringpoller.h"
 #include "common/selectableevent.h"
 #include "common/selectabletimer.h"
 #include "common/subscriberstatetable.h"
@@ -247,3 +248,67 @@ TEST(Priority, priority_select_6)
     // we gave fair scheduler. we've read different selectables on the second read
     EXPECT_NE(selectcs1, selectcs2);
 }
+
+TEST(Select, io_uring_backend)
+{
+    Select cs(Select::IO_URING);
+    if (!IoUringPoller::isSupported())
+    {
+        // Falls back to epoll when io_uring is not compiled in or not usable.
+        EXPECT_EQ(cs.getBackend(), Select::EPOLL);
+    }
+    else
+    {
+        EXPECT_EQ(cs.getBackend(), Select::IO_URING);
+    }
+
+    Selectable *selectcs;
+    SelectableEvent s1(100);
+    SelectableEvent s2(1000);
+
+    cs.addSelectable(&s1);
+    cs.addSelectable(&s2);
+
+    EXPECT_EQ(cs.select(&selectcs, 10), Select::TIMEOUT);
+
+    s1.notify();
+    s2.notify();
+
+    EXPECT_EQ(cs.select(&selectcs, 1000), Select::OBJECT);
+    EXPECT_EQ(selectcs, &s2);
+    EXPECT_EQ(cs.select(&selectcs, 1000), Select::OBJECT);
+    EXPECT_EQ(selectcs, &s1);
+    EXPECT_EQ(cs.select(&selectcs, 10), Select::TIMEOUT);
+
+    // Data left pending while removed must be reported again once re-added.
+    s1.notify();
+    cs.removeSelectable(&s1);
+    EXPECT_EQ(cs.select(&selectcs, 10), Select::TIMEOUT);
+    cs.addSelectable(&s1);
+    EXPECT_EQ(cs.select(&selectcs, 1000), Select::OBJECT);
+    EXPECT_EQ(selectcs, &s1);
+
+    // Re-added right after it was reported: armed once, reported once.
+    cs.removeSelectable(&s1);
+    cs.addSelectable(&s1);
+    EXPECT_EQ(cs.select(&selectcs, 10), Select::TIMEOUT);
+    s1.notify();
+    EXPECT_EQ(cs.select(&selectcs, 1000), Select::OBJECT);
+    EXPECT_EQ(selectcs, &s1);
+    EXPECT_EQ(cs.select(&selectcs, 10), Select::TIMEOUT);
+    s2.notify();
+    EXPECT_EQ(cs.select(&selectcs, 1000), Select::OBJECT);
+    EXPECT_EQ(selectcs, &s2);
+    EXPECT_EQ(cs.select(&selectcs, 10), Select::TIMEOUT);
+}
+
+TEST(Select, default_backend)
+{
+    auto backend = Select::getDefaultBackend();
+
+    Select::setDefaultBackend(Select::EPOLL);
+    Select cs;
+    EXPECT_EQ(cs.getBackend(), Select::EPOLL);
+
+    Select::setDefaultBackend(backend);
+}
@@ -0,0 +1,157 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "common/shmring.h"
+
+using namespace std;
+using namespace swss;
+
+static bool pushString(ShmRing &ring, const string &message)
+{
+    return ring.push(message.size(), [&message](char *buffer) {
+        memcpy(buffer, message.data(), message.size());
+        return message.size();
+    });
+}
+
+static bool popString(ShmRing &ring, string &message, int timeoutMs = 0)
+{
+    return ring.pop(timeoutMs, [&message](const char *buffer, size_t size) {
+        message.assign(buffer, size);
+    });
+}
+
+TEST(ShmRing, endpoint)
+{
+    EXPECT_TRUE(ShmRing::isShmEndpoint("shm://test"));
+    EXPECT_FALSE(ShmRing::isShmEndpoint("tcp://localhost:1234"));
+    EXPECT_EQ(ShmRing::segmentName("shm://a/b"), "/swss-zmq-a_b");
+}
+
+TEST(ShmRing, push_pop)
+{
+    string name = ShmRing::segmentName("shm://shmring_ut_push_pop");
+    EXPECT_THROW(ShmRing(name, false), runtime_error);
+
+    ShmRing consumer(name, true, 4096);
+    ShmRing producer(name, false);
+    string message;
+
+    EXPECT_FALSE(popString(consumer, message));
+    EXPECT_TRUE(pushString(producer, ""));
+    EXPECT_TRUE(popString(consumer, message));
+    EXPECT_EQ(message, "");
+
+    // Wrap around the ring many times with sizes which don't divide it.
+    for (int i = 0; i < 1000; i++)
+    {
+        string expected(size_t(i % 300), char('a' + i % 26));
+        ASSERT_TRUE(pushString(producer, expected));
+        ASSERT_TRUE(popString(consumer, message));
+        ASSERT_EQ(message, expected);
+    }
+
+    // Full ring, then room again after a pop.
+    string big(1000, 'x');
+    int pushed = 0;
+    while (pushString(producer, big))
+    {
+        pushed++;
+    }
+    EXPECT_GE(pushed, 3);
+    EXPECT_TRUE(popString(consumer, message));
+    EXPECT_TRUE(pushString(producer, big));
+
+    EXPECT_THROW(pushString(producer, string(producer.maxMessageSize() + 1, 'x')), runtime_error);
+    EXPECT_FALSE(producer.isStale());
+}
+
+TEST(ShmRing, corrupted)
+{
+    string name = ShmRing::segmentName("shm://shmring_ut_corrupted");
+    ShmRing consumer(name, true, 4096);
+    ShmRing producer(name, false);
+    string message;
+
+    // Overwrite the length of a published record through another mapping.
+    ASSERT_TRUE(pushString(producer, "corrupt me"));
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+    ASSERT_GE(fd, 0);
+    struct stat st;
+    ASSERT_EQ(fstat(fd, &st), 0);
+    char *mapping = static_cast<char *>(mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    ASSERT_NE(mapping, MAP_FAILED);
+    char *record = static_cast<char *>(memmem(mapping, (size_t)st.st_size, "corrupt me", 10));
+    ASSERT_NE(record, nullptr);
+    uint64_t length = 1 << 20;
+    memcpy(record - sizeof(length), &length, sizeof(length));
+
+    // Dropped without reading past the ring, later messages get through.
+    bool called = false;
+    EXPECT_FALSE(consumer.pop(0, [&called](const char *, size_t) { called = true; }));
+    EXPECT_FALSE(called);
+    EXPECT_TRUE(pushString(producer, "next"));
+    EXPECT_TRUE(popString(consumer, message));
+    EXPECT_EQ(message, "next");
+
+    munmap(mapping, (size_t)st.st_size);
+    close(fd);
+}
+
+TEST(ShmRing, stale)
+{
+    string name = ShmRing::segmentName("shm://shmring_ut_stale");
+    unique_ptr<ShmRing> consumer(new ShmRing(name, true, 4096));
+    ShmRing producer(name, false);
+
+    // A new consumer takes over the name.
+    ShmRing replacement(name, true, 4096);
+    EXPECT_FALSE(producer.isClosed());
+    EXPECT_TRUE(producer.isStale());
+
+    // The old consumer leaves the new one's segment in place.
+    consumer.reset();
+    ShmRing reopened(name, false);
+    EXPECT_FALSE(reopened.isStale());
+}
+
+TEST(ShmRing, cross_process)
+{
+    string name = ShmRing::segmentName("shm://shmring_ut_cross_process");
+    ShmRing consumer(name, true);
+    const int count = 10000;
+
+    pid_t pid = fork();
+    ASSERT_GE(pid, 0);
+    if (pid == 0)
+    {
+        ShmRing producer(name, false);
+        for (int i = 0; i < count; i++)
+        {
+            while (!pushString(producer, to_string(i)))
+            {
+                usleep(100);
+            }
+        }
+        _exit(0);
+    }
+
+    string message;
+    for (int i = 0; i < count; i++)
+    {
+        ASSERT_TRUE(popString(consumer, message, 5000));
+        ASSERT_EQ(message, to_string(i));
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    EXPECT_EQ(status, 0);
+}
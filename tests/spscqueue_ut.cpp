@@ -0,0 +1,86 @@
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "gtest/gtest.h"
+#include "common/spscqueue.h"
+
+using namespace std;
+using namespace swss;
+
+TEST(SpscQueue, push_pop)
+{
+    SpscQueue<string, 4> queue;
+    string item;
+
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.pop(item));
+
+    // Cross several chunk boundaries, reusing drained chunks on the way.
+    for (int round = 0; round < 3; round++)
+    {
+        for (int i = 0; i < 10; i++)
+        {
+            queue.push(to_string(i));
+        }
+        EXPECT_EQ(queue.size(), 10u);
+
+        for (int i = 0; i < 10; i++)
+        {
+            EXPECT_TRUE(queue.pop(item));
+            EXPECT_EQ(item, to_string(i));
+        }
+        EXPECT_FALSE(queue.pop(item));
+        EXPECT_TRUE(queue.empty());
+    }
+}
+
+TEST(SpscQueue, pop_batch)
+{
+    SpscQueue<shared_ptr<int>, 4> queue;
+    for (int i = 0; i < 9; i++)
+    {
+        queue.push(make_shared<int>(i));
+    }
+
+    deque<shared_ptr<int>> out;
+    EXPECT_EQ(queue.popBatch(out, 5), 5u);
+    EXPECT_EQ(queue.popBatch(out, 5), 4u);
+    EXPECT_EQ(queue.popBatch(out, 5), 0u);
+
+    ASSERT_EQ(out.size(), 9u);
+    for (int i = 0; i < 9; i++)
+    {
+        EXPECT_EQ(*out[i], i);
+        // The queue must not keep references to popped items.
+        EXPECT_EQ(out[i].use_count(), 1);
+    }
+}
+
+TEST(SpscQueue, concurrent)
+{
+    const int count = 200000;
+    SpscQueue<int, 64> queue;
+
+    thread producer([&queue, count]() {
+        for (int i = 0; i < count; i++)
+        {
+            queue.push(i);
+        }
+    });
+
+    vector<int> out;
+    out.reserve(count);
+    while ((int)out.size() < count)
+    {
+        queue.popBatch(out, 128);
+    }
+    producer.join();
+
+    for (int i = 0; i < count; i++)
+    {
+        ASSERT_EQ(out[i], i);
+    }
+    EXPECT_TRUE(queue.empty());
+}
@@ -2,6 +2,7 @@
 #include <memory>
 #include <thread>
 #include <algorithm>
+#include <atomic>
 #include <deque>
 #include <csignal>
 #include <unistd.h>
@@ -804,6 +805,167 @@ TEST(ZmqServerLazzyBind, test)
     EXPECT_EQ(received, 1);
 }
 
+static void popAll(ZmqConsumerStateTable &c, std::deque<KeyOpFieldsValuesTuple> &received, size_t expected)
+{
+    Select cs;
+    cs.addSelectable(&c);
+    Selectable *selectcs;
+    for (int i = 0; i < 50 && received.size() < expected; i++)
+    {
+        if (cs.select(&selectcs, 100, true) == Select::OBJECT)
+        {
+            std::deque<KeyOpFieldsValuesTuple> vkco;
+            c.pops(vkco);
+            received.insert(received.end(), vkco.begin(), vkco.end());
+        }
+    }
+}
+
+TEST(ZmqProducerStateTableBatching, coalesce)
+{
+    std::string testTableName = "ZMQ_BATCHING_UT";
+    std::string pushEndpoint = "tcp://localhost:1236";
+    std::string pullEndpoint = "tcp://*:1236";
+
+    DBConnector db(TEST_DB, 0, true);
+    ZmqServer server(pullEndpoint);
+    ZmqConsumerStateTable c(&db, testTableName, server);
+
+    ZmqClient client(pushEndpoint);
+    client.setWireFormatVersion(2);
+    ZmqProducerStateTable p(&db, testTableName, client, false);
+    p.setBatchingWindow(100, ZmqProducerStateTable::DEFAULT_BATCH_MAX_BYTES, 60000);
+
+    p.set("a", std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "2"}});
+    p.set("b", std::vector<FieldValueTuple>{{"f1", "1"}});
+    p.set("a", std::vector<FieldValueTuple>{{"f2", "3"}, {"f3", "4"}});
+    p.del("b");
+    p.set("b", std::vector<FieldValueTuple>{{"f1", "5"}});
+    p.del("c");
+    p.del("c");
+    // Ops other than the pending one are not merged into it.
+    p.set("d", std::vector<FieldValueTuple>{{"f1", "1"}}, HSET_COMMAND);
+    p.set("d", std::vector<FieldValueTuple>{{"f2", "2"}}, HSET_COMMAND);
+    p.set("d", std::vector<FieldValueTuple>{{"f3", "3"}});
+    p.set("e", std::vector<FieldValueTuple>{});
+    EXPECT_EQ(p.m_batch.size(), 8u);
+    p.flush();
+
+    std::deque<KeyOpFieldsValuesTuple> received;
+    popAll(c, received, 8);
+    ASSERT_EQ(received.size(), 8u);
+
+    EXPECT_EQ(kfvKey(received[0]), "a");
+    EXPECT_EQ(kfvOp(received[0]), SET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(received[0]),
+              (std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "3"}, {"f3", "4"}}));
+    EXPECT_EQ(kfvKey(received[1]), "b");
+    EXPECT_EQ(kfvOp(received[1]), SET_COMMAND);
+    EXPECT_EQ(kfvKey(received[2]), "b");
+    EXPECT_EQ(kfvOp(received[2]), DEL_COMMAND);
+    EXPECT_EQ(kfvKey(received[3]), "b");
+    EXPECT_EQ(kfvOp(received[3]), SET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(received[3]), (std::vector<FieldValueTuple>{{"f1", "5"}}));
+    EXPECT_EQ(kfvKey(received[4]), "c");
+    EXPECT_EQ(kfvOp(received[4]), DEL_COMMAND);
+    EXPECT_EQ(kfvKey(received[5]), "d");
+    EXPECT_EQ(kfvOp(received[5]), HSET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(received[5]), (std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "2"}}));
+    EXPECT_EQ(kfvKey(received[6]), "d");
+    EXPECT_EQ(kfvOp(received[6]), SET_COMMAND);
+    EXPECT_EQ(kfvKey(received[7]), "e");
+    EXPECT_EQ(kfvOp(received[7]), SET_COMMAND);
+    EXPECT_TRUE(kfvFieldsValues(received[7]).empty());
+}
+
+TEST(ZmqProducerStateTableBatching, thresholds)
+{
+    std::string testTableName = "ZMQ_BATCHING_UT";
+    std::string pushEndpoint = "tcp://localhost:1236";
+    std::string pullEndpoint = "tcp://*:1236";
+
+    DBConnector db(TEST_DB, 0, true);
+    ZmqServer server(pullEndpoint);
+    ZmqConsumerStateTable c(&db, testTableName, server);
+
+    ZmqClient client(pushEndpoint);
+    ZmqProducerStateTable p(&db, testTableName, client, false);
+
+    // Count threshold sends without waiting for the window to expire.
+    p.setBatchingWindow(2, ZmqProducerStateTable::DEFAULT_BATCH_MAX_BYTES, 60000);
+    p.set("k1", std::vector<FieldValueTuple>{{"f", "v"}});
+    p.set("k2", std::vector<FieldValueTuple>{{"f", "v"}});
+    EXPECT_TRUE(p.m_batch.empty());
+
+    std::deque<KeyOpFieldsValuesTuple> received;
+    popAll(c, received, 2);
+    EXPECT_EQ(received.size(), 2u);
+
+    // Time threshold sends a partial batch.
+    p.setBatchingWindow(100, ZmqProducerStateTable::DEFAULT_BATCH_MAX_BYTES, 10);
+    p.set("k3", std::vector<FieldValueTuple>{{"f", "v"}});
+
+    received.clear();
+    popAll(c, received, 1);
+    ASSERT_EQ(received.size(), 1u);
+    EXPECT_EQ(kfvKey(received[0]), "k3");
+}
+
+TEST(ZmqConsumerStateTableKeyCoalescing, test)
+{
+    std::string testTableName = "ZMQ_COALESCING_UT";
+    std::string pushEndpoint = "tcp://localhost:1237";
+    std::string pullEndpoint = "tcp://*:1237";
+
+    DBConnector db(TEST_DB, 0, true);
+    ZmqServer server(pullEndpoint);
+    ZmqConsumerStateTable c(&db, testTableName, server);
+    c.setKeyCoalescing(true);
+
+    ZmqClient client(pushEndpoint);
+    ZmqProducerStateTable p(&db, testTableName, client, false);
+
+    std::vector<KeyOpFieldsValuesTuple> kcos = {
+        KeyOpFieldsValuesTuple{"a", SET_COMMAND, std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "2"}}},
+        KeyOpFieldsValuesTuple{"b", SET_COMMAND, std::vector<FieldValueTuple>{{"f1", "1"}}},
+        KeyOpFieldsValuesTuple{"a", SET_COMMAND, std::vector<FieldValueTuple>{{"f2", "3"}, {"f3", "4"}}},
+        KeyOpFieldsValuesTuple{"b", DEL_COMMAND, std::vector<FieldValueTuple>{}},
+        KeyOpFieldsValuesTuple{"b", SET_COMMAND, std::vector<FieldValueTuple>{{"f1", "5"}}},
+        KeyOpFieldsValuesTuple{"c", DEL_COMMAND, std::vector<FieldValueTuple>{}},
+        KeyOpFieldsValuesTuple{"c", DEL_COMMAND, std::vector<FieldValueTuple>{}},
+    };
+    p.send(kcos);
+
+    for (int i = 0; i < 50 && c.getCoalescingStats().received < kcos.size(); i++)
+    {
+        usleep(100 * 1000);
+    }
+
+    auto stats = c.getCoalescingStats();
+    EXPECT_EQ(stats.received, 7u);
+    EXPECT_EQ(stats.coalesced, 3u);
+    EXPECT_EQ(stats.pendingKeys, 3u);
+
+    std::deque<KeyOpFieldsValuesTuple> received;
+    popAll(c, received, 4);
+    ASSERT_EQ(received.size(), 4u);
+
+    EXPECT_EQ(kfvKey(received[0]), "a");
+    EXPECT_EQ(kfvOp(received[0]), SET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(received[0]),
+              (std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "3"}, {"f3", "4"}}));
+    EXPECT_EQ(kfvKey(received[1]), "b");
+    EXPECT_EQ(kfvOp(received[1]), DEL_COMMAND);
+    EXPECT_EQ(kfvKey(received[2]), "b");
+    EXPECT_EQ(kfvOp(received[2]), SET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(received[2]), (std::vector<FieldValueTuple>{{"f1", "5"}}));
+    EXPECT_EQ(kfvKey(received[3]), "c");
+    EXPECT_EQ(kfvOp(received[3]), DEL_COMMAND);
+
+    EXPECT_FALSE(c.hasData());
+    EXPECT_EQ(c.getCoalescingStats().pendingKeys, 0u);
+}
+
 // Parameterized test structure for ZmqConsumerStateTablePopSize
 struct PopSizeTestParams
 {
@@ -950,3 +1112,733 @@ TEST(AsyncDBUpdater, SetCommandReplacesKey)
 
     table.del("key");
 }
+
+TEST(AsyncDBUpdaterService, CoalesceBatch)
+{
+    std::deque<std::shared_ptr<KeyOpFieldsValuesTuple>> batch;
+    auto add = [&batch](const std::string &key, const std::string &op, std::vector<FieldValueTuple> values)
+    {
+        batch.push_back(std::make_shared<KeyOpFieldsValuesTuple>(key, op, values));
+    };
+
+    add("a", SET_COMMAND, {{"f1", "1"}, {"f2", "2"}});
+    add("b", HSET_COMMAND, {{"f1", "1"}});
+    add("a", HSET_COMMAND, {{"f2", "3"}, {"f3", "4"}});
+    add("c", DEL_COMMAND, {});
+    add("b", HSET_COMMAND, {{"f2", "2"}});
+    add("c", HSET_COMMAND, {{"f1", "5"}});
+    add("d", SET_COMMAND, {{"f1", "1"}});
+    add("d", DEL_COMMAND, {});
+
+    auto result = AsyncDBUpdaterService::coalesce(batch);
+    ASSERT_EQ(result.size(), 4u);
+
+    EXPECT_EQ(kfvKey(result[0]), "a");
+    EXPECT_EQ(kfvOp(result[0]), SET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(result[0]), (std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "3"}, {"f3", "4"}}));
+
+    EXPECT_EQ(kfvKey(result[1]), "b");
+    EXPECT_EQ(kfvOp(result[1]), HSET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(result[1]), (std::vector<FieldValueTuple>{{"f1", "1"}, {"f2", "2"}}));
+
+    EXPECT_EQ(kfvKey(result[2]), "c");
+    EXPECT_EQ(kfvOp(result[2]), SET_COMMAND);
+    EXPECT_EQ(kfvFieldsValues(result[2]), (std::vector<FieldValueTuple>{{"f1", "5"}}));
+
+    EXPECT_EQ(kfvKey(result[3]), "d");
+    EXPECT_EQ(kfvOp(result[3]), DEL_COMMAND);
+}
+
+// A batch with several operations per key ends up in the same state as
+// applying them one by one.
+TEST(AsyncDBUpdater, BatchedWrites)
+{
+    DBConnector db(TEST_DB, 0, true);
+    Table table(&db, "ASYNC_DB_UPDATER_UT");
+    table.del("key");
+    table.del("other");
+    table.set("key", std::vector<FieldValueTuple>{{"a", "1"}, {"b", "2"}});
+
+    {
+        AsyncDBUpdater updater(&db, "ASYNC_DB_UPDATER_UT");
+        updater.update(std::make_shared<KeyOpFieldsValuesTuple>(
+            "key", DEL_COMMAND, std::vector<FieldValueTuple>{}));
+        updater.update(std::make_shared<KeyOpFieldsValuesTuple>(
+            "key", HSET_COMMAND, std::vector<FieldValueTuple>{{"c", "3"}}));
+        for (int i = 0; i < 100; i++)
+        {
+            updater.update(std::make_shared<KeyOpFieldsValuesTuple>(
+                "other", HSET_COMMAND, std::vector<FieldValueTuple>{{"count", to_string(i)}}));
+        }
+    }
+
+    auto fields = readFields(table, "key");
+    EXPECT_EQ(fields.size(), 1u);
+    EXPECT_EQ(fields["c"], "3");
+    EXPECT_EQ(readFields(table, "other")["count"], "99");
+
+    table.del("key");
+    table.del("other");
+}
+
+// Tables share the workers, and each table's operations stay in order.
+TEST(AsyncDBUpdaterService, SharedWorkers)
+{
+    DBConnector db(TEST_DB, 0, true);
+    AsyncDBUpdaterService service(3);
+
+    const int tableCount = 4;
+    std::vector<std::shared_ptr<AsyncDBUpdaterService::TableQueue>> queues;
+    for (int t = 0; t < tableCount; t++)
+    {
+        Table table(&db, "ASYNC_DB_SERVICE_UT_" + to_string(t));
+        table.del("key");
+        queues.push_back(service.registerTable(&db, "ASYNC_DB_SERVICE_UT_" + to_string(t)));
+    }
+
+    for (int i = 0; i < 100; i++)
+    {
+        for (int t = 0; t < tableCount; t++)
+        {
+            service.update(queues[t], std::make_shared<KeyOpFieldsValuesTuple>(
+                "key", SET_COMMAND, std::vector<FieldValueTuple>{{"value", to_string(i)}}));
+        }
+    }
+    service.flush();
+
+    auto stats = service.getStats();
+    EXPECT_EQ(stats.tables, (size_t)tableCount);
+    EXPECT_EQ(stats.queued, 0u);
+    EXPECT_EQ(stats.inFlight, 0u);
+    EXPECT_EQ(stats.processed, 400u);
+    EXPECT_EQ(stats.failed, 0u);
+
+    for (int t = 0; t < tableCount; t++)
+    {
+        Table table(&db, "ASYNC_DB_SERVICE_UT_" + to_string(t));
+        EXPECT_EQ(readFields(table, "key")["value"], "99");
+        EXPECT_EQ(service.queueSize(*queues[t]), 0u);
+        service.unregisterTable(queues[t]);
+        table.del("key");
+    }
+
+    EXPECT_EQ(service.getStats().tables, 0u);
+}
+
+// A batch which keeps failing is retried, then reported by flush().
+TEST(AsyncDBUpdaterService, WriteFailure)
+{
+    DBConnector db(TEST_DB, 0, true);
+    AsyncDBUpdaterService service(1);
+
+    // No such namespace, every write fails to connect.
+    auto queue = service.registerTable(&db, "ASYNC_DB_SERVICE_UT");
+    queue->dbKey.netns = "no_such_netns";
+    queue->connectionId += "no_such_netns";
+
+    service.update(queue, std::make_shared<KeyOpFieldsValuesTuple>(
+        "key", SET_COMMAND, std::vector<FieldValueTuple>{{"value", "1"}}));
+    EXPECT_FALSE(service.flush(*queue));
+
+    auto stats = service.getStats();
+    EXPECT_EQ(stats.failed, (uint64_t)AsyncDBUpdaterService::MAX_WRITE_RETRY + 1);
+    EXPECT_EQ(stats.lost, 1u);
+    EXPECT_EQ(stats.processed, 1u);
+    EXPECT_EQ(service.queueSize(*queue), 0u);
+
+    // Reported once.
+    EXPECT_FALSE(service.flush());
+    EXPECT_TRUE(service.flush(*queue));
+    EXPECT_TRUE(service.flush());
+
+    service.unregisterTable(queue);
+}
+
+class RecordingHandler : public ZmqMessageHandler
+{
+public:
+    void handleReceivedData(const std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos) override
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_entered = true;
+        m_cv.notify_all();
+        m_cv.wait(lock, [this]() { return !m_block; });
+
+        for (const auto &kco : kcos)
+        {
+            m_keys.push_back(kfvKey(*kco));
+        }
+    }
+
+    void setBlock(bool block)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_block = block;
+        m_cv.notify_all();
+    }
+
+    void waitEntered()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this]() { return m_entered; });
+    }
+
+    std::vector<std::string> keys()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_keys;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_block = false;
+    bool m_entered = false;
+    std::vector<std::string> m_keys;
+};
+
+TEST(ZmqHandlerRegistry, concurrent_dispatch)
+{
+    ZmqHandlerRegistry registry;
+    RecordingHandler a;
+    RecordingHandler b;
+    registry.registerHandler("DB", "TABLE_A", &a);
+    registry.registerHandler("DB", "TABLE_B", &b);
+
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos;
+    kcos.push_back(std::make_shared<KeyOpFieldsValuesTuple>("k", SET_COMMAND, std::vector<FieldValueTuple>{{"f", "v"}}));
+
+    a.setBlock(true);
+    thread dispatchA([&]() { registry.dispatch("DB", "TABLE_A", kcos); });
+    a.waitEntered();
+
+    // A callback in flight into one table does not hold up another table.
+    registry.dispatch("DB", "TABLE_B", kcos);
+    EXPECT_EQ(b.keys().size(), 1u);
+
+    // Removal waits for the in-flight callback to return.
+    std::atomic<bool> removed(false);
+    thread removeA([&]() {
+        registry.removeHandler("DB", "TABLE_A");
+        removed = true;
+    });
+    usleep(100 * 1000);
+    EXPECT_FALSE(removed);
+
+    a.setBlock(false);
+    dispatchA.join();
+    removeA.join();
+    EXPECT_TRUE(removed);
+    EXPECT_EQ(a.keys().size(), 1u);
+
+    registry.dispatch("DB", "TABLE_A", kcos);
+    EXPECT_EQ(a.keys().size(), 1u);
+}
+
+TEST(ZmqServer, decode_threads)
+{
+    const int tableCount = 4;
+    const int messageCount = 200;
+
+    ZmqServer server("tcp://*:1238", "", false, false, 3);
+    RecordingHandler handlers[tableCount];
+    for (int t = 0; t < tableCount; t++)
+    {
+        server.registerMessageHandler("DB", "TABLE_" + to_string(t), &handlers[t]);
+    }
+
+    ZmqClient client("tcp://localhost:1238");
+    for (int i = 0; i < messageCount; i++)
+    {
+        for (int t = 0; t < tableCount; t++)
+        {
+            std::vector<KeyOpFieldsValuesTuple> values;
+            values.push_back(KeyOpFieldsValuesTuple{to_string(i), SET_COMMAND, {{"f", "v"}}});
+            client.sendMsg("DB", "TABLE_" + to_string(t), values);
+        }
+    }
+
+    for (int t = 0; t < tableCount; t++)
+    {
+        for (int retry = 0; retry < 50 && handlers[t].keys().size() < messageCount; retry++)
+        {
+            usleep(100 * 1000);
+        }
+
+        // Each table is handled by one worker, in order.
+        auto keys = handlers[t].keys();
+        ASSERT_EQ(keys.size(), (size_t)messageCount);
+        for (int i = 0; i < messageCount; i++)
+        {
+            EXPECT_EQ(keys[i], to_string(i));
+        }
+    }
+
+    for (int t = 0; t < tableCount; t++)
+    {
+        server.removeMessageHandler("DB", "TABLE_" + to_string(t));
+    }
+}
+
+// Replies to every request with its own key from the server poll thread.
+class EchoHandler : public ZmqMessageHandler
+{
+public:
+    EchoHandler(ZmqServer &server)
+        : m_server(server)
+    {
+    }
+
+    void handleReceivedData(const std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>>& kcos) override
+    {
+        std::vector<KeyOpFieldsValuesTuple> values;
+        values.push_back(KeyOpFieldsValuesTuple{kfvKey(*kcos[0]), SET_COMMAND, {{"reply", "1"}}});
+        m_server.sendMsg("DB", "TABLE", values);
+    }
+
+private:
+    ZmqServer &m_server;
+};
+
+static std::vector<KeyOpFieldsValuesTuple> requestValues(int i)
+{
+    std::vector<KeyOpFieldsValuesTuple> values;
+    values.push_back(KeyOpFieldsValuesTuple{to_string(i), SET_COMMAND, {{"f", "v"}}});
+    return values;
+}
+
+TEST(ZmqOneToOneSyncPipelined, test)
+{
+    ZmqServer server("tcp://*:1239", "", false, true);
+    EchoHandler handler(server);
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    std::string dbName, tableName;
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos;
+
+    // ZMQ_REQ clients are still served in lockstep.
+    ZmqClient reqClient("tcp://localhost:1239", 3000);
+    for (int i = 0; i < 3; i++)
+    {
+        reqClient.sendMsg("DB", "TABLE", requestValues(i));
+        ASSERT_TRUE(reqClient.wait(dbName, tableName, kcos));
+        ASSERT_EQ(kcos.size(), 1u);
+        EXPECT_EQ(kfvKey(*kcos[0]), to_string(i));
+    }
+
+    // Pipelined client, more requests than the window.
+    ZmqClient client("tcp://localhost:1239", 3000, 4);
+    std::vector<uint64_t> requestIds;
+    for (int i = 0; i < 10; i++)
+    {
+        requestIds.push_back(client.sendRequest("DB", "TABLE", requestValues(i)));
+    }
+
+    // Replies can be waited for out of order.
+    ASSERT_TRUE(client.wait(requestIds[9], dbName, tableName, kcos));
+    EXPECT_EQ(dbName, "DB");
+    EXPECT_EQ(tableName, "TABLE");
+    ASSERT_EQ(kcos.size(), 1u);
+    EXPECT_EQ(kfvKey(*kcos[0]), "9");
+
+    for (int i = 0; i < 9; i++)
+    {
+        ASSERT_TRUE(client.wait(dbName, tableName, kcos));
+        ASSERT_EQ(kcos.size(), 1u);
+        EXPECT_EQ(kfvKey(*kcos[0]), to_string(i));
+    }
+
+    // Nothing left to wait for.
+    EXPECT_FALSE(client.wait(requestIds[0], dbName, tableName, kcos));
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqOneToOneSyncPipelined, timeout)
+{
+    std::string dbName, tableName;
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos;
+
+    // No server yet, the requests are queued and time out.
+    ZmqClient client("tcp://localhost:1252", 500, 2);
+    uint64_t first = client.sendRequest("DB", "TABLE", requestValues(0));
+    client.sendRequest("DB", "TABLE", requestValues(1));
+    EXPECT_FALSE(client.wait(first, dbName, tableName, kcos));
+    EXPECT_FALSE(client.wait(dbName, tableName, kcos));
+    EXPECT_FALSE(client.wait(first, dbName, tableName, kcos));
+
+    // The window is free again, late replies to the abandoned requests are
+    // dropped.
+    ZmqServer server("tcp://*:1252", "", false, true);
+    EchoHandler handler(server);
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    client.sendRequest("DB", "TABLE", requestValues(2));
+    client.sendRequest("DB", "TABLE", requestValues(3));
+    for (int i = 2; i < 4; i++)
+    {
+        ASSERT_TRUE(client.wait(dbName, tableName, kcos));
+        ASSERT_EQ(kcos.size(), 1u);
+        EXPECT_EQ(kfvKey(*kcos[0]), to_string(i));
+    }
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqOneToOneSync, malformed_request)
+{
+    ZmqServer server("tcp://*:1248", "", false, true);
+    EchoHandler handler(server);
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    // A request which fails to decode gets no reply.
+    void* context = zmq_ctx_new();
+    void* socket = zmq_socket(context, ZMQ_DEALER);
+    int linger = 0;
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    ASSERT_EQ(zmq_connect(socket, "tcp://localhost:1248"), 0);
+    ASSERT_EQ(zmq_send(socket, "", 0, ZMQ_SNDMORE), 0);
+    ASSERT_EQ(zmq_send(socket, "garbage", 7, 0), 7);
+    usleep(100 * 1000);
+
+    // And doesn't take the reply of the next one.
+    std::string dbName, tableName;
+    std::vector<std::shared_ptr<KeyOpFieldsValuesTuple>> kcos;
+    ZmqClient client("tcp://localhost:1248", 3000);
+    client.sendMsg("DB", "TABLE", requestValues(1));
+    ASSERT_TRUE(client.wait(dbName, tableName, kcos));
+    ASSERT_EQ(kcos.size(), 1u);
+    EXPECT_EQ(kfvKey(*kcos[0]), "1");
+    EXPECT_TRUE(server.m_pendingReplies.empty());
+
+    zmq_close(socket);
+    zmq_ctx_destroy(context);
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqServer, sequence_tracking)
+{
+    ZmqServer server("tcp://*:1240", "", true);
+    RecordingHandler handler;
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    auto send = [&server](uint64_t session, uint64_t number)
+    {
+        BinarySerializer::Sequence sequence;
+        sequence.session = session;
+        sequence.number = number;
+        auto values = requestValues((int)number);
+        std::string buffer(BinarySerializer::serializedSize("DB", "TABLE", values, BinarySerializer::VERSION_2, &sequence), '\0');
+        BinarySerializer::serializeBuffer(&buffer[0], buffer.size(), "DB", "TABLE", values, BinarySerializer::VERSION_2, &sequence);
+        server.handleReceivedData(buffer.data(), buffer.size());
+    };
+
+    send(1, 1);
+    send(1, 2);
+    send(1, 2);
+    send(1, 4);
+    // A new session starts over.
+    send(2, 1);
+
+    auto stats = server.getSequenceStats();
+    EXPECT_EQ(stats.duplicates, 1u);
+    EXPECT_EQ(stats.gaps, 1u);
+    EXPECT_EQ(handler.keys(), (std::vector<std::string>{"1", "2", "4", "1"}));
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+static bool waitResume(ZmqClient &client)
+{
+    for (int retry = 0; retry < 200; retry++)
+    {
+        if (client.resume())
+        {
+            return true;
+        }
+        usleep(10000);
+    }
+
+    return false;
+}
+
+static void waitKeys(RecordingHandler &handler, size_t count)
+{
+    for (int retry = 0; retry < 200 && handler.keys().size() < count; retry++)
+    {
+        usleep(10000);
+    }
+}
+
+TEST(ZmqClient, replay_after_reconnect)
+{
+    ZmqClient client("tcp://localhost:1241");
+    client.enableReplay("tcp://localhost:1242", 4);
+
+    {
+        RecordingHandler handler;
+        ZmqServer server("tcp://*:1241");
+        server.enableResume("tcp://*:1242");
+        server.registerMessageHandler("DB", "TABLE", &handler);
+
+        for (int i = 1; i <= 3; i++)
+        {
+            client.sendMsg("DB", "TABLE", requestValues(i));
+        }
+
+        ASSERT_TRUE(waitResume(client));
+        waitKeys(handler, 3);
+        EXPECT_EQ(handler.keys(), (std::vector<std::string>{"1", "2", "3"}));
+        server.removeMessageHandler("DB", "TABLE");
+    }
+
+    // Sent while the server is down.
+    usleep(100000);
+    client.sendMsg("DB", "TABLE", requestValues(4));
+
+    // The restarted server has not seen the session, everything still
+    // buffered is replayed in order.
+    RecordingHandler handler;
+    ZmqServer server("tcp://*:1241");
+    server.enableResume("tcp://*:1242");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    ASSERT_TRUE(waitResume(client));
+    client.sendMsg("DB", "TABLE", requestValues(5));
+    waitKeys(handler, 5);
+    EXPECT_EQ(handler.keys(), (std::vector<std::string>{"1", "2", "3", "4", "5"}));
+    EXPECT_TRUE(client.getResyncRequiredTables().empty());
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqClient, replay_resync_required)
+{
+    // Nobody listens yet, so message 1 falls out of the buffer unsent.
+    ZmqClient client("tcp://localhost:1243");
+    client.enableReplay("tcp://localhost:1244", 2);
+    for (int i = 1; i <= 3; i++)
+    {
+        client.sendMsg("DB", "TABLE", requestValues(i));
+    }
+
+    RecordingHandler handler;
+    ZmqServer server("tcp://*:1243");
+    server.enableResume("tcp://*:1244");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    EXPECT_FALSE(waitResume(client));
+    auto tables = client.getResyncRequiredTables();
+    ASSERT_EQ(tables.size(), 1u);
+    EXPECT_EQ(tables[0], std::make_pair(std::string("DB"), std::string("TABLE")));
+    EXPECT_TRUE(client.resume());
+
+    // New messages are delivered again once the table is resynced.
+    client.sendMsg("DB", "TABLE", requestValues(4));
+    waitKeys(handler, 1);
+    EXPECT_EQ(handler.keys(), (std::vector<std::string>{"4"}));
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqClient, replay_malformed_resume_reply)
+{
+    ZmqClient client("tcp://localhost:1249");
+    client.enableReplay("tcp://localhost:1250", 4);
+
+    RecordingHandler handler;
+    ZmqServer server("tcp://*:1249");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    // A resume endpoint which replies with a position that isn't a number.
+    void* context = zmq_ctx_new();
+    void* socket = zmq_socket(context, ZMQ_REP);
+    int linger = 0;
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    ASSERT_EQ(zmq_bind(socket, "tcp://*:1250"), 0);
+    std::atomic<bool> replied(false);
+    std::thread resumer([socket, &client, &replied]() {
+        char buffer[4096];
+        if (zmq_recv(socket, buffer, sizeof(buffer), 0) < 0)
+        {
+            return;
+        }
+
+        std::vector<KeyOpFieldsValuesTuple> reply;
+        reply.emplace_back("DB", SET_COMMAND, std::vector<FieldValueTuple>{{"TABLE", "garbage"}});
+        std::string session = to_string(client.m_session);
+        size_t size = BinarySerializer::serializeBuffer(buffer, sizeof(buffer), ZMQ_RESUME_DB, session, reply, BinarySerializer::VERSION_2);
+        zmq_send(socket, buffer, size, 0);
+        replied = true;
+    });
+
+    // Buffered until connected, the failed resume keeps it buffered.
+    client.sendMsg("DB", "TABLE", requestValues(1));
+    for (int retry = 0; retry < 200 && !replied; retry++)
+    {
+        EXPECT_FALSE(client.resume());
+        usleep(10000);
+    }
+    resumer.join();
+    EXPECT_TRUE(replied);
+    EXPECT_TRUE(handler.keys().empty());
+
+    zmq_close(socket);
+    zmq_ctx_destroy(context);
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqClient, async_send)
+{
+    RecordingHandler handler;
+    ZmqServer server("tcp://*:1245");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    ZmqClient client("tcp://localhost:1245");
+    client.enableAsyncSend(16);
+    for (int i = 0; i < 100; i++)
+    {
+        client.sendMsg("DB", "TABLE", requestValues(i));
+    }
+    client.flush();
+
+    waitKeys(handler, 100);
+    auto keys = handler.keys();
+    ASSERT_EQ(keys.size(), 100u);
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(keys[i], to_string(i));
+    }
+
+    auto stats = client.getAsyncSendStats();
+    EXPECT_EQ(stats.enqueued, 100u);
+    EXPECT_EQ(stats.depth, 0u);
+    EXPECT_LE(stats.maxDepth, 16u);
+    EXPECT_GE(stats.sent, 1u);
+    EXPECT_LE(stats.sent, 100u);
+    EXPECT_EQ(stats.dropped + stats.rejected + stats.failed, 0u);
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqClient, async_send_queue_full)
+{
+    // Without the sender thread nothing leaves the queue.
+    ZmqClient client("tcp://localhost:1246");
+    client.m_asyncMaxQueueSize = 2;
+
+    client.m_asyncPolicy = AsyncSendPolicy::DropOldest;
+    for (int i = 0; i < 3; i++)
+    {
+        client.queueAsync("DB", "TABLE", requestValues(i));
+    }
+    auto stats = client.getAsyncSendStats();
+    EXPECT_EQ(stats.depth, 2u);
+    EXPECT_EQ(stats.dropped, 1u);
+    EXPECT_EQ(kfvKey(client.m_asyncQueue.front().kcos[0]), "1");
+
+    client.m_asyncPolicy = AsyncSendPolicy::Error;
+    EXPECT_THROW(client.queueAsync("DB", "TABLE", requestValues(3)), std::system_error);
+    EXPECT_EQ(client.getAsyncSendStats().rejected, 1u);
+}
+
+TEST(ZmqClient, shm_transport)
+{
+    RecordingHandler handler;
+    ZmqServer server("shm://zmq_state_ut");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    ZmqClient client("shm://zmq_state_ut");
+    for (int i = 0; i < 100; i++)
+    {
+        client.sendMsg("DB", "TABLE", requestValues(i));
+    }
+
+    waitKeys(handler, 100);
+    auto keys = handler.keys();
+    ASSERT_EQ(keys.size(), 100u);
+    for (int i = 0; i < 100; i++)
+    {
+        EXPECT_EQ(keys[i], to_string(i));
+    }
+
+    EXPECT_THROW(ZmqClient("shm://zmq_state_ut", 100u), std::runtime_error);
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqClient, compression)
+{
+    if (!ZmqCompression::isSupported())
+    {
+        // zstd support is not compiled in.
+        return;
+    }
+
+    RecordingHandler handler;
+    ZmqServer server("tcp://*:1247");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    ZmqClient client("tcp://localhost:1247");
+    client.enableCompression(1024);
+    EXPECT_THROW(client.setWireFormatVersion(1), std::runtime_error);
+
+    // One small message sent as it is, one bulk message compressed.
+    client.sendMsg("DB", "TABLE", requestValues(0));
+    std::vector<KeyOpFieldsValuesTuple> bulk;
+    for (int i = 1; i <= 500; i++)
+    {
+        bulk.emplace_back(to_string(i), SET_COMMAND, std::vector<FieldValueTuple>{{"PACKET_ACTION", "FORWARD"}, {"PRIORITY", "100"}});
+    }
+    client.sendMsg("DB", "TABLE", bulk);
+
+    waitKeys(handler, 501);
+    auto keys = handler.keys();
+    ASSERT_EQ(keys.size(), 501u);
+    EXPECT_EQ(keys.front(), "0");
+    EXPECT_EQ(keys.back(), "500");
+
+    auto stats = client.getCompressionStats();
+    EXPECT_EQ(stats.compressed, 1u);
+    EXPECT_GT(stats.ratio(), 2.0);
+    EXPECT_EQ(server.getCompressionStats().decompressed, 1u);
+
+    server.removeMessageHandler("DB", "TABLE");
+}
+
+TEST(ZmqServer, malformed_compressed_message)
+{
+    RecordingHandler handler;
+    ZmqServer server("tcp://*:1251");
+    server.registerMessageHandler("DB", "TABLE", &handler);
+
+    // Flagged compressed, but the operations are not a zstd frame.
+    auto values = requestValues(0);
+    std::string buffer(BinarySerializer::serializedSize("DB", "TABLE", values, BinarySerializer::VERSION_2), '\0');
+    BinarySerializer::serializeBuffer(&buffer[0], buffer.size(), "DB", "TABLE", values, BinarySerializer::VERSION_2);
+    BinarySerializer::setCompressed(&buffer[0], buffer.size(), true);
+
+    void* context = zmq_ctx_new();
+    void* socket = zmq_socket(context, ZMQ_PUSH);
+    int linger = 0;
+    zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    ASSERT_EQ(zmq_connect(socket, "tcp://localhost:1251"), 0);
+    ASSERT_EQ(zmq_send(socket, buffer.data(), buffer.size(), 0), (int)buffer.size());
+    for (int i = 0; i < 500 && server.getCompressionStats().decompressFailed == 0; i++)
+    {
+        usleep(10 * 1000);
+    }
+
+    // The message is dropped and counted, the next one gets through.
+    ZmqClient client("tcp://localhost:1251");
+    client.sendMsg("DB", "TABLE", requestValues(1));
+    waitKeys(handler, 1);
+    auto keys = handler.keys();
+    ASSERT_EQ(keys.size(), 1u);
+    EXPECT_EQ(keys.front(), "1");
+    EXPECT_EQ(server.getCompressionStats().decompressFailed, 1u);
+
+    zmq_close(socket);
+    zmq_ctx_destroy(context);
+    server.removeMessageHandler("DB", "TABLE");
+}